@@ -2,7 +2,7 @@
   Coroutines.h - Library providing a simple coroutine system.
   Created by Renaud Bédard with code review help by Bryan McConkey and zerozshadow, July 18th, 2014.
   Released into the public domain.
-  Version 1.1
+  Version 1.2
 
   The variant of coroutines proposed in this library are inspired by Unity coroutines
   http://docs.unity3d.com/ScriptReference/Coroutine.html
@@ -160,6 +160,33 @@
   alive for more than 1000ms.
   If used, the COROUTINE_FINALLY block must be placed before END_COROUTINE.
 
+  Many coroutines can also be woken up by a single event, using signals. The sketch
+  calls signal() on the Coroutines<N> object when the event happens, which only
+  increments a counter, and coroutines that wait for that count resume in the
+  next update :
+
+    void onEveryOtherPulse(COROUTINE_CONTEXT(coroutine))
+    {
+        BEGIN_COROUTINE;
+
+        // "coroutines" is the sketch's Coroutines<N> instance
+        coroutine.waitForSignal(coroutines.getSignalCount() + 2);
+        COROUTINE_YIELD;
+
+        Serial.println("Two pulses later");
+
+        END_COROUTINE;
+    }
+
+  signal() itself only increments a counter, but the next update() still checks
+  every active coroutine, so a pulse costs a little per coroutine on top of
+  running the ones it wakes up.
+  Waiting for a signal and for time can be combined, in which case the coroutine
+  resumes once both are reached.
+  To stop waiting for a signal that may never come, pass a timeout in milliseconds
+  as well : the coroutine then resumes after that time even if the signal count
+  was not reached, which it can check with getSignalCount().
+
   There is currently no way to return something from a coroutine or to pass a parameter
   to a coroutine. However, they have access to the sketch's file-scope variables,
   which can be used for input and/or output.
@@ -187,6 +214,10 @@
   - Free allocated locals as soon as the coroutine terminates
   - Fixed erroneous debugging define documentation
   - Fixed error when declaring more than one coroutine local (thanks stuntgoat!)
+
+  1.2 (2026-10-19)
+  - Added signals, to wake many coroutines from a single event
+  - Waiting for a signal can time out
 */
 
 #ifndef COROUTINES_H
@@ -195,7 +226,7 @@
 // The Arduino header is primarily required for use of the millis() function
 #include "Arduino.h"
 
-#define COROUTINES_VERSION 1.1
+#define COROUTINES_VERSION 1.2
 
 // Debugging macros, null operations unless defined prior to including this .h
 // trace should be : printf(__VA_ARGS__) 
@@ -272,6 +303,10 @@ class Coroutine
 public:
     // Sets the time in milliseconds to wait before the coroutine can come back from a yield
     virtual void wait(unsigned long millis) = 0;
+    // Sets the signal count (see Coroutines<N>::signal) to wait for before the coroutine can come back from a yield
+    virtual void waitForSignal(unsigned long signal) = 0;
+    // Same, but gives up waiting for the signal after timeout milliseconds
+    virtual void waitForSignal(unsigned long signal, unsigned long timeout) = 0;
     // Stops the coroutine on its next update
     virtual void terminate() = 0;
     // Suspends the coroutine indefinitely starting from the next update, pausing its execution
@@ -299,8 +334,13 @@ public:
 
     CoroutineBody function;
     unsigned long barrierTime, sinceStarted, startedAt, suspendedAt;
+    // Signal count to reach before resuming, and the manager's current count
+    unsigned long barrierSignal;
+    const unsigned long* signalCount;
+    // Time after which the signal isn't waited for anymore, if signalTimesOut
+    unsigned long signalTimeoutTime;
     byte id;
-    bool terminated, suspended, looping;
+    bool terminated, suspended, looping, signalTimesOut;
     long jumpLocation;
     // Coroutine locals are heap-allocated on demand and freed on termination
     void* savedLocals[MaxLocals];
@@ -314,6 +354,8 @@ public:
     bool update(unsigned long millis);
 
     void wait(unsigned long millis);
+    void waitForSignal(unsigned long signal);
+    void waitForSignal(unsigned long signal, unsigned long timeout);
     void terminate();
     void suspend();
     void resume();
@@ -338,6 +380,8 @@ private:
     unsigned long activeMask;
     // The count of active coroutines
     byte activeCount;
+    // The number of signals raised so far
+    unsigned long signalCount;
 
 public:
     Coroutines();
@@ -352,6 +396,11 @@ public:
     // Updates the active coroutines.
     // This overload will call millis() by itself.
     void update();
+
+    // Raises a signal, resuming the coroutines waiting for it in the next update.
+    void signal();
+    // The number of signals raised so far, to compute what to pass to Coroutine::waitForSignal
+    unsigned long getSignalCount() const;
 };
 
 // Implementation of the Coroutines<N> functions.
@@ -360,11 +409,15 @@ public:
 template <byte N>
 Coroutines<N>::Coroutines() :
     activeMask(0),
-    activeCount(0)
+    activeCount(0),
+    signalCount(0)
 {
     // ids are assigned sequentially and never change
     for (byte i = 0; i < N; i++)
+    {
         coroutines[i].id = i;
+        coroutines[i].signalCount = &signalCount;
+    }
 }
 
 template <byte N>
@@ -433,12 +486,27 @@ void Coroutines<N>::update()
     update(millis());
 }
 
+template <byte N>
+void Coroutines<N>::signal()
+{
+    // waiting coroutines compare against this counter when they're updated, nothing else to do
+    signalCount++;
+}
+
+template <byte N>
+unsigned long Coroutines<N>::getSignalCount() const
+{
+    return signalCount;
+}
+
 bool CoroutineImpl::update(unsigned long millis)
 {
     if (suspended)
         return false;
 
-    if (barrierTime <= millis)
+    // the difference is taken so that the comparison survives the counter wrapping around
+    if (barrierTime <= millis &&
+        ((long) (*signalCount - barrierSignal) >= 0 || (signalTimesOut && signalTimeoutTime <= millis)))
     {
         sinceStarted = startedAt > millis ? 0 : millis - startedAt;
         function(*this);
@@ -451,6 +519,8 @@ bool CoroutineImpl::update(unsigned long millis)
 void CoroutineImpl::reset()
 {
     barrierTime = 0;
+    barrierSignal = *signalCount;
+    signalTimesOut = false;
     sinceStarted = 0;
     jumpLocation = 0;
     terminated = suspended = false;
@@ -467,6 +537,19 @@ void CoroutineImpl::wait(unsigned long time)
     barrierTime = millis() + time;
 }
 
+void CoroutineImpl::waitForSignal(unsigned long signal)
+{
+    barrierSignal = signal;
+    signalTimesOut = false;
+}
+
+void CoroutineImpl::waitForSignal(unsigned long signal, unsigned long timeout)
+{
+    barrierSignal = signal;
+    signalTimeoutTime = millis() + timeout;
+    signalTimesOut = true;
+}
+
 void CoroutineImpl::freeLocals() 
 {
     if (numSavedLocals == 0) 
@@ -485,6 +568,8 @@ void CoroutineImpl::terminate()
     looping = false;
     jumpLocation = -1;
     barrierTime = 0;
+    barrierSignal = *signalCount;
+    signalTimesOut = false;
 }
 
 void CoroutineImpl::suspend()
@@ -27,6 +27,61 @@
 
 BEGIN_MIDI_NAMESPACE
 
+#define MIDI_STATUS_INFO(Type, Length, Flags)                                   \
+    uint16_t(Type | (Length << StatusLengthShift) | Flags)
+
+// The 16 status bytes of a Channel message type
+#define MIDI_CHANNEL_STATUS_INFO(Type, Length)                                  \
+    MIDI_STATUS_INFO(Type, Length, StatusChannel),                              \
+    MIDI_STATUS_INFO(Type, Length, StatusChannel),                              \
+    MIDI_STATUS_INFO(Type, Length, StatusChannel),                              \
+    MIDI_STATUS_INFO(Type, Length, StatusChannel),                              \
+    MIDI_STATUS_INFO(Type, Length, StatusChannel),                              \
+    MIDI_STATUS_INFO(Type, Length, StatusChannel),                              \
+    MIDI_STATUS_INFO(Type, Length, StatusChannel),                              \
+    MIDI_STATUS_INFO(Type, Length, StatusChannel),                              \
+    MIDI_STATUS_INFO(Type, Length, StatusChannel),                              \
+    MIDI_STATUS_INFO(Type, Length, StatusChannel),                              \
+    MIDI_STATUS_INFO(Type, Length, StatusChannel),                              \
+    MIDI_STATUS_INFO(Type, Length, StatusChannel),                              \
+    MIDI_STATUS_INFO(Type, Length, StatusChannel),                              \
+    MIDI_STATUS_INFO(Type, Length, StatusChannel),                              \
+    MIDI_STATUS_INFO(Type, Length, StatusChannel),                              \
+    MIDI_STATUS_INFO(Type, Length, StatusChannel)
+
+const uint16_t gStatusInfo[128] PROGMEM =
+{
+    MIDI_CHANNEL_STATUS_INFO(NoteOff,           3),
+    MIDI_CHANNEL_STATUS_INFO(NoteOn,            3),
+    MIDI_CHANNEL_STATUS_INFO(AfterTouchPoly,    3),
+    MIDI_CHANNEL_STATUS_INFO(ControlChange,     3),
+    MIDI_CHANNEL_STATUS_INFO(ProgramChange,     2),
+    MIDI_CHANNEL_STATUS_INFO(AfterTouchChannel, 2),
+    MIDI_CHANNEL_STATUS_INFO(PitchBend,         3),
+
+    MIDI_STATUS_INFO(SystemExclusive,      0, 0),
+    MIDI_STATUS_INFO(TimeCodeQuarterFrame, 2, 0),
+    MIDI_STATUS_INFO(SongPosition,         3, 0),
+    MIDI_STATUS_INFO(SongSelect,           2, 0),
+    MIDI_STATUS_INFO(InvalidType,          0, 0),              // 0xf4
+    MIDI_STATUS_INFO(InvalidType,          0, 0),              // 0xf5
+    MIDI_STATUS_INFO(TuneRequest,          1, 0),
+    MIDI_STATUS_INFO(0xf7,                 0, 0),              // EOX
+    MIDI_STATUS_INFO(Clock,                1, StatusRealTime),
+    MIDI_STATUS_INFO(InvalidType,          0, StatusRealTime), // 0xf9
+    MIDI_STATUS_INFO(Start,                1, StatusRealTime),
+    MIDI_STATUS_INFO(Continue,             1, StatusRealTime),
+    MIDI_STATUS_INFO(Stop,                 1, StatusRealTime),
+    MIDI_STATUS_INFO(InvalidType,          0, StatusRealTime), // 0xfd
+    MIDI_STATUS_INFO(ActiveSensing,        1, StatusRealTime),
+    MIDI_STATUS_INFO(SystemReset,          1, StatusRealTime),
+};
+
+#undef MIDI_CHANNEL_STATUS_INFO
+#undef MIDI_STATUS_INFO
+
+// -----------------------------------------------------------------------------
+
 /*! \brief Encode System Exclusive messages.
  SysEx messages are encoded to guarantee transmission of data bytes higher than
  127 without breaking the MIDI protocol. Use this static method to convert the
@@ -35,33 +90,15 @@ BEGIN_MIDI_NAMESPACE
  \param outSysEx The output buffer where to store the encoded message.
  \param inLength The lenght of the input buffer.
  \return The lenght of the encoded output buffer.
- @see decodeSysEx
+ Groups of 7 data bytes are encoded as whole words, see encodeSysExBlock.
+ @see decodeSysEx @see SysExEncoder to encode data in chunks
  Code inspired from Ruin & Wesen's SysEx encoder/decoder - http://ruinwesen.com
  */
 unsigned encodeSysEx(const byte* inData, byte* outSysEx, unsigned inLength)
 {
-    unsigned outLength  = 0;     // Num bytes in output array.
-    byte count          = 0;     // Num 7bytes in a block.
-    outSysEx[0]         = 0;
-
-    for (unsigned i = 0; i < inLength; ++i)
-    {
-        const byte data = inData[i];
-        const byte msb  = data >> 7;
-        const byte body = data & 0x7f;
-
-        outSysEx[0] |= (msb << count);
-        outSysEx[1 + count] = body;
-
-        if (count++ == 6)
-        {
-            outSysEx   += 8;
-            outLength  += 8;
-            outSysEx[0] = 0;
-            count       = 0;
-        }
-    }
-    return outLength + count + (count != 0 ? 1 : 0);
+    SysExEncoder encoder;
+    const unsigned length = encoder.encode(inData, inLength, outSysEx);
+    return length + encoder.flush(outSysEx + length);
 }
 
 /*! \brief Decode System Exclusive messages.
@@ -73,26 +110,13 @@ unsigned encodeSysEx(const byte* inData, byte* outSysEx, unsigned inLength)
  \param inLength The lenght of the input buffer.
  \return The lenght of the output buffer.
  @see encodeSysEx @see getSysExArrayLength
+ @see SysExDecoder to decode SysEx in chunks
  Code inspired from Ruin & Wesen's SysEx encoder/decoder - http://ruinwesen.com
  */
 unsigned decodeSysEx(const byte* inSysEx, byte* outData, unsigned inLength)
 {
-    unsigned count  = 0;
-    byte msbStorage = 0;
-
-    for (unsigned i = 0; i < inLength; ++i)
-    {
-        if ((i % 8) == 0)
-        {
-            msbStorage = inSysEx[i];
-        }
-        else
-        {
-            outData[count++] = inSysEx[i] | ((msbStorage & 1) << 7);
-            msbStorage >>= 1;
-        }
-    }
-    return count;
+    SysExDecoder decoder;
+    return decoder.decode(inSysEx, inLength, outData);
 }
 
 END_MIDI_NAMESPACE
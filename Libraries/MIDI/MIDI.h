@@ -26,6 +26,10 @@
 #include "midi_Defs.h"
 #include "midi_Settings.h"
 #include "midi_Message.h"
+#include "midi_MessageQueue.h"
+#include "midi_RingBuffer.h"
+#include "midi_SysExCodec.h"
+#include "midi_Handler.h"
 
 // -----------------------------------------------------------------------------
 
@@ -94,6 +98,18 @@ public:
               DataByte inData1,
               DataByte inData2,
               Channel inChannel);
+    inline void send(const PackedMessage& inMessage);
+    void send(const PackedMessage* inMessages, unsigned inCount);
+
+public:
+    inline void flush();
+    byte flush(byte inMaxBytes);
+    inline byte getPendingOutputCount() const;
+
+private:
+    inline void write(byte inByte);
+    inline void writeRealTime(byte inByte);
+    inline void writePendingByte();
 
     // -------------------------------------------------------------------------
     // MIDI Input
@@ -101,6 +117,10 @@ public:
 public:
     inline bool read();
     inline bool read(Channel inChannel);
+    inline unsigned readAll();
+    unsigned readAll(Channel inChannel);
+    template<byte QueueSize> inline unsigned readAll(MessageQueue<QueueSize>& outQueue);
+    template<byte QueueSize> unsigned readAll(MessageQueue<QueueSize>& outQueue, Channel inChannel);
 
 public:
     inline MidiType getType() const;
@@ -109,8 +129,12 @@ public:
     inline DataByte getData2() const;
     inline const byte* getSysExArray() const;
     inline unsigned getSysExArrayLength() const;
+    inline unsigned long getTimestamp() const;
     inline bool check() const;
 
+public:
+    inline void setSysExBuffer(byte* inBuffer, unsigned inSize);
+
 public:
     inline Channel getInputChannel() const;
     inline void setInputChannel(Channel inChannel);
@@ -118,6 +142,7 @@ public:
 public:
     static inline MidiType getTypeFromStatusByte(byte inStatus);
     static inline Channel getChannelFromStatusByte(byte inStatus);
+    static inline byte getMessageLength(byte inStatus);
 	static inline bool isChannelMessage(MidiType inType);
 
 
@@ -133,6 +158,7 @@ public:
     inline void setHandleAfterTouchChannel(void (*fptr)(byte channel, byte pressure));
     inline void setHandlePitchBend(void (*fptr)(byte channel, int bend));
     inline void setHandleSystemExclusive(void (*fptr)(byte * array, unsigned size));
+    inline void setHandleSystemExclusiveChunk(void (*fptr)(byte * array, unsigned size, byte flags));
     inline void setHandleTimeCodeQuarterFrame(void (*fptr)(byte data));
     inline void setHandleSongPosition(void (*fptr)(unsigned beats));
     inline void setHandleSongSelect(void (*fptr)(byte songnumber));
@@ -148,25 +174,25 @@ public:
 
 private:
     void launchCallback();
+    void launchSysExChunkCallback(byte inFlags);
+
+    Callbacks<Settings::UseCallbacks> mCallbacks;
 
-    void (*mNoteOffCallback)(byte channel, byte note, byte velocity);
-    void (*mNoteOnCallback)(byte channel, byte note, byte velocity);
-    void (*mAfterTouchPolyCallback)(byte channel, byte note, byte velocity);
-    void (*mControlChangeCallback)(byte channel, byte, byte);
-    void (*mProgramChangeCallback)(byte channel, byte);
-    void (*mAfterTouchChannelCallback)(byte channel, byte);
-    void (*mPitchBendCallback)(byte channel, int);
-    void (*mSystemExclusiveCallback)(byte * array, unsigned size);
-    void (*mTimeCodeQuarterFrameCallback)(byte data);
-    void (*mSongPositionCallback)(unsigned beats);
-    void (*mSongSelectCallback)(byte songnumber);
-    void (*mTuneRequestCallback)(void);
-    void (*mClockCallback)(void);
-    void (*mStartCallback)(void);
-    void (*mContinueCallback)(void);
-    void (*mStopCallback)(void);
-    void (*mActiveSensingCallback)(void);
-    void (*mSystemResetCallback)(void);
+    // -------------------------------------------------------------------------
+    // Compile-time handlers
+
+public:
+    template<class MessageHandler> inline void dispatch(MessageHandler& inHandler) const;
+    template<class MessageHandler> static inline void dispatch(MessageHandler& inHandler,
+                                                               const PackedMessage& inMessage);
+    template<class MessageHandler> inline unsigned dispatchAll(MessageHandler& inHandler);
+    template<class MessageHandler> unsigned dispatchAll(MessageHandler& inHandler, Channel inChannel);
+
+private:
+    template<class MessageHandler> static inline void dispatch(MessageHandler& inHandler,
+                                                               const PackedMessage& inMessage,
+                                                               byte* inSysExArray,
+                                                               unsigned inSysExSize);
 
     // -------------------------------------------------------------------------
     // MIDI Soft Thru
@@ -179,11 +205,20 @@ public:
     inline void turnThruOff();
     inline void setThruFilterMode(MidiFilterMode inThruFilterMode);
 
+public:
+    inline void setThruChannelMask(uint16_t inMask);
+    inline void setThruTypeFilter(MidiType inType, bool inForward);
+    inline void setThruChannelMap(const byte* inMap);
+    inline void setThruTranspose(const int8_t* inTransposeTable);
+
 private:
     void thruFilter(byte inChannel);
+    void thruByte(byte inByte);
 
 private:
     bool parse();
+    bool parseByte(byte inByte);
+    inline bool handleMessage(Channel inChannel);
     inline void handleNullVelocityNoteOnAsNoteOff();
     inline bool inputFilter(Channel inChannel);
     inline void resetInput();
@@ -191,9 +226,22 @@ private:
 private:
     bool            mThruActivated  : 1;
     MidiFilterMode  mThruFilterMode : 7;
+    uint16_t        mThruChannelMask;
+    uint32_t        mThruTypeMask;
+    const byte*     mThruChannelMap;
+    const int8_t*   mThruTranspose;
+    StatusByte      mThruStatus;    ///< Raw thru: status of the message being forwarded, 0 if filtered.
+    byte            mThruChannel;   ///< Raw thru: its input channel, from 0 to 15.
+    byte            mThruIndex;     ///< Raw thru: index of the next data byte.
+    DataByte        mThruData;      ///< Raw thru: first data byte forwarded, to write it again.
+    bool            mThruSkip;      ///< Raw thru: the message was transposed out of range.
+    bool            mThruOpen;      ///< Raw thru: the message is partly written, any other write clears it.
 
 private:
-    typedef Message<Settings::SysExMaxSize> MidiMessage;
+    typedef SysExStorage<Settings::SysExMaxSize> MidiSysExStorage;
+    typedef ReceiveTimestamps<Settings::UseReceiveTimestamps> MidiReceiveTimestamps;
+    typedef RingBuffer<Settings::TxBufferSize> MidiTxBuffer;
+    typedef RingBuffer<(Settings::TxBufferSize > 0) ? 8 : 0> MidiRealTimeBuffer;
 
 private:
     StatusByte  mRunningStatus_RX;
@@ -202,7 +250,15 @@ private:
     byte        mPendingMessage[3];
     unsigned    mPendingMessageExpectedLenght;
     unsigned    mPendingMessageIndex;
-    MidiMessage mMessage;
+    PackedMessage    mMessage;
+    MidiSysExStorage mSysExStorage;
+    byte*       mSysExArray;
+    unsigned    mSysExSize;
+    unsigned    mSysExLength;
+    byte        mSysExChunkFlags;
+    MidiReceiveTimestamps mReceiveTimestamps;
+    MidiTxBuffer mTxBuffer;
+    MidiRealTimeBuffer mRealTimeBuffer;
 
 private:
     inline StatusByte getStatus(MidiType inType,
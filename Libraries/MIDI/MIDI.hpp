@@ -30,24 +30,13 @@ template<class SerialPort, class Settings>
 inline MidiInterface<SerialPort, Settings>::MidiInterface(SerialPort& inSerial)
     : mSerial(inSerial)
 {
-    mNoteOffCallback                = 0;
-    mNoteOnCallback                 = 0;
-    mAfterTouchPolyCallback         = 0;
-    mControlChangeCallback          = 0;
-    mProgramChangeCallback          = 0;
-    mAfterTouchChannelCallback      = 0;
-    mPitchBendCallback              = 0;
-    mSystemExclusiveCallback        = 0;
-    mTimeCodeQuarterFrameCallback   = 0;
-    mSongPositionCallback           = 0;
-    mSongSelectCallback             = 0;
-    mTuneRequestCallback            = 0;
-    mClockCallback                  = 0;
-    mStartCallback                  = 0;
-    mContinueCallback               = 0;
-    mStopCallback                   = 0;
-    mActiveSensingCallback          = 0;
-    mSystemResetCallback            = 0;
+    mSysExArray = mSysExStorage.getArray();
+    mSysExSize  = mSysExStorage.sSize;
+
+    mThruChannelMask    = 0xffff;
+    mThruTypeMask       = 0xffffffff;
+    mThruChannelMap     = 0;
+    mThruTranspose      = 0;
 }
 
 /*! \brief Destructor for MidiInterface.
@@ -84,14 +73,20 @@ void MidiInterface<SerialPort, Settings>::begin(Channel inChannel)
     mPendingMessageIndex = 0;
     mPendingMessageExpectedLenght = 0;
 
-    mMessage.valid   = false;
-    mMessage.type    = InvalidType;
-    mMessage.channel = 0;
+    mMessage.status  = InvalidType;
     mMessage.data1   = 0;
     mMessage.data2   = 0;
+    mMessage.flags   = 0;
 
     mThruFilterMode = Full;
     mThruActivated  = true;
+
+    mThruStatus  = 0;
+    mThruChannel = 0;
+    mThruIndex   = 0;
+    mThruData    = 0;
+    mThruSkip    = false;
+    mThruOpen    = false;
 }
 
 // -----------------------------------------------------------------------------
@@ -137,6 +132,15 @@ void MidiInterface<SerialPort, Settings>::send(MidiType inType,
         inData1 &= 0x7f;
         inData2 &= 0x7f;
 
+        if (Settings::UseRunningStatus &&
+            Settings::SendNoteOffAsNullVelocityNoteOn &&
+            inType == NoteOff)
+        {
+            // Same status as the NoteOns of this channel, no need to repeat it.
+            inType  = NoteOn;
+            inData2 = 0;
+        }
+
         const StatusByte status = getStatus(inType, inChannel);
 
         if (Settings::UseRunningStatus)
@@ -145,20 +149,20 @@ void MidiInterface<SerialPort, Settings>::send(MidiType inType,
             {
                 // New message, memorise and send header
                 mRunningStatus_TX = status;
-                mSerial.write(mRunningStatus_TX);
+                write(mRunningStatus_TX);
             }
         }
         else
         {
             // Don't care about running status, send the status byte.
-            mSerial.write(status);
+            write(status);
         }
 
         // Then send data
-        mSerial.write(inData1);
+        write(inData1);
         if (inType != ProgramChange && inType != AfterTouchChannel)
         {
-            mSerial.write(inData2);
+            write(inData2);
         }
     }
     else if (inType >= TuneRequest && inType <= SystemReset)
@@ -301,17 +305,17 @@ void MidiInterface<SerialPort, Settings>::sendSysEx(unsigned inLength,
 
     if (writeBeginEndBytes)
     {
-        mSerial.write(0xf0);
+        write(0xf0);
     }
 
     for (unsigned i = 0; i < inLength; ++i)
     {
-        mSerial.write(inArray[i]);
+        write(inArray[i]);
     }
 
     if (writeBeginEndBytes)
     {
-        mSerial.write(0xf7);
+        write(0xf7);
     }
 
     if (Settings::UseRunningStatus)
@@ -354,8 +358,8 @@ void MidiInterface<SerialPort, Settings>::sendTimeCodeQuarterFrame(DataByte inTy
 template<class SerialPort, class Settings>
 void MidiInterface<SerialPort, Settings>::sendTimeCodeQuarterFrame(DataByte inData)
 {
-    mSerial.write((byte)TimeCodeQuarterFrame);
-    mSerial.write(inData);
+    write((byte)TimeCodeQuarterFrame);
+    write(inData);
 
     if (Settings::UseRunningStatus)
     {
@@ -369,9 +373,9 @@ void MidiInterface<SerialPort, Settings>::sendTimeCodeQuarterFrame(DataByte inDa
 template<class SerialPort, class Settings>
 void MidiInterface<SerialPort, Settings>::sendSongPosition(unsigned inBeats)
 {
-    mSerial.write((byte)SongPosition);
-    mSerial.write(inBeats & 0x7f);
-    mSerial.write((inBeats >> 7) & 0x7f);
+    write((byte)SongPosition);
+    write(inBeats & 0x7f);
+    write((inBeats >> 7) & 0x7f);
 
     if (Settings::UseRunningStatus)
     {
@@ -383,8 +387,8 @@ void MidiInterface<SerialPort, Settings>::sendSongPosition(unsigned inBeats)
 template<class SerialPort, class Settings>
 void MidiInterface<SerialPort, Settings>::sendSongSelect(DataByte inSongNumber)
 {
-    mSerial.write((byte)SongSelect);
-    mSerial.write(inSongNumber & 0x7f);
+    write((byte)SongSelect);
+    write(inSongNumber & 0x7f);
 
     if (Settings::UseRunningStatus)
     {
@@ -398,6 +402,11 @@ void MidiInterface<SerialPort, Settings>::sendSongSelect(DataByte inSongNumber)
  Start, Stop, Continue, Clock, ActiveSensing and SystemReset.
  You can also send a Tune Request with this method.
  @see MidiType
+
+ When the output is buffered (see Settings::TxBufferSize), Real Time messages
+ skip the queue: flush sends them before any other buffered byte, even in the
+ middle of a message, so that Clock timing doesn't depend on the amount of
+ data sent around it.
  */
 template<class SerialPort, class Settings>
 void MidiInterface<SerialPort, Settings>::sendRealTime(MidiType inType)
@@ -405,13 +414,15 @@ void MidiInterface<SerialPort, Settings>::sendRealTime(MidiType inType)
     switch (inType)
     {
         case TuneRequest: // Not really real-time, but one byte anyway.
+            write((byte)inType);
+            break;
         case Clock:
         case Start:
         case Stop:
         case Continue:
         case ActiveSensing:
         case SystemReset:
-            mSerial.write((byte)inType);
+            writeRealTime((byte)inType);
             break;
         default:
             // Invalid Real Time marker
@@ -427,6 +438,169 @@ void MidiInterface<SerialPort, Settings>::sendRealTime(MidiType inType)
     }
 }
 
+// -----------------------------------------------------------------------------
+
+/*! \brief Send a message received or built as a PackedMessage.
+
+ PackedMessages don't carry any SysEx payload, so SystemExclusive messages
+ are not sent.
+ */
+template<class SerialPort, class Settings>
+inline void MidiInterface<SerialPort, Settings>::send(const PackedMessage& inMessage)
+{
+    const MidiType type = inMessage.getType();
+
+    if (isChannelMessage(type))
+    {
+        send(type, inMessage.data1, inMessage.data2, inMessage.getChannel());
+        return;
+    }
+
+    switch (type)
+    {
+        case TimeCodeQuarterFrame:
+            sendTimeCodeQuarterFrame(inMessage.data1);
+            break;
+        case SongPosition:
+            sendSongPosition(inMessage.data1 | (unsigned(inMessage.data2) << 7));
+            break;
+        case SongSelect:
+            sendSongSelect(inMessage.data1);
+            break;
+        case SystemExclusive:
+            break;
+        default:
+            sendRealTime(type);
+            break;
+    }
+}
+
+/*! \brief Send a batch of messages, in order.
+
+ Consecutive messages of the same type and channel share a single status
+ byte when running status is enabled, so sending, for instance, all the
+ NoteOns of a chord in a batch takes 2 bytes per note after the first one.
+ @see send(const PackedMessage&)
+ */
+template<class SerialPort, class Settings>
+void MidiInterface<SerialPort, Settings>::send(const PackedMessage* inMessages,
+                                               unsigned inCount)
+{
+    for (unsigned i = 0; i < inCount; ++i)
+    {
+        send(inMessages[i]);
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Write all the buffered output bytes to the serial port.
+
+ Only useful when Settings::TxBufferSize is not 0. This waits for the serial
+ port to take every byte, use flush(byte) from loop() to bound the time spent.
+ */
+template<class SerialPort, class Settings>
+inline void MidiInterface<SerialPort, Settings>::flush()
+{
+    while (!mRealTimeBuffer.isEmpty() || !mTxBuffer.isEmpty())
+    {
+        writePendingByte();
+    }
+}
+
+/*! \brief Write some of the buffered output bytes to the serial port.
+ \param inMaxBytes The maximum number of bytes to write.
+ \return The number of bytes still waiting to be written.
+
+ Call it from loop() when Settings::TxBufferSize is not 0. With SoftwareSerial,
+ each byte takes a full byte time (320us at 31250 bauds) to write, so a small
+ inMaxBytes spreads the output over several loops. HardwareSerial has its own
+ interrupt-driven buffer, and writing to it only waits once that is full.
+ */
+template<class SerialPort, class Settings>
+byte MidiInterface<SerialPort, Settings>::flush(byte inMaxBytes)
+{
+    for (byte i = 0; i < inMaxBytes; ++i)
+    {
+        if (mRealTimeBuffer.isEmpty() && mTxBuffer.isEmpty())
+        {
+            break;
+        }
+        writePendingByte();
+    }
+    return getPendingOutputCount();
+}
+
+/*! \brief Get the number of buffered output bytes not written yet.
+ */
+template<class SerialPort, class Settings>
+inline byte MidiInterface<SerialPort, Settings>::getPendingOutputCount() const
+{
+    return mRealTimeBuffer.getCount() + mTxBuffer.getCount();
+}
+
+/*! \brief Write a byte to the output buffer, or to the serial port if there is
+ no output buffer.
+
+ When the buffer is full, its oldest byte is written to the serial port to make
+ room for the new one, so nothing is ever lost or reordered.
+ */
+template<class SerialPort, class Settings>
+inline void MidiInterface<SerialPort, Settings>::write(byte inByte)
+{
+    // Tells Raw thru that a message it was forwarding has been cut.
+    mThruOpen = false;
+
+    if (Settings::TxBufferSize == 0)
+    {
+        mSerial.write(inByte);
+        return;
+    }
+
+    while (mTxBuffer.isFull())
+    {
+        writePendingByte();
+    }
+    mTxBuffer.push(inByte);
+}
+
+/*! \brief Write a Real Time byte to its own output buffer, which has priority
+ over the other bytes, or to the serial port if there is no output buffer.
+ */
+template<class SerialPort, class Settings>
+inline void MidiInterface<SerialPort, Settings>::writeRealTime(byte inByte)
+{
+    if (Settings::TxBufferSize == 0)
+    {
+        mSerial.write(inByte);
+        return;
+    }
+
+    if (mRealTimeBuffer.isFull())
+    {
+        mSerial.write(mRealTimeBuffer.pop());
+    }
+    mRealTimeBuffer.push(inByte);
+}
+
+/*! \brief Write the next buffered byte to the serial port: the oldest Real Time
+ byte if any, the oldest byte of the other messages otherwise.
+ Real Time messages can be inserted between any two bytes of the MIDI stream,
+ so this never breaks a message nor the running status.
+ */
+template<class SerialPort, class Settings>
+inline void MidiInterface<SerialPort, Settings>::writePendingByte()
+{
+    if (!mRealTimeBuffer.isEmpty())
+    {
+        mSerial.write(mRealTimeBuffer.pop());
+    }
+    else if (!mTxBuffer.isEmpty())
+    {
+        mSerial.write(mTxBuffer.pop());
+    }
+}
+
 /*! @} */ // End of doc group MIDI Output
 
 // -----------------------------------------------------------------------------
@@ -471,6 +645,106 @@ inline bool MidiInterface<SerialPort, Settings>::read(Channel inChannel)
     if (!parse())
         return false;
 
+    return handleMessage(inChannel);
+}
+
+/*! \brief Read all the messages available using the main input channel.
+ @see readAll(Channel)
+ */
+template<class SerialPort, class Settings>
+inline unsigned MidiInterface<SerialPort, Settings>::readAll()
+{
+    return readAll(mInputChannel);
+}
+
+/*! \brief Drain the serial buffer in a single pass, on a specified channel.
+
+ Unlike read(), which returns as soon as one message is complete, this
+ parses every byte the serial port holds in a tight loop (whatever the
+ Use1ByteParsing setting is), and launches callbacks and Thru for each
+ message as soon as it is complete.
+ Only the bytes already received when the call starts are parsed, so a
+ steady input stream can't keep the sketch stuck in here.
+ \return The number of messages that matched the input channel.
+ The getters then describe the last message that was parsed.
+ */
+template<class SerialPort, class Settings>
+unsigned MidiInterface<SerialPort, Settings>::readAll(Channel inChannel)
+{
+    if (inChannel >= MIDI_CHANNEL_OFF)
+        return 0; // MIDI Input disabled.
+
+    unsigned matchCount = 0;
+    for (int available = mSerial.available(); available > 0; --available)
+    {
+        if (parseByte(mSerial.read()) && handleMessage(inChannel))
+            matchCount++;
+    }
+
+    return matchCount;
+}
+
+/*! \brief Drain the serial buffer into a queue, using the main input channel.
+ @see readAll(MessageQueue<QueueSize>&, Channel)
+ */
+template<class SerialPort, class Settings>
+template<byte QueueSize>
+inline unsigned MidiInterface<SerialPort, Settings>::readAll(MessageQueue<QueueSize>& outQueue)
+{
+    return readAll(outQueue, mInputChannel);
+}
+
+/*! \brief Drain the serial buffer into a queue, on a specified channel.
+
+ Works like readAll(Channel), but the messages matching the input channel are
+ pushed to outQueue instead of launching callbacks, so that they can be
+ handled later, in batches, without holding back the input.
+ System Exclusive messages don't fit in the queue: their callback is
+ launched right away. Thru is handled as usual.
+ \return The number of messages that were queued, or dropped because the
+ queue was full (see MessageQueue::getDropCount).
+ */
+template<class SerialPort, class Settings>
+template<byte QueueSize>
+unsigned MidiInterface<SerialPort, Settings>::readAll(MessageQueue<QueueSize>& outQueue,
+                                                      Channel inChannel)
+{
+    if (inChannel >= MIDI_CHANNEL_OFF)
+        return 0; // MIDI Input disabled.
+
+    unsigned matchCount = 0;
+    for (int available = mSerial.available(); available > 0; --available)
+    {
+        if (!parseByte(mSerial.read()))
+            continue;
+
+        handleNullVelocityNoteOnAsNoteOff();
+
+        if (inputFilter(inChannel))
+        {
+            if (mMessage.getType() == SystemExclusive)
+            {
+                launchCallback();
+            }
+            else
+            {
+                outQueue.push(mMessage);
+            }
+            matchCount++;
+        }
+
+        thruFilter(inChannel);
+    }
+
+    return matchCount;
+}
+
+// -----------------------------------------------------------------------------
+
+// Private method: process a freshly parsed message
+template<class SerialPort, class Settings>
+inline bool MidiInterface<SerialPort, Settings>::handleMessage(Channel inChannel)
+{
     handleNullVelocityNoteOnAsNoteOff();
     const bool channelMatch = inputFilter(inChannel);
 
@@ -484,117 +758,145 @@ inline bool MidiInterface<SerialPort, Settings>::read(Channel inChannel)
     return channelMatch;
 }
 
-// -----------------------------------------------------------------------------
-
 // Private method: MIDI parser
 template<class SerialPort, class Settings>
 bool MidiInterface<SerialPort, Settings>::parse()
 {
-    if (mSerial.available() == 0)
-        // No data available.
-        return false;
-
     // Parsing algorithm:
-    // Get a byte from the serial buffer.
+    // Get bytes from the serial buffer and feed them to parseByte,
+    // until a message is assembled or the buffer is empty.
+    // With Use1ByteParsing, only one byte is extracted per call.
+    while (mSerial.available() != 0)
+    {
+        if (parseByte(mSerial.read()))
+            return true;
+
+        if (Settings::Use1ByteParsing)
+        {
+            // Message is not complete.
+            return false;
+        }
+    }
+
+    // No data available.
+    return false;
+}
+
+// Private method: feed one byte to the parser state machine.
+// Returns true when this byte completed a message, which is then stored.
+template<class SerialPort, class Settings>
+bool MidiInterface<SerialPort, Settings>::parseByte(byte inByte)
+{
     // If there is no pending message to be recomposed, start a new one.
     //  - Find type and channel (if pertinent)
-    //  - Look for other bytes in buffer, call parser recursively,
-    //    until the message is assembled or the buffer is empty.
-    // Else, add the extracted byte to the pending message, and check validity.
+    //  - Find the expected length of the message from its status byte.
+    // Else, add the received byte to the pending message, and check validity.
     // When the message is done, store it.
 
-    const byte extracted = mSerial.read();
+    mReceiveTimestamps.readByte(mSerial);
 
-    if (mPendingMessageIndex == 0)
+    if (mThruFilterMode == Raw && mThruActivated)
     {
-        // Start a new pending message
-        mPendingMessage[0] = extracted;
-
-        // Check for running status first
-        if (isChannelMessage(getTypeFromStatusByte(mRunningStatus_RX)))
-        {
-            // Only these types allow Running Status
+        thruByte(inByte);
+    }
 
-            // If the status byte is not received, prepend it
-            // to the pending message
-            if (extracted < 0x80)
-            {
-                mPendingMessage[0]   = mRunningStatus_RX;
-                mPendingMessage[1]   = extracted;
-                mPendingMessageIndex = 1;
-            }
-            // Else: well, we received another status byte,
-            // so the running status does not apply here.
-            // It will be updated upon completion of this message.
-        }
+    // Type, length and flags of the status byte, in a single lookup.
+    const uint16_t info = getStatusInfo(inByte);
 
-        switch (getTypeFromStatusByte(mPendingMessage[0]))
-        {
-            // 1 byte messages
-            case Start:
-            case Continue:
-            case Stop:
-            case Clock:
-            case ActiveSensing:
-            case SystemReset:
-            case TuneRequest:
-                // Handle the message type directly here.
-                mMessage.type    = getTypeFromStatusByte(mPendingMessage[0]);
-                mMessage.channel = 0;
-                mMessage.data1   = 0;
-                mMessage.data2   = 0;
-                mMessage.valid   = true;
-
-                // \fix Running Status broken when receiving Clock messages.
-                // Do not reset all input attributes, Running Status must remain unchanged.
-                //resetInput();
+    if (info & StatusRealTime)
+    {
+        // Real Time messages can come anywhere, even in the middle of another
+        // message, which is left as is (and so is the running status).
+        // Undefined Real Time status (0xf9, 0xfd) have no length: ignored.
+        if ((info & StatusLengthMask) == 0)
+            return false;
 
-                // We still need to reset these
-                mPendingMessageIndex = 0;
-                mPendingMessageExpectedLenght = 0;
+        mMessage.status  = inByte;
+        mMessage.data1   = 0;
+        mMessage.data2   = 0;
+        mMessage.flags   = PackedMessage::Valid;
+        mReceiveTimestamps.completeRealTime();
+        return true;
+    }
 
-                return true;
-                break;
+    if (mPendingMessageIndex != 0 && inByte >= 0x80 && inByte != 0xf7)
+    {
+        // A status byte other than Real Time or EOX in the middle of a message:
+        // the pending message was truncated, drop it and start a new one.
+        // A streamed SysEx ends with an aborted chunk, so that it can be
+        // told apart from a complete one.
+        if (mPendingMessage[0] == SystemExclusive && mCallbacks.hasSystemExclusiveChunkCallback())
+        {
+            launchSysExChunkCallback(SysExChunkAborted);
+        }
+        mPendingMessageIndex = 0;
+        mPendingMessageExpectedLenght = 0;
+    }
 
-                // 2 bytes messages
-            case ProgramChange:
-            case AfterTouchChannel:
-            case TimeCodeQuarterFrame:
-            case SongSelect:
-                mPendingMessageExpectedLenght = 2;
-                break;
+    if (mPendingMessageIndex == 0)
+    {
+        // Start a new pending message
+        mPendingMessage[0] = inByte;
+        mReceiveTimestamps.startMessage();
+        byte length = (info & StatusLengthMask) >> StatusLengthShift;
 
-                // 3 bytes messages
-            case NoteOn:
-            case NoteOff:
-            case ControlChange:
-            case PitchBend:
-            case AfterTouchPoly:
-            case SongPosition:
-                mPendingMessageExpectedLenght = 3;
-                break;
+        // Check for running status first: it is only kept for Channel
+        // messages, and applies if the status byte is not received.
+        if (mRunningStatus_RX != InvalidType && inByte < 0x80)
+        {
+            // Prepend it to the pending message
+            mPendingMessage[0]   = mRunningStatus_RX;
+            mPendingMessage[1]   = inByte;
+            mPendingMessageIndex = 1;
+            length = getMessageLength(mRunningStatus_RX);
+        }
+        // Else: well, we received another status byte,
+        // so the running status does not apply here.
+        // It will be updated upon completion of this message.
 
-            case SystemExclusive:
-                // The message can be any lenght
-                // between 3 and MidiMessage::sSysExMaxSize bytes
-                mPendingMessageExpectedLenght = MidiMessage::sSysExMaxSize;
-                mRunningStatus_RX = InvalidType;
-                mMessage.sysexArray[0] = SystemExclusive;
-                break;
+        if (length == 1)
+        {
+            // TuneRequest, the only 1 byte message that is not Real Time.
+            // It is a System Common message: it cancels running status.
+            mMessage.status  = mPendingMessage[0];
+            mMessage.data1   = 0;
+            mMessage.data2   = 0;
+            mMessage.flags   = PackedMessage::Valid;
+            mReceiveTimestamps.completeMessage();
 
-            case InvalidType:
-            default:
-                // This is obviously wrong. Let's get the hell out'a here.
-                resetInput();
-                return false;
-                break;
+            mPendingMessageIndex = 0;
+            mPendingMessageExpectedLenght = 0;
+            mRunningStatus_RX = InvalidType;
+            return true;
+        }
+        else if (length != 0)
+        {
+            // 2 and 3 bytes messages
+            mPendingMessageExpectedLenght = length;
+        }
+        else if (mPendingMessage[0] == SystemExclusive && mSysExSize >= 2)
+        {
+            // The message can be any lenght
+            // between 3 and mSysExSize bytes
+            mPendingMessageExpectedLenght = mSysExSize;
+            mRunningStatus_RX = InvalidType;
+            mSysExArray[0] = SystemExclusive;
+            mSysExLength = 1;
+            mSysExChunkFlags = SysExChunkFirst;
+        }
+        else
+        {
+            // Data byte without running status, undefined status, or SysEx
+            // without a buffer to store it (its data bytes will be ignored).
+            // This is obviously wrong. Let's get the hell out'a here.
+            resetInput();
+            return false;
         }
 
         if (mPendingMessageIndex >= (mPendingMessageExpectedLenght - 1))
         {
             // Reception complete
-            mMessage.type    = getTypeFromStatusByte(mPendingMessage[0]);
-            mMessage.channel = getChannelFromStatusByte(mPendingMessage[0]);
+            mMessage.status  = mPendingMessage[0];
             mMessage.data1   = mPendingMessage[1];
 
             // Save data2 only if applicable
@@ -605,7 +907,8 @@ bool MidiInterface<SerialPort, Settings>::parse()
 
             mPendingMessageIndex = 0;
             mPendingMessageExpectedLenght = 0;
-            mMessage.valid = true;
+            mMessage.flags = PackedMessage::Valid;
+            mReceiveTimestamps.completeMessage();
             return true;
         }
         else
@@ -614,106 +917,82 @@ bool MidiInterface<SerialPort, Settings>::parse()
             mPendingMessageIndex++;
         }
 
-        if (Settings::Use1ByteParsing)
-        {
-            // Message is not complete.
-            return false;
-        }
-        else
-        {
-            // Call the parser recursively
-            // to parse the rest of the message.
-            return parse();
-        }
+        // Message is not complete.
+        return false;
     }
     else
     {
-        // First, test if this is a status byte
-        if (extracted >= 0x80)
+        // Real Time bytes were handled above, and other status bytes have
+        // started a new message: only EOX can get here.
+        if (inByte == 0xf7)
         {
-            // Reception of status bytes in the middle of an uncompleted message
-            // are allowed only for interleaved Real Time message or EOX
-            switch (extracted)
+            if (mPendingMessage[0] == SystemExclusive)
             {
-                case Clock:
-                case Start:
-                case Continue:
-                case Stop:
-                case ActiveSensing:
-                case SystemReset:
-
-                    // Here we will have to extract the one-byte message,
-                    // pass it to the structure for being read outside
-                    // the MIDI class, and recompose the message it was
-                    // interleaved into. Oh, and without killing the running status..
-                    // This is done by leaving the pending message as is,
-                    // it will be completed on next calls.
-
-                    mMessage.type    = (MidiType)extracted;
-                    mMessage.data1   = 0;
-                    mMessage.data2   = 0;
-                    mMessage.channel = 0;
-                    mMessage.valid   = true;
-                    return true;
-
-                    break;
-
-                    // End of Exclusive
-                case 0xf7:
-                    if (mMessage.sysexArray[0] == SystemExclusive)
-                    {
-                        // Store the last byte (EOX)
-                        mMessage.sysexArray[mPendingMessageIndex++] = 0xf7;
-                        mMessage.type = SystemExclusive;
-
-                        // Get length
-                        mMessage.data1   = mPendingMessageIndex & 0xff; // LSB
-                        mMessage.data2   = mPendingMessageIndex >> 8;   // MSB
-                        mMessage.channel = 0;
-                        mMessage.valid   = true;
-
-                        resetInput();
-                        return true;
-                    }
-                    else
-                    {
-                        // Well well well.. error.
-                        resetInput();
-                        return false;
-                    }
-
-                    break;
-                default:
-                    break;
+                if (mCallbacks.hasSystemExclusiveChunkCallback())
+                {
+                    // Streamed SysEx: deliver the last chunk,
+                    // there is no message to read.
+                    if (mSysExLength == mSysExSize)
+                        launchSysExChunkCallback(0);
+
+                    mSysExArray[mSysExLength++] = 0xf7;
+                    launchSysExChunkCallback(SysExChunkLast);
+
+                    resetInput();
+                    return false;
+                }
+
+                // Store the last byte (EOX)
+                mSysExArray[mSysExLength++] = 0xf7;
+                mMessage.status = SystemExclusive;
+
+                // Get length
+                mMessage.data1   = mSysExLength & 0xff; // LSB
+                mMessage.data2   = mSysExLength >> 8;   // MSB
+                mMessage.flags   = PackedMessage::Valid;
+                mReceiveTimestamps.completeMessage();
+
+                resetInput();
+                return true;
             }
+
+            // Well well well.. error.
+            resetInput();
+            return false;
         }
 
-        // Add extracted data byte to pending message
+        // Add received data byte to pending SysEx
         if (mPendingMessage[0] == SystemExclusive)
-            mMessage.sysexArray[mPendingMessageIndex] = extracted;
-        else
-            mPendingMessage[mPendingMessageIndex] = extracted;
-
-        // Now we are going to check if we have reached the end of the message
-        if (mPendingMessageIndex >= (mPendingMessageExpectedLenght - 1))
         {
-            // "FML" case: fall down here with an overflown SysEx..
-            // This means we received the last possible data byte that can fit
-            // the buffer. If this happens, try increasing MidiMessage::sSysExMaxSize.
-            if (mPendingMessage[0] == SystemExclusive)
+            if (mCallbacks.hasSystemExclusiveChunkCallback())
+            {
+                // Streamed SysEx: the buffer is full, deliver it and reuse it.
+                if (mSysExLength == mSysExSize)
+                    launchSysExChunkCallback(0);
+            }
+            else if (mSysExLength >= mSysExSize - 1)
             {
+                // "FML" case: fall down here with an overflown SysEx..
+                // This means we received the last possible data byte that can fit
+                // the buffer. If this happens, try increasing Settings::SysExMaxSize,
+                // supply a larger buffer with setSysExBuffer, or stream SysEx
+                // with setHandleSystemExclusiveChunk.
                 resetInput();
                 return false;
             }
 
-            mMessage.type = getTypeFromStatusByte(mPendingMessage[0]);
+            mSysExArray[mSysExLength++] = inByte;
+            return false;
+        }
 
-            if (isChannelMessage(mMessage.type))
-                mMessage.channel = getChannelFromStatusByte(mPendingMessage[0]);
-            else
-                mMessage.channel = 0;
+        // Add received data byte to pending message
+        mPendingMessage[mPendingMessageIndex] = inByte;
 
-            mMessage.data1 = mPendingMessage[1];
+        // Now we are going to check if we have reached the end of the message
+        if (mPendingMessageIndex >= (mPendingMessageExpectedLenght - 1))
+        {
+            mMessage.status = mPendingMessage[0];
+            mMessage.data1  = mPendingMessage[1];
 
             // Save data2 only if applicable
             if (mPendingMessageExpectedLenght == 3)
@@ -725,27 +1004,12 @@ bool MidiInterface<SerialPort, Settings>::parse()
             mPendingMessageIndex = 0;
             mPendingMessageExpectedLenght = 0;
 
-            mMessage.valid = true;
+            mMessage.flags = PackedMessage::Valid;
+            mReceiveTimestamps.completeMessage();
 
-            // Activate running status (if enabled for the received type)
-            switch (mMessage.type)
-            {
-                case NoteOff:
-                case NoteOn:
-                case AfterTouchPoly:
-                case ControlChange:
-                case ProgramChange:
-                case AfterTouchChannel:
-                case PitchBend:
-                    // Running status enabled: store it from received message
-                    mRunningStatus_RX = mPendingMessage[0];
-                    break;
-
-                default:
-                    // No running status
-                    mRunningStatus_RX = InvalidType;
-                    break;
-            }
+            // Activate running status for Channel messages,
+            // System Common messages cancel it.
+            mRunningStatus_RX = mPendingMessage[0] < 0xf0 ? mPendingMessage[0] : byte(InvalidType);
             return true;
         }
         else
@@ -753,16 +1017,8 @@ bool MidiInterface<SerialPort, Settings>::parse()
             // Then update the index of the pending message.
             mPendingMessageIndex++;
 
-            if (Settings::Use1ByteParsing)
-            {
-                // Message is not complete.
-                return false;
-            }
-            else
-            {
-                // Call the parser recursively to parse the rest of the message.
-                return parse();
-            }
+            // Message is not complete.
+            return false;
         }
     }
 }
@@ -774,25 +1030,25 @@ inline void MidiInterface<SerialPort, Settings>::handleNullVelocityNoteOnAsNoteO
     if (Settings::HandleNullVelocityNoteOnAsNoteOff &&
         getType() == NoteOn && getData2() == 0)
     {
-        mMessage.type = NoteOff;
+        mMessage.status = NoteOff | (mMessage.status & 0x0f);
     }
 }
 
 // Private method: check if the received message is on the listened channel
 template<class SerialPort, class Settings>
-inline bool MidiInterface<SerialPort, Settings>::inputFilter(Channel inChannel)
+inline bool MidiInterface<SerialPort, Settings>::inputFilter(Channel)
 {
     // This method handles recognition of channel
     // (to know if the message is destinated to the Arduino)
 
-    if (mMessage.type == InvalidType)
+    if (mMessage.getType() == InvalidType)
         return false;
 
     // First, check if the received message is Channel
-    if (mMessage.type >= NoteOff && mMessage.type <= PitchBend)
+    if (mMessage.getType() >= NoteOff && mMessage.getType() <= PitchBend)
     {
         // Then we need to know if we listen to it
-        if ((mMessage.channel == mInputChannel) ||
+        if ((mMessage.getChannel() == mInputChannel) ||
             (mInputChannel == MIDI_CHANNEL_OMNI))
         {
             return true;
@@ -828,7 +1084,7 @@ inline void MidiInterface<SerialPort, Settings>::resetInput()
 template<class SerialPort, class Settings>
 inline MidiType MidiInterface<SerialPort, Settings>::getType() const
 {
-    return mMessage.type;
+    return mMessage.getType();
 }
 
 /*! \brief Get the channel of the message stored in the structure.
@@ -839,7 +1095,7 @@ inline MidiType MidiInterface<SerialPort, Settings>::getType() const
 template<class SerialPort, class Settings>
 inline Channel MidiInterface<SerialPort, Settings>::getChannel() const
 {
-    return mMessage.channel;
+    return mMessage.getChannel();
 }
 
 /*! \brief Get the first data byte of the last received message. */
@@ -863,7 +1119,7 @@ inline DataByte MidiInterface<SerialPort, Settings>::getData2() const
 template<class SerialPort, class Settings>
 inline const byte* MidiInterface<SerialPort, Settings>::getSysExArray() const
 {
-    return mMessage.sysexArray;
+    return mSysExArray;
 }
 
 /*! \brief Get the lenght of the System Exclusive array.
@@ -874,14 +1130,58 @@ inline const byte* MidiInterface<SerialPort, Settings>::getSysExArray() const
 template<class SerialPort, class Settings>
 inline unsigned MidiInterface<SerialPort, Settings>::getSysExArrayLength() const
 {
-    return mMessage.getSysExSize();
+    const unsigned size = unsigned(mMessage.data2) << 8 | mMessage.data1;
+    return size > mSysExSize ? mSysExSize : size;
+}
+
+/*! \brief Get the arrival time of the last message received.
+
+ This is the time of its first byte (its status byte, or its first data byte
+ with running status), as given by the serial port: micros() with midi::Uart.
+ Only with Settings::UseReceiveTimestamps, it is 0 otherwise.
+ Messages queued by readAll(MessageQueue&) don't keep their time.
+ */
+template<class SerialPort, class Settings>
+inline unsigned long MidiInterface<SerialPort, Settings>::getTimestamp() const
+{
+    return mReceiveTimestamps.getMessageTime();
 }
 
 /*! \brief Check if a valid message is stored in the structure. */
 template<class SerialPort, class Settings>
 inline bool MidiInterface<SerialPort, Settings>::check() const
 {
-    return mMessage.valid;
+    return (mMessage.flags & PackedMessage::Valid) != 0;
+}
+
+/*! \brief Set where received System Exclusive messages are stored.
+
+ By default, they go to a buffer of Settings::SysExMaxSize bytes that is part
+ of the MidiInterface. Set SysExMaxSize to 0 to get rid of it, and either
+ supply a buffer here (that can be shared, or bigger), or let SysEx messages
+ be ignored.
+ With a SysEx chunk callback, this buffer only needs to hold one chunk.
+ @see setHandleSystemExclusiveChunk
+ \param inBuffer The buffer, or 0 to go back to the default one.
+ \param inSize Its size in bytes, including the 0xf0 and 0xf7 boundaries.
+ */
+template<class SerialPort, class Settings>
+inline void MidiInterface<SerialPort, Settings>::setSysExBuffer(byte* inBuffer, unsigned inSize)
+{
+    if (inBuffer != 0)
+    {
+        mSysExArray = inBuffer;
+        mSysExSize  = inSize;
+    }
+    else
+    {
+        mSysExArray = mSysExStorage.getArray();
+        mSysExSize  = mSysExStorage.sSize;
+    }
+
+    // Drop any SysEx being received in the previous buffer.
+    if (mPendingMessage[0] == SystemExclusive && mPendingMessageIndex != 0)
+        resetInput();
 }
 
 // -----------------------------------------------------------------------------
@@ -910,24 +1210,21 @@ inline void MidiInterface<SerialPort, Settings>::setInputChannel(Channel inChann
  made public so you can handle MidiTypes more easily.
  */
 template<class SerialPort, class Settings>
-MidiType MidiInterface<SerialPort, Settings>::getTypeFromStatusByte(byte inStatus)
+inline MidiType MidiInterface<SerialPort, Settings>::getTypeFromStatusByte(byte inStatus)
 {
-    if ((inStatus  < 0x80) ||
-        (inStatus == 0xf4) ||
-        (inStatus == 0xf5) ||
-        (inStatus == 0xf9) ||
-        (inStatus == 0xfD))
-    {
-        // Data bytes and undefined.
-        return InvalidType;
-    }
-    if (inStatus < 0xf0)
-    {
-        // Channel message, remove channel nibble.
-        return MidiType(inStatus & 0xf0);
-    }
+    // InvalidType for data bytes and undefined status.
+    return getStatusType(inStatus);
+}
+
+/*! \brief Get the length of a message from its status byte, status included.
 
-    return MidiType(inStatus);
+ \return 1 to 3 for fixed length messages, 0 for System Exclusive (whose
+ length is only known when EOX is received), data bytes and undefined status.
+ */
+template<class SerialPort, class Settings>
+inline byte MidiInterface<SerialPort, Settings>::getMessageLength(byte inStatus)
+{
+    return MIDI_NAMESPACE::getMessageLength(inStatus);
 }
 
 /*! \brief Returns channel in the range 1-16
@@ -939,15 +1236,9 @@ inline Channel MidiInterface<SerialPort, Settings>::getChannelFromStatusByte(byt
 }
 
 template<class SerialPort, class Settings>
-bool MidiInterface<SerialPort, Settings>::isChannelMessage(MidiType inType)
+inline bool MidiInterface<SerialPort, Settings>::isChannelMessage(MidiType inType)
 {
-    return (inType == NoteOff           ||
-            inType == NoteOn            ||
-            inType == ControlChange     ||
-            inType == AfterTouchPoly    ||
-            inType == AfterTouchChannel ||
-            inType == PitchBend         ||
-            inType == ProgramChange);
+    return (getStatusInfo(inType) & StatusChannel) != 0;
 }
 
 // -----------------------------------------------------------------------------
@@ -956,24 +1247,25 @@ bool MidiInterface<SerialPort, Settings>::isChannelMessage(MidiType inType)
  @{
  */
 
-template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleNoteOff(void (*fptr)(byte channel, byte note, byte velocity))          { mNoteOffCallback              = fptr; }
-template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleNoteOn(void (*fptr)(byte channel, byte note, byte velocity))           { mNoteOnCallback               = fptr; }
-template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleAfterTouchPoly(void (*fptr)(byte channel, byte note, byte pressure))   { mAfterTouchPolyCallback       = fptr; }
-template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleControlChange(void (*fptr)(byte channel, byte number, byte value))     { mControlChangeCallback        = fptr; }
-template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleProgramChange(void (*fptr)(byte channel, byte number))                 { mProgramChangeCallback        = fptr; }
-template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleAfterTouchChannel(void (*fptr)(byte channel, byte pressure))           { mAfterTouchChannelCallback    = fptr; }
-template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandlePitchBend(void (*fptr)(byte channel, int bend))                        { mPitchBendCallback            = fptr; }
-template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleSystemExclusive(void (*fptr)(byte* array, unsigned size))              { mSystemExclusiveCallback      = fptr; }
-template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleTimeCodeQuarterFrame(void (*fptr)(byte data))                          { mTimeCodeQuarterFrameCallback = fptr; }
-template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleSongPosition(void (*fptr)(unsigned beats))                             { mSongPositionCallback         = fptr; }
-template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleSongSelect(void (*fptr)(byte songnumber))                              { mSongSelectCallback           = fptr; }
-template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleTuneRequest(void (*fptr)(void))                                        { mTuneRequestCallback          = fptr; }
-template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleClock(void (*fptr)(void))                                              { mClockCallback                = fptr; }
-template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleStart(void (*fptr)(void))                                              { mStartCallback                = fptr; }
-template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleContinue(void (*fptr)(void))                                           { mContinueCallback             = fptr; }
-template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleStop(void (*fptr)(void))                                               { mStopCallback                 = fptr; }
-template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleActiveSensing(void (*fptr)(void))                                      { mActiveSensingCallback        = fptr; }
-template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleSystemReset(void (*fptr)(void))                                        { mSystemResetCallback          = fptr; }
+template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleNoteOff(void (*fptr)(byte channel, byte note, byte velocity))          { mCallbacks.mNoteOffCallback              = fptr; }
+template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleNoteOn(void (*fptr)(byte channel, byte note, byte velocity))           { mCallbacks.mNoteOnCallback               = fptr; }
+template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleAfterTouchPoly(void (*fptr)(byte channel, byte note, byte pressure))   { mCallbacks.mAfterTouchPolyCallback       = fptr; }
+template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleControlChange(void (*fptr)(byte channel, byte number, byte value))     { mCallbacks.mControlChangeCallback        = fptr; }
+template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleProgramChange(void (*fptr)(byte channel, byte number))                 { mCallbacks.mProgramChangeCallback        = fptr; }
+template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleAfterTouchChannel(void (*fptr)(byte channel, byte pressure))           { mCallbacks.mAfterTouchChannelCallback    = fptr; }
+template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandlePitchBend(void (*fptr)(byte channel, int bend))                        { mCallbacks.mPitchBendCallback            = fptr; }
+template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleSystemExclusive(void (*fptr)(byte* array, unsigned size))              { mCallbacks.mSystemExclusiveCallback      = fptr; }
+template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleSystemExclusiveChunk(void (*fptr)(byte* array, unsigned size, byte flags)) { mCallbacks.mSystemExclusiveChunkCallback = fptr; }
+template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleTimeCodeQuarterFrame(void (*fptr)(byte data))                          { mCallbacks.mTimeCodeQuarterFrameCallback = fptr; }
+template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleSongPosition(void (*fptr)(unsigned beats))                             { mCallbacks.mSongPositionCallback         = fptr; }
+template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleSongSelect(void (*fptr)(byte songnumber))                              { mCallbacks.mSongSelectCallback           = fptr; }
+template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleTuneRequest(void (*fptr)(void))                                        { mCallbacks.mTuneRequestCallback          = fptr; }
+template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleClock(void (*fptr)(void))                                              { mCallbacks.mClockCallback                = fptr; }
+template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleStart(void (*fptr)(void))                                              { mCallbacks.mStartCallback                = fptr; }
+template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleContinue(void (*fptr)(void))                                           { mCallbacks.mContinueCallback             = fptr; }
+template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleStop(void (*fptr)(void))                                               { mCallbacks.mStopCallback                 = fptr; }
+template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleActiveSensing(void (*fptr)(void))                                      { mCallbacks.mActiveSensingCallback        = fptr; }
+template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settings>::setHandleSystemReset(void (*fptr)(void))                                        { mCallbacks.mSystemResetCallback          = fptr; }
 
 /*! \brief Detach an external function from the given type.
 
@@ -984,67 +1276,140 @@ template<class SerialPort, class Settings> void MidiInterface<SerialPort, Settin
 template<class SerialPort, class Settings>
 void MidiInterface<SerialPort, Settings>::disconnectCallbackFromType(MidiType inType)
 {
-    switch (inType)
-    {
-        case NoteOff:               mNoteOffCallback                = 0; break;
-        case NoteOn:                mNoteOnCallback                 = 0; break;
-        case AfterTouchPoly:        mAfterTouchPolyCallback         = 0; break;
-        case ControlChange:         mControlChangeCallback          = 0; break;
-        case ProgramChange:         mProgramChangeCallback          = 0; break;
-        case AfterTouchChannel:     mAfterTouchChannelCallback      = 0; break;
-        case PitchBend:             mPitchBendCallback              = 0; break;
-        case SystemExclusive:       mSystemExclusiveCallback        = 0; break;
-        case TimeCodeQuarterFrame:  mTimeCodeQuarterFrameCallback   = 0; break;
-        case SongPosition:          mSongPositionCallback           = 0; break;
-        case SongSelect:            mSongSelectCallback             = 0; break;
-        case TuneRequest:           mTuneRequestCallback            = 0; break;
-        case Clock:                 mClockCallback                  = 0; break;
-        case Start:                 mStartCallback                  = 0; break;
-        case Continue:              mContinueCallback               = 0; break;
-        case Stop:                  mStopCallback                   = 0; break;
-        case ActiveSensing:         mActiveSensingCallback          = 0; break;
-        case SystemReset:           mSystemResetCallback            = 0; break;
-        default:
-            break;
-    }
+    mCallbacks.disconnect(inType);
 }
 
 /*! @} */ // End of doc group MIDI Callbacks
 
+// Private - deliver the SysEx bytes received so far, and empty the buffer.
+template<class SerialPort, class Settings>
+void MidiInterface<SerialPort, Settings>::launchSysExChunkCallback(byte inFlags)
+{
+    mCallbacks.handleSystemExclusiveChunk(mSysExArray, mSysExLength, mSysExChunkFlags | inFlags);
+    mSysExChunkFlags = 0;
+    mSysExLength = 0;
+}
+
 // Private - launch callback function based on received type.
 template<class SerialPort, class Settings>
 void MidiInterface<SerialPort, Settings>::launchCallback()
 {
-    // The order is mixed to allow frequent messages to trigger their callback faster.
-    switch (mMessage.type)
+    dispatch(mCallbacks);
+}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Call the method of a compile-time handler for the last received message.
+
+ Use it after read() returned true, instead of (or on top of) callbacks.
+ @see Handler
+ */
+template<class SerialPort, class Settings>
+template<class MessageHandler>
+inline void MidiInterface<SerialPort, Settings>::dispatch(MessageHandler& inHandler) const
+{
+    dispatch(inHandler, mMessage, mSysExArray, getSysExArrayLength());
+}
+
+/*! \brief Call the method of a compile-time handler for a queued message.
+
+ SysEx payloads are not queued, so System Exclusive messages are ignored.
+ @see Handler
+ @see MessageQueue
+ */
+template<class SerialPort, class Settings>
+template<class MessageHandler>
+inline void MidiInterface<SerialPort, Settings>::dispatch(MessageHandler& inHandler,
+                                                          const PackedMessage& inMessage)
+{
+    dispatch(inHandler, inMessage, 0, 0);
+}
+
+/*! \brief Drain the serial buffer into a compile-time handler, using the main input channel.
+ @see dispatchAll(MessageHandler&, Channel)
+ */
+template<class SerialPort, class Settings>
+template<class MessageHandler>
+inline unsigned MidiInterface<SerialPort, Settings>::dispatchAll(MessageHandler& inHandler)
+{
+    return dispatchAll(inHandler, mInputChannel);
+}
+
+/*! \brief Drain the serial buffer into a compile-time handler, on a specified channel.
+
+ Works like readAll(Channel), but calls the methods of inHandler instead of
+ the callbacks. Thru is handled as usual.
+ \return The number of messages that matched the input channel.
+ @see Handler
+ */
+template<class SerialPort, class Settings>
+template<class MessageHandler>
+unsigned MidiInterface<SerialPort, Settings>::dispatchAll(MessageHandler& inHandler,
+                                                          Channel inChannel)
+{
+    if (inChannel >= MIDI_CHANNEL_OFF)
+        return 0; // MIDI Input disabled.
+
+    unsigned matchCount = 0;
+    for (int available = mSerial.available(); available > 0; --available)
+    {
+        if (!parseByte(mSerial.read()))
+            continue;
+
+        handleNullVelocityNoteOnAsNoteOff();
+
+        if (inputFilter(inChannel))
+        {
+            dispatch(inHandler);
+            matchCount++;
+        }
+
+        thruFilter(inChannel);
+    }
+
+    return matchCount;
+}
+
+// Private - call the handler method matching the message type.
+template<class SerialPort, class Settings>
+template<class MessageHandler>
+inline void MidiInterface<SerialPort, Settings>::dispatch(MessageHandler& inHandler,
+                                                          const PackedMessage& inMessage,
+                                                          byte* inSysExArray,
+                                                          unsigned inSysExSize)
+{
+    const Channel channel = inMessage.getChannel();
+
+    // The order is mixed to allow frequent messages to be handled faster.
+    switch (inMessage.getType())
     {
             // Notes
-        case NoteOff:               if (mNoteOffCallback != 0)               mNoteOffCallback(mMessage.channel, mMessage.data1, mMessage.data2);   break;
-        case NoteOn:                if (mNoteOnCallback != 0)                mNoteOnCallback(mMessage.channel, mMessage.data1, mMessage.data2);    break;
+        case NoteOff:               inHandler.handleNoteOff(channel, inMessage.data1, inMessage.data2);         break;
+        case NoteOn:                inHandler.handleNoteOn(channel, inMessage.data1, inMessage.data2);          break;
 
             // Real-time messages
-        case Clock:                 if (mClockCallback != 0)                 mClockCallback();           break;
-        case Start:                 if (mStartCallback != 0)                 mStartCallback();           break;
-        case Continue:              if (mContinueCallback != 0)              mContinueCallback();        break;
-        case Stop:                  if (mStopCallback != 0)                  mStopCallback();            break;
-        case ActiveSensing:         if (mActiveSensingCallback != 0)         mActiveSensingCallback();   break;
+        case Clock:                 inHandler.handleClock();            break;
+        case Start:                 inHandler.handleStart();            break;
+        case Continue:              inHandler.handleContinue();         break;
+        case Stop:                  inHandler.handleStop();             break;
+        case ActiveSensing:         inHandler.handleActiveSensing();    break;
 
             // Continuous controllers
-        case ControlChange:         if (mControlChangeCallback != 0)         mControlChangeCallback(mMessage.channel, mMessage.data1, mMessage.data2);    break;
-        case PitchBend:             if (mPitchBendCallback != 0)             mPitchBendCallback(mMessage.channel, (int)((mMessage.data1 & 0x7f) | ((mMessage.data2 & 0x7f) << 7)) + MIDI_PITCHBEND_MIN); break; // TODO: check this
-        case AfterTouchPoly:        if (mAfterTouchPolyCallback != 0)        mAfterTouchPolyCallback(mMessage.channel, mMessage.data1, mMessage.data2);    break;
-        case AfterTouchChannel:     if (mAfterTouchChannelCallback != 0)     mAfterTouchChannelCallback(mMessage.channel, mMessage.data1);    break;
+        case ControlChange:         inHandler.handleControlChange(channel, inMessage.data1, inMessage.data2);   break;
+        case PitchBend:             inHandler.handlePitchBend(channel, (int)((inMessage.data1 & 0x7f) | ((inMessage.data2 & 0x7f) << 7)) + MIDI_PITCHBEND_MIN); break;
+        case AfterTouchPoly:        inHandler.handleAfterTouchPoly(channel, inMessage.data1, inMessage.data2);  break;
+        case AfterTouchChannel:     inHandler.handleAfterTouchChannel(channel, inMessage.data1);                break;
 
-        case ProgramChange:         if (mProgramChangeCallback != 0)         mProgramChangeCallback(mMessage.channel, mMessage.data1);    break;
-        case SystemExclusive:       if (mSystemExclusiveCallback != 0)       mSystemExclusiveCallback(mMessage.sysexArray, mMessage.getSysExSize());    break;
+        case ProgramChange:         inHandler.handleProgramChange(channel, inMessage.data1);                    break;
+        case SystemExclusive:       if (inSysExArray != 0) inHandler.handleSystemExclusive(inSysExArray, inSysExSize); break;
 
             // Occasional messages
-        case TimeCodeQuarterFrame:  if (mTimeCodeQuarterFrameCallback != 0)  mTimeCodeQuarterFrameCallback(mMessage.data1);    break;
-        case SongPosition:          if (mSongPositionCallback != 0)          mSongPositionCallback((mMessage.data1 & 0x7f) | ((mMessage.data2 & 0x7f) << 7));    break;
-        case SongSelect:            if (mSongSelectCallback != 0)            mSongSelectCallback(mMessage.data1);    break;
-        case TuneRequest:           if (mTuneRequestCallback != 0)           mTuneRequestCallback();    break;
+        case TimeCodeQuarterFrame:  inHandler.handleTimeCodeQuarterFrame(inMessage.data1);  break;
+        case SongPosition:          inHandler.handleSongPosition((inMessage.data1 & 0x7f) | ((inMessage.data2 & 0x7f) << 7)); break;
+        case SongSelect:            inHandler.handleSongSelect(inMessage.data1);    break;
+        case TuneRequest:           inHandler.handleTuneRequest();                  break;
 
-        case SystemReset:           if (mSystemResetCallback != 0)           mSystemResetCallback();    break;
+        case SystemReset:           inHandler.handleSystemReset();                  break;
         case InvalidType:
         default:
             break;
@@ -1102,6 +1467,54 @@ void MidiInterface<SerialPort, Settings>::turnThruOff()
     mThruFilterMode = Off;
 }
 
+/*! \brief Select the channels forwarded by the Raw thru mode.
+ \param inMask Bit 0 for channel 1 to bit 15 for channel 16. All channels are
+ forwarded by default.
+ */
+template<class SerialPort, class Settings>
+inline void MidiInterface<SerialPort, Settings>::setThruChannelMask(uint16_t inMask)
+{
+    mThruChannelMask = inMask;
+}
+
+/*! \brief Select whether a type of message is forwarded by the Raw thru mode.
+ All types are forwarded by default.
+ */
+template<class SerialPort, class Settings>
+inline void MidiInterface<SerialPort, Settings>::setThruTypeFilter(MidiType inType,
+                                                                   bool inForward)
+{
+    if (inForward)
+        mThruTypeMask |= getTypeMaskBit(inType);
+    else
+        mThruTypeMask &= ~getTypeMaskBit(inType);
+}
+
+/*! \brief Send the channel messages forwarded by the Raw thru mode to other
+ channels.
+ \param inMap 16 output channels (1 to 16), one for each input channel, or 0 to
+ keep the channels unchanged. The array is not copied, it must stay alive.
+ */
+template<class SerialPort, class Settings>
+inline void MidiInterface<SerialPort, Settings>::setThruChannelMap(const byte* inMap)
+{
+    mThruChannelMap = inMap;
+}
+
+/*! \brief Transpose the notes forwarded by the Raw thru mode.
+ \param inTransposeTable 16 transpositions in semitones, one for each input
+ channel, or 0 to keep the notes unchanged. The array is not copied, it must
+ stay alive.
+
+ It applies to NoteOn, NoteOff and AfterTouchPoly messages. Notes transposed
+ out of the MIDI range are not forwarded.
+ */
+template<class SerialPort, class Settings>
+inline void MidiInterface<SerialPort, Settings>::setThruTranspose(const int8_t* inTransposeTable)
+{
+    mThruTranspose = inTransposeTable;
+}
+
 /*! @} */ // End of doc group MIDI Thru
 
 // This method is called upon reception of a message
@@ -1111,45 +1524,46 @@ void MidiInterface<SerialPort, Settings>::turnThruOff()
 // - Channel messages are passed to the output whether their channel
 //   is matching the input channel and the filter setting
 template<class SerialPort, class Settings>
-void MidiInterface<SerialPort, Settings>::thruFilter(Channel inChannel)
+void MidiInterface<SerialPort, Settings>::thruFilter(Channel)
 {
     // If the feature is disabled, don't do anything.
-    if (!mThruActivated || (mThruFilterMode == Off))
+    // Raw thru is done as the bytes are parsed, see thruByte.
+    if (!mThruActivated || (mThruFilterMode == Off) || (mThruFilterMode == Raw))
         return;
 
     // First, check if the received message is Channel
-    if (mMessage.type >= NoteOff && mMessage.type <= PitchBend)
+    if (mMessage.getType() >= NoteOff && mMessage.getType() <= PitchBend)
     {
-        const bool filter_condition = ((mMessage.channel == mInputChannel) ||
+        const bool filter_condition = ((mMessage.getChannel() == mInputChannel) ||
                                        (mInputChannel == MIDI_CHANNEL_OMNI));
 
         // Now let's pass it to the output
         switch (mThruFilterMode)
         {
             case Full:
-                send(mMessage.type,
+                send(mMessage.getType(),
                      mMessage.data1,
                      mMessage.data2,
-                     mMessage.channel);
+                     mMessage.getChannel());
                 break;
 
             case SameChannel:
                 if (filter_condition)
                 {
-                    send(mMessage.type,
+                    send(mMessage.getType(),
                          mMessage.data1,
                          mMessage.data2,
-                         mMessage.channel);
+                         mMessage.getChannel());
                 }
                 break;
 
             case DifferentChannel:
                 if (!filter_condition)
                 {
-                    send(mMessage.type,
+                    send(mMessage.getType(),
                          mMessage.data1,
                          mMessage.data2,
-                         mMessage.channel);
+                         mMessage.getChannel());
                 }
                 break;
 
@@ -1166,7 +1580,7 @@ void MidiInterface<SerialPort, Settings>::thruFilter(Channel inChannel)
     else
     {
         // Send the message to the output
-        switch (mMessage.type)
+        switch (mMessage.getType())
         {
                 // Real Time and 1 byte
             case Clock:
@@ -1176,7 +1590,7 @@ void MidiInterface<SerialPort, Settings>::thruFilter(Channel inChannel)
             case ActiveSensing:
             case SystemReset:
             case TuneRequest:
-                sendRealTime(mMessage.type);
+                sendRealTime(mMessage.getType());
                 break;
 
             case SystemExclusive:
@@ -1201,4 +1615,160 @@ void MidiInterface<SerialPort, Settings>::thruFilter(Channel inChannel)
     }
 }
 
+// This method is called for each received byte in Raw thru mode, before it is
+// parsed. It forwards the byte right away when possible, so that thru only
+// adds a byte time of latency. Only the status byte of Channel messages waits
+// for the first data byte, as a transposition can make the message drop.
+// Everything is decided on the status byte, with the masks and tables set with
+// setThruChannelMask, setThruTypeFilter, setThruChannelMap and setThruTranspose.
+// As read() can return in the middle of a message, the sketch can send its own
+// messages between the bytes forwarded. Those cut the forwarded message (which
+// leaves running status off until it ends), so it is written again from its
+// status byte. A SysEx can't be: the rest of it is dropped.
+template<class SerialPort, class Settings>
+void MidiInterface<SerialPort, Settings>::thruByte(byte inByte)
+{
+    if (inByte >= 0xf8)
+    {
+        // Real Time messages can be anywhere, they don't affect the rest.
+        if (getMessageLength(inByte) == 1 && (mThruTypeMask & getTypeMaskBit(inByte)))
+        {
+            writeRealTime(inByte);
+        }
+        return;
+    }
+
+    if (inByte >= 0x80)
+    {
+        const bool sysExOpen = mThruStatus == SystemExclusive && mThruOpen;
+        mThruStatus = 0;
+        mThruIndex  = 0;
+        mThruSkip   = false;
+        mThruOpen   = false;
+
+        if (inByte == 0xf7)
+        {
+            if (sysExOpen)
+            {
+                write(inByte);
+            }
+            return;
+        }
+
+        if (!(mThruTypeMask & getTypeMaskBit(inByte)) ||
+            (inByte != SystemExclusive && getMessageLength(inByte) == 0))
+        {
+            return; // Filtered out or undefined.
+        }
+
+        if (inByte < 0xf0)
+        {
+            mThruChannel = inByte & 0x0f;
+            if (mThruChannelMask & (1 << mThruChannel))
+            {
+                mThruStatus = mThruChannelMap != 0 && mThruChannelMap[mThruChannel] != 0
+                            ? (inByte & 0xf0) | ((mThruChannelMap[mThruChannel] - 1) & 0x0f)
+                            : inByte;
+            }
+            return;
+        }
+
+        // System Exclusive and System Common
+        write(inByte);
+        if (Settings::UseRunningStatus)
+        {
+            mRunningStatus_TX = InvalidType;
+        }
+        if (inByte != TuneRequest)
+        {
+            mThruStatus = inByte;
+            mThruOpen   = true;
+        }
+        return;
+    }
+
+    if (mThruStatus == 0)
+    {
+        return;
+    }
+
+    if (mThruStatus == SystemExclusive)
+    {
+        if (mThruOpen)
+        {
+            write(inByte);
+            mThruOpen = true;
+        }
+        else
+        {
+            mThruStatus = 0; // Cut, drop the rest.
+        }
+        return;
+    }
+
+    if (mThruStatus < 0xf0 && mThruIndex == 0)
+    {
+        DataByte data = inByte;
+        const byte type = mThruStatus & 0xf0;
+
+        if (mThruTranspose != 0 &&
+            (type == NoteOff || type == NoteOn || type == AfterTouchPoly))
+        {
+            const int note = inByte + mThruTranspose[mThruChannel];
+            mThruSkip = note < 0 || note > 127;
+            data = note;
+        }
+
+        if (!mThruSkip)
+        {
+            if (!Settings::UseRunningStatus || mRunningStatus_TX != mThruStatus)
+            {
+                write(mThruStatus);
+            }
+            write(data);
+            mThruData = data;
+        }
+    }
+    else if (!mThruSkip)
+    {
+        if (!mThruOpen)
+        {
+            write(mThruStatus);
+            if (mThruIndex == 1)
+            {
+                write(mThruData);
+            }
+        }
+        write(inByte);
+        if (mThruIndex == 0)
+        {
+            mThruData = inByte;
+        }
+    }
+
+    if (++mThruIndex >= getMessageLength(mThruStatus) - 1)
+    {
+        // Channel messages keep their status for running status, System
+        // Common messages (maybe written again) cancel it.
+        if (!mThruSkip)
+        {
+            mRunningStatus_TX = mThruStatus < 0xf0 ? mThruStatus : StatusByte(InvalidType);
+        }
+        mThruIndex = 0;
+        mThruSkip  = false;
+        mThruOpen  = false;
+        if (mThruStatus >= 0xf0)
+        {
+            mThruStatus = 0;
+        }
+    }
+    else if (!mThruSkip)
+    {
+        // Until the message ends, the messages sent in the middle of it need
+        // their own status byte.
+        mThruOpen = true;
+        mRunningStatus_TX = InvalidType;
+    }
+}
+
 END_MIDI_NAMESPACE
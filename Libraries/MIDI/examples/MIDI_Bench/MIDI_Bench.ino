@@ -1,85 +1,339 @@
 #include <MIDI.h>
+#include <midi_MemorySerial.h>
 
-// This program will measure the time needed to receive, parse and process a
-// NoteOn message.
-// For it to work, please connect RX and TX on the MIDI port:
-// Due, Leonardo and other USB-native Arduinos:     Serial1
-// All other Arduinos:                              Connect pins 2 and 3.
-// The program will then wait for 100 loops and print the results.
+// This program will measure, message by message, the time needed to:
+// - Parse:    read() a message, without callbacks nor Thru,
+// - Dispatch: read() a message and launch its callback,
+// - Thru:     read() a message and send it back to the output,
+// - Send:     send a message.
+// The input is read from a memory buffer and the output is dropped (see
+// midi_MemorySerial.h), so that no loopback cable is needed and the results
+// only depend on the library: it runs the same on the board or on a host.
+// Each time goes to a histogram, from which the median (p50), p99, p99.9
+// and maximum are printed, in nanoseconds, through the USB serial port.
+// On AVR, times are counted in CPU cycles with Timer1, so PWM on the pins of
+// Timer1 won't work. Interrupts are left on: the tail of the distribution
+// shows the cost of the millis() interrupt.
+
+struct BenchSettings : public midi::DefaultSettings
+{
+    static const bool Use1ByteParsing = false;  // One message per read()
+    static const unsigned SysExMaxSize = 0;
+};
+
+static const unsigned sStreamSize = 320;
+static const unsigned sSamples    = 10000;
+
+// -----------------------------------------------------------------------------
+
+#if defined(__AVR__)
+
+typedef uint16_t Ticks;
+
+void beginTicks()
+{
+    // Normal mode, no prescaler: Timer1 counts CPU cycles.
+    TCCR1A = 0;
+    TCCR1B = _BV(CS10);
+}
+
+inline Ticks getTicks()
+{
+    return TCNT1;
+}
+
+unsigned long getNanos(unsigned long inTicks)
+{
+    return inTicks * 1000 / (F_CPU / 1000000);
+}
+
+#elif defined(__linux__)
+
+#include <time.h>
+
+typedef unsigned long Ticks;
+
+void beginTicks()
+{
+}
+
+inline Ticks getTicks()
+{
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000000000UL + time.tv_nsec;
+}
+
+unsigned long getNanos(unsigned long inTicks)
+{
+    return inTicks;
+}
 
-#if defined(ARDUINO_SAM_DUE) || defined(USBCON)
-    // Print through USB and bench with Hardware serial
-    MIDI_CREATE_INSTANCE(HardwareSerial, Serial1, midiBench);
 #else
-    #include <SoftwareSerial.h>
-    SoftwareSerial midiSerial(2,3);
-    MIDI_CREATE_INSTANCE(SoftwareSerial, midiSerial, midiBench);
+
+typedef unsigned long Ticks;
+
+void beginTicks()
+{
+}
+
+inline Ticks getTicks()
+{
+    return micros();
+}
+
+unsigned long getNanos(unsigned long inTicks)
+{
+    return inTicks * 1000;
+}
+
 #endif
 
 // -----------------------------------------------------------------------------
 
-unsigned long gTime_start = 0;
-unsigned long gTime_stop  = 0;
-unsigned gCounter = 0;
-unsigned long gTime_sum   = 0;
-unsigned long gTime_min   = -1;
-unsigned long gTime_max   = 0;
+// Counts times in buckets of logarithmic size: times under 16 ticks get a
+// bucket each, then each power of two is split in 8 buckets, which keeps
+// percentiles within 12.5% with a fixed size, whatever the number of samples.
+class Histogram
+{
+public:
+    static const byte sMaxBits = sizeof(Ticks) < 3 ? 8 * sizeof(Ticks) : 24;
+    static const byte sBucketCount = 16 + 8 * (sMaxBits - 4);
+
+public:
+    void reset()
+    {
+        for (byte i = 0; i < sBucketCount; ++i)
+            mCounts[i] = 0;
+        mCount = 0;
+        mMax = 0;
+    }
+
+    void add(unsigned long inTicks)
+    {
+        mCounts[getBucket(inTicks)]++;
+        mCount++;
+        if (inTicks > mMax) mMax = inTicks;
+    }
+
+    // The time that inPerThousand samples out of 1000 did not exceed,
+    // rounded up to the end of its bucket.
+    unsigned long getPercentile(unsigned inPerThousand) const
+    {
+        const unsigned long target = (mCount * inPerThousand + 999) / 1000;
+        unsigned long count = 0;
+
+        for (byte i = 0; i < sBucketCount; ++i)
+        {
+            count += mCounts[i];
+            if (count >= target && count > 0)
+            {
+                const unsigned long bound = getUpperBound(i);
+                return bound < mMax ? bound : mMax;
+            }
+        }
+        return mMax;
+    }
+
+    unsigned long getMax() const
+    {
+        return mMax;
+    }
+
+private:
+    static byte getBucket(unsigned long inTicks)
+    {
+        if (inTicks < 16)
+            return inTicks;
+
+        byte bit = 4;
+        while (bit < sMaxBits - 1 && (inTicks >> (bit + 1)) != 0)
+            bit++;
+
+        if ((inTicks >> (bit + 1)) != 0)
+            return sBucketCount - 1;
+
+        return 16 + (bit - 4) * 8 + ((inTicks >> (bit - 3)) & 7);
+    }
+
+    static unsigned long getUpperBound(byte inBucket)
+    {
+        if (inBucket < 16)
+            return inBucket;
+
+        const byte bit = (inBucket - 16) / 8 + 4;
+        const unsigned long step = 1UL << (bit - 3);
+        return (8 + (inBucket - 16) % 8 + 1) * step - 1;
+    }
+
+private:
+    unsigned long mCounts[sBucketCount];
+    unsigned long mCount;
+    unsigned long mMax;
+};
+
+// -----------------------------------------------------------------------------
+
+byte gStream[sStreamSize];
+midi::MemorySerial gPort(gStream, sStreamSize);
+
+midi::MidiInterface<midi::MemorySerial, BenchSettings> gMidi(gPort);
+
+Histogram gHistogram;
+Ticks gOverhead = 0;
+unsigned long gMessageCount = 0;
 
 // -----------------------------------------------------------------------------
 
-void handleNoteOn(byte inChannel, byte inNote, byte inVelocity)
+void handleNote(byte, byte, byte)
 {
-    gTime_stop = micros();
+    gMessageCount++;
+}
+
+void handleControlChange(byte, byte, byte)
+{
+    gMessageCount++;
+}
 
-    const unsigned long diff = gTime_stop - gTime_start;
-    gTime_sum += diff;
+void handleClock()
+{
+    gMessageCount++;
+}
+
+// Notes and controllers using running status, interleaved with clocks.
+// The stream only holds whole messages, so that it can be read in a loop.
+void fillStream()
+{
+    byte note = 36;
+
+    for (unsigned size = 0; size + 10 <= sStreamSize; )
+    {
+        gStream[size++] = 0x90;
+        gStream[size++] = note;
+        gStream[size++] = 100;
+        gStream[size++] = 0xf8;
+        gStream[size++] = note;
+        gStream[size++] = 0;
+        gStream[size++] = 0xb0;
+        gStream[size++] = 1;
+        gStream[size++] = note;
+        gStream[size++] = 0xf8;
 
-    if (diff > gTime_max) gTime_max = diff;
-    if (diff < gTime_min) gTime_min = diff;
+        note = note < 84 ? note + 1 : 36;
+    }
+}
 
-    if (gCounter++ >= 1000)
+// The shortest time between two getTicks() calls, subtracted from samples.
+void measureOverhead()
+{
+    gOverhead = ~Ticks(0);
+    for (unsigned i = 0; i < 1000; ++i)
     {
-        const unsigned long average = gTime_sum / (float)gCounter;
+        const Ticks start = getTicks();
+        const Ticks time = getTicks() - start;
+        if (time < gOverhead) gOverhead = time;
+    }
+}
+
+void addSample(Ticks inStart, Ticks inStop)
+{
+    const Ticks time = inStop - inStart;
+    gHistogram.add(time > gOverhead ? time - gOverhead : 0);
+}
+
+void printResult(const char* inName)
+{
+    Serial.print(inName);
+    Serial.print("p50 ");
+    Serial.print(getNanos(gHistogram.getPercentile(500)));
+    Serial.print(" ns, p99 ");
+    Serial.print(getNanos(gHistogram.getPercentile(990)));
+    Serial.print(" ns, p99.9 ");
+    Serial.print(getNanos(gHistogram.getPercentile(999)));
+    Serial.print(" ns, max ");
+    Serial.print(getNanos(gHistogram.getMax()));
+    Serial.println(" ns");
+}
+
+// -----------------------------------------------------------------------------
 
-        Serial.println("Time to receive NoteOn: ");
+// Time sSamples read() calls, each of which parses a whole message.
+void benchRead(const char* inName)
+{
+    gHistogram.reset();
+    gPort.rewind();
 
-        Serial.print("Average: ");
-        Serial.print(average);
-        Serial.println(" microsecs");
+    for (unsigned i = 0; i < sSamples; ++i)
+    {
+        if (gPort.available() == 0)
+            gPort.rewind();
 
-        Serial.print("Min:     ");
-        Serial.print(gTime_min);
-        Serial.println(" microsecs");
+        const Ticks start = getTicks();
+        gMidi.read();
+        const Ticks stop = getTicks();
+        addSample(start, stop);
+    }
 
-        Serial.print("Max:     ");
-        Serial.print(gTime_max);
-        Serial.println(" microsecs");
+    printResult(inName);
+}
 
-        gCounter = 0;
-        gTime_sum = 0;
-        gTime_max = 0;
-        gTime_min = -1;
+void benchSend(const char* inName)
+{
+    gHistogram.reset();
 
-        midiBench.turnThruOff();
+    for (unsigned i = 0; i < sSamples; ++i)
+    {
+        const byte value = i & 0x7f;
+        const Ticks start = getTicks();
+        switch (i & 3)
+        {
+            case 0:  gMidi.sendNoteOn(value, 100, 1);        break;
+            case 1:  gMidi.sendNoteOff(value, 0, 1);         break;
+            case 2:  gMidi.sendControlChange(1, value, 1);   break;
+            default: gMidi.sendRealTime(midi::Clock);        break;
+        }
+        const Ticks stop = getTicks();
+        addSample(start, stop);
     }
+
+    printResult(inName);
 }
 
 // -----------------------------------------------------------------------------
 
 void setup()
 {
-    midiBench.setHandleNoteOn(handleNoteOn);
-    midiBench.begin();
+    fillStream();
+    beginTicks();
+    measureOverhead();
+
+    gMidi.begin(MIDI_CHANNEL_OMNI);
 
     while(!Serial);
     Serial.begin(115200);
     Serial.println("Arduino Ready");
-
-    midiBench.sendNoteOn(69,127,1);
 }
 
 void loop()
 {
-    gTime_start = micros();
-    midiBench.read();
+    gMidi.turnThruOff();
+    benchRead("Parse:    ");
+
+    gMidi.setHandleNoteOn(handleNote);
+    gMidi.setHandleNoteOff(handleNote);
+    gMidi.setHandleControlChange(handleControlChange);
+    gMidi.setHandleClock(handleClock);
+    benchRead("Dispatch: ");
+
+    gMidi.setHandleNoteOn(0);
+    gMidi.setHandleNoteOff(0);
+    gMidi.setHandleControlChange(0);
+    gMidi.setHandleClock(0);
+    gMidi.turnThruOn();
+    benchRead("Thru:     ");
+
+    benchSend("Send:     ");
+    Serial.println();
+
+    delay(1000);
 }
@@ -0,0 +1,196 @@
+#include <MIDI.h>
+
+// This program will measure how late MIDI Clock messages go out when the
+// output is saturated with other messages (bursts of Control Changes and
+// SysEx), first when writing straight to the serial port, then with the
+// output buffer, where Clock messages go out before the other buffered bytes.
+// The output is simulated so that the results don't depend on the board:
+// writing a byte takes the time it would take on a MIDI cable (320 microsecs
+// at 31250 bauds), like with SoftwareSerial, but on a simulated clock.
+// Results are printed through the USB serial port.
+
+static const unsigned long sByteTime    = 320;
+static const unsigned long sClockPeriod = 20833;     // 24 PPQN at 120 BPM
+static const unsigned long sDuration    = 10000000;  // 10 seconds
+static const unsigned long sLoopTime    = 10;        // When nothing is written
+static const byte sMaxPendingClocks     = 8;
+
+// -----------------------------------------------------------------------------
+
+class SimulatedPort
+{
+public:
+    void begin(long)
+    {
+        reset();
+    }
+
+    int available()
+    {
+        return 0;
+    }
+
+    int read()
+    {
+        return -1;
+    }
+
+    size_t write(byte inByte)
+    {
+        if (inByte == midi::Clock && mPendingClocks > 0)
+        {
+            // How late the clock starts going out
+            const unsigned long delay = mTime - mClockDue[mFirstClock];
+            mFirstClock = (mFirstClock + 1) % sMaxPendingClocks;
+            mPendingClocks--;
+
+            mClockCount++;
+            mDelaySum += delay;
+            if (delay > mDelayMax) mDelayMax = delay;
+        }
+        mTime += sByteTime;
+        mWritten = true;
+        return 1;
+    }
+
+public:
+    void reset()
+    {
+        mTime = 0;
+        mWritten = false;
+        mFirstClock = 0;
+        mPendingClocks = 0;
+        mClockCount = 0;
+        mDelaySum = 0;
+        mDelayMax = 0;
+    }
+
+    // To call right before sending a clock that was due at inTime.
+    void expectClock(unsigned long inTime)
+    {
+        if (mPendingClocks < sMaxPendingClocks)
+        {
+            mClockDue[(mFirstClock + mPendingClocks) % sMaxPendingClocks] = inTime;
+            mPendingClocks++;
+        }
+    }
+
+    // Let time pass if the last loop wrote nothing.
+    void endLoop()
+    {
+        if (!mWritten)
+        {
+            mTime += sLoopTime;
+        }
+        mWritten = false;
+    }
+
+public:
+    unsigned long mTime;
+    bool mWritten;
+    unsigned long mClockDue[sMaxPendingClocks];
+    byte mFirstClock;
+    byte mPendingClocks;
+    unsigned long mClockCount;
+    unsigned long mDelaySum;
+    unsigned long mDelayMax;
+};
+
+struct BufferedSettings : public midi::DefaultSettings
+{
+    static const byte TxBufferSize = 64;
+};
+
+SimulatedPort gDirectPort;
+SimulatedPort gBufferedPort;
+
+midi::MidiInterface<SimulatedPort>                   gDirectMidi(gDirectPort);
+midi::MidiInterface<SimulatedPort, BufferedSettings> gBufferedMidi(gBufferedPort);
+
+byte gSysEx[48];
+
+// -----------------------------------------------------------------------------
+
+// Saturate the output: a burst of 8 Control Changes, then a 50 bytes SysEx.
+template<class Midi>
+void sendLoad(Midi& inMidi, byte inStep)
+{
+    if (inStep & 1)
+    {
+        inMidi.sendSysEx(sizeof(gSysEx), gSysEx);
+    }
+    else
+    {
+        for (byte i = 0; i < 8; ++i)
+        {
+            inMidi.sendControlChange(i + 1, inStep & 0x7f, 1);
+        }
+    }
+}
+
+template<class Midi>
+void bench(Midi& inMidi, SimulatedPort& inPort)
+{
+    inMidi.begin();
+    inMidi.turnThruOff();
+
+    unsigned long nextClock = 0;
+    byte step = 0;
+
+    while (inPort.mTime < sDuration)
+    {
+        if (inPort.mTime >= nextClock)
+        {
+            inPort.expectClock(nextClock);
+            inMidi.sendRealTime(midi::Clock);
+            nextClock += sClockPeriod;
+        }
+
+        // Only refill the buffer once it's nearly empty, so that it never
+        // fills up (writing to a full buffer waits like the direct output).
+        if (inMidi.getPendingOutputCount() < 8)
+        {
+            sendLoad(inMidi, step++);
+        }
+
+        inMidi.flush(1);
+        inPort.endLoop();
+    }
+    inMidi.flush();
+}
+
+void printResult(const char* inName, const SimulatedPort& inPort)
+{
+    Serial.print(inName);
+    Serial.print("average clock delay: ");
+    Serial.print(inPort.mDelaySum / inPort.mClockCount);
+    Serial.print(" microsecs, max: ");
+    Serial.print(inPort.mDelayMax);
+    Serial.println(" microsecs");
+}
+
+// -----------------------------------------------------------------------------
+
+void setup()
+{
+    for (byte i = 0; i < sizeof(gSysEx); ++i)
+    {
+        gSysEx[i] = i;
+    }
+
+    while(!Serial);
+    Serial.begin(115200);
+    Serial.println("Arduino Ready");
+}
+
+void loop()
+{
+    bench(gDirectMidi, gDirectPort);
+    bench(gBufferedMidi, gBufferedPort);
+
+    printResult("Direct:   ", gDirectPort);
+    printResult("Buffered: ", gBufferedPort);
+    Serial.println();
+
+    delay(1000);
+}
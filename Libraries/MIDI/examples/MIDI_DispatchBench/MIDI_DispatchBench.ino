@@ -0,0 +1,172 @@
+#include <MIDI.h>
+#include <midi_MemorySerial.h>
+
+// This program will measure how long it takes to get a received message to
+// its handling code, with callbacks (setHandle********) and with a
+// compile-time handler (see midi_Handler.h).
+// The input is read from a memory buffer (see midi_MemorySerial.h), and the
+// same stream is parsed three times:
+// - with callbacks,
+// - with a handler handling the same messages as the callbacks,
+// - with an empty handler, which gives the time spent parsing alone.
+// The handlers go through a MidiInterface without callbacks (see
+// DefaultSettings::UseCallbacks), and the RAM taken by both interfaces is
+// printed as well. Times are in nanosecs per message, as they are a few
+// microsecs at most.
+// Results are printed through the USB serial port.
+
+static const unsigned sStreamSize = 480;
+static const unsigned sPasses     = 100;
+
+byte gStream[sStreamSize];
+midi::MemorySerial gPort(gStream, sStreamSize);
+
+struct HandlerSettings : public midi::DefaultSettings
+{
+    static const bool UseCallbacks = false;
+};
+
+midi::MidiInterface<midi::MemorySerial> gMidi(gPort);
+midi::MidiInterface<midi::MemorySerial, HandlerSettings> gHandlerMidi(gPort);
+
+unsigned long gMessageCount = 0;
+
+// -----------------------------------------------------------------------------
+
+void handleNote(byte, byte, byte)
+{
+    gMessageCount++;
+}
+
+void handleControlChange(byte, byte, byte)
+{
+    gMessageCount++;
+}
+
+void handleClock()
+{
+    gMessageCount++;
+}
+
+struct BenchHandler : public midi::Handler
+{
+    void handleNoteOn(byte, byte, byte)
+    {
+        gMessageCount++;
+    }
+
+    void handleNoteOff(byte, byte, byte)
+    {
+        gMessageCount++;
+    }
+
+    void handleControlChange(byte, byte, byte)
+    {
+        gMessageCount++;
+    }
+
+    void handleClock()
+    {
+        gMessageCount++;
+    }
+};
+
+BenchHandler gHandler;
+midi::Handler gEmptyHandler;
+
+// -----------------------------------------------------------------------------
+
+// Notes and controllers using running status, interleaved with clocks.
+void fillStream()
+{
+    unsigned size = 0;
+    byte note = 36;
+
+    while (size < sStreamSize)
+    {
+        gStream[size++] = 0x90;
+        gStream[size++] = note;
+        gStream[size++] = 100;
+        gStream[size++] = 0xf8;
+        gStream[size++] = note;
+        gStream[size++] = 0;
+        gStream[size++] = 0xb0;
+        gStream[size++] = 1;
+        gStream[size++] = note;
+        gStream[size++] = 0xf8;
+
+        note = note < 84 ? note + 1 : 36;
+    }
+}
+
+void printResult(const char* inName, unsigned long inTime, unsigned long inMessageCount)
+{
+    Serial.print(inName);
+    Serial.print(inTime * 1000 / inMessageCount);
+    Serial.println(" nanosecs per message");
+}
+
+unsigned long benchCallbacks()
+{
+    const unsigned long start = micros();
+    for (unsigned pass = 0; pass < sPasses; ++pass)
+    {
+        gPort.rewind();
+        gMidi.readAll();
+    }
+    return micros() - start;
+}
+
+template<class Handler>
+unsigned long benchHandler(Handler& inHandler)
+{
+    const unsigned long start = micros();
+    for (unsigned pass = 0; pass < sPasses; ++pass)
+    {
+        gPort.rewind();
+        gHandlerMidi.dispatchAll(inHandler);
+    }
+    return micros() - start;
+}
+
+// -----------------------------------------------------------------------------
+
+void setup()
+{
+    fillStream();
+
+    gMidi.begin(MIDI_CHANNEL_OMNI);
+    gMidi.turnThruOff();
+    gMidi.setHandleNoteOn(handleNote);
+    gMidi.setHandleNoteOff(handleNote);
+    gMidi.setHandleControlChange(handleControlChange);
+    gMidi.setHandleClock(handleClock);
+
+    gHandlerMidi.begin(MIDI_CHANNEL_OMNI);
+    gHandlerMidi.turnThruOff();
+
+    while(!Serial);
+    Serial.begin(115200);
+    Serial.println("Arduino Ready");
+}
+
+void loop()
+{
+    gMessageCount = 0;
+    const unsigned long callbackTime = benchCallbacks();
+    const unsigned long messageCount = gMessageCount;
+    const unsigned long handlerTime  = benchHandler(gHandler);
+    const unsigned long parseTime    = benchHandler(gEmptyHandler);
+
+    printResult("Callbacks:     ", callbackTime, messageCount);
+    printResult("Handler:       ", handlerTime, messageCount);
+    printResult("Parsing alone: ", parseTime, messageCount);
+    Serial.print("RAM: ");
+    Serial.print(sizeof(gMidi));
+    Serial.print(" bytes with callbacks, ");
+    Serial.print(sizeof(gHandlerMidi));
+    Serial.println(" bytes without");
+    Serial.println();
+
+    delay(1000);
+}
@@ -1,47 +1,49 @@
 #include <MIDI.h>
+#include <midi_Router.h>
 
-// This example shows how to create two instances of the library to create a merger.
+// This example shows how to use a router to create a merger.
 // There are two MIDI couples of IO, A and B, each using thru and merging with the
 // input from the other node. The result is the following:
 // A out = A in + B in
 // B out = B in + A in
+//
+// The router forwards the bytes as they come, so every message goes through
+// (SysEx and Real Time included), and the messages of the two inputs are never
+// mixed on an output. See midi_Router.h to filter what goes where, or to merge
+// more ports.
 
 #ifdef ARDUINO_SAM_DUE
-    MIDI_CREATE_INSTANCE(HardwareSerial, Serial,     midiA);
-    MIDI_CREATE_INSTANCE(HardwareSerial, Serial1,    midiB);
+    HardwareSerial& serialA = (HardwareSerial&)Serial;
+    HardwareSerial& serialB = (HardwareSerial&)Serial1;
 #else
     #include <SoftwareSerial.h>
-    SoftwareSerial softSerial(2,3);
-    MIDI_CREATE_INSTANCE(HardwareSerial, Serial,     midiA);
-    MIDI_CREATE_INSTANCE(SoftwareSerial, softSerial, midiB);
+    HardwareSerial& serialA = Serial;
+    SoftwareSerial serialB(2,3);
 #endif
 
+static const byte sPortA = 0;
+static const byte sPortB = 1;
+
+midi::Router<2> router;
+
 void setup()
 {
-    // Initiate MIDI communications, listen to all channels
-    midiA.begin(MIDI_CHANNEL_OMNI);
-    midiB.begin(MIDI_CHANNEL_OMNI);
+    serialA.begin(31250);
+    serialB.begin(31250);
+
+    router.connect(sPortA, sPortA);
+    router.connect(sPortA, sPortB);
+    router.connect(sPortB, sPortB);
+    router.connect(sPortB, sPortA);
 }
 
 void loop()
 {
-    if (midiA.read())
-    {
-        // Thru on A has already pushed the input message to out A.
-        // Forward the message to out B as well.
-        midiB.send(midiA.getType(),
-                   midiA.getData1(),
-                   midiA.getData2(),
-                   midiA.getChannel());
-    }
-
-    if (midiB.read())
-    {
-        // Thru on B has already pushed the input message to out B.
-        // Forward the message to out A as well.
-        midiA.send(midiB.getType(),
-                   midiB.getData1(),
-                   midiB.getData2(),
-                   midiB.getChannel());
-    }
+    router.read(sPortA, serialA);
+    router.read(sPortB, serialB);
+
+    // Writing to SoftwareSerial waits for the whole byte to be sent, so send
+    // one byte at a time, and keep reading the inputs in between.
+    router.write(sPortA, serialA, 1);
+    router.write(sPortB, serialB, 1);
 }
@@ -0,0 +1,65 @@
+#include <MIDI.h>
+
+MIDI_CREATE_DEFAULT_INSTANCE();
+
+#ifdef ARDUINO_SAM_DUE // Due has no tone function (yet), overriden to prevent build errors.
+#define tone(...)
+#define noTone(...)
+#endif
+
+// This example shows how to decouple MIDI input from its handling with a
+// message queue: incoming bytes are parsed as soon as they arrive, and the
+// resulting messages are handled later, a few at a time, so slow handling
+// code does not hold back the input.
+
+static const unsigned sAudioOutPin = 10;
+static const unsigned sLedPin      = 13;
+static const byte     sBatchSize   = 4;
+
+midi::MessageQueue<32> gQueue;
+
+// -----------------------------------------------------------------------------
+
+void handleMessage(const midi::PackedMessage& inMessage)
+{
+    switch (inMessage.getType())
+    {
+        case midi::NoteOn:
+            // Stand-in for some slow handling code
+            tone(sAudioOutPin, 100 + inMessage.data1 * 10);
+            delay(2);
+            break;
+
+        case midi::NoteOff:
+            noTone(sAudioOutPin);
+            break;
+
+        default:
+            break;
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+void setup()
+{
+    pinMode(sLedPin, OUTPUT);
+    MIDI.begin(MIDI_CHANNEL_OMNI);
+}
+
+void loop()
+{
+    // Parse everything that was received since the last loop.
+    MIDI.readAll(gQueue);
+
+    // Handle a batch of messages, the rest will wait for the next loop.
+    midi::PackedMessage messages[sBatchSize];
+    const byte count = gQueue.pop(messages, sBatchSize);
+    for (byte i = 0; i < count; ++i)
+    {
+        handleMessage(messages[i]);
+    }
+
+    // The LED lights up if messages had to be dropped: make the queue bigger.
+    digitalWrite(sLedPin, gQueue.getDropCount() != 0 ? HIGH : LOW);
+}
@@ -0,0 +1,42 @@
+#include <MIDI.h>
+#include <midi_Watchdog.h>
+
+// This program will forward everything from MIDI In to MIDI Out, and make
+// sure the notes it forwarded don't stay stuck on the devices downstream:
+// when the keyboard on MIDI In stops sending Active Sensing (cable unplugged,
+// keyboard turned off), a NoteOff is sent for each note still held.
+// The held notes are tracked on all 16 channels, and only those get a NoteOff.
+// The LED is on while notes are held.
+
+MIDI_CREATE_DEFAULT_INSTANCE();
+
+static const unsigned sLedPin = 13;
+
+midi::ActiveSensingWatchdog<1> watchdog;
+midi::HeldNotes heldNotes;
+
+// -----------------------------------------------------------------------------
+
+void setup()
+{
+    pinMode(sLedPin, OUTPUT);
+
+    // Thru is on by default: everything read from MIDI In is forwarded.
+    MIDI.begin(MIDI_CHANNEL_OMNI);
+}
+
+void loop()
+{
+    if (MIDI.read())
+    {
+        watchdog.receive(0, MIDI.getType(), micros());
+        heldNotes.update(MIDI);
+        digitalWrite(sLedPin, heldNotes.isEmpty() ? LOW : HIGH);
+    }
+
+    if (watchdog.update(micros()))
+    {
+        heldNotes.releaseAll(MIDI);
+        digitalWrite(sLedPin, LOW);
+    }
+}
@@ -0,0 +1,420 @@
+#include <MIDI.h>
+#include <midi_NoteList.h>
+
+// This program will measure the time midi::NoteList takes to follow the
+// notes of a monophonic synth, compared to the linked list it replaced in the
+// SimpleSynth example (LinkedNoteList below).
+// Two kinds of input are played, as a keyboard player would:
+// - Chords: 10 note chords, pressed and released one note at a time, the
+//           release order differing from the press order,
+// - Trills: two notes alternating with some overlap, over a held 12 note
+//           chord.
+// After each NoteOn or NoteOff, the synth looks for the note to play: the
+// last, highest and lowest ones are all asked for, so that the times cover
+// the three playing modes.
+// Results are printed through the USB serial port, in nanoseconds per note
+// event, along with a check that both lists picked the same notes.
+// These inputs never hold more notes than the lists can, so midi::NoteList is
+// also checked against a reference list on random input, with lists of 1, 4
+// and 16 notes: that input often holds more notes than that, which makes
+// NoteList compact its stack and drop its oldest notes.
+
+static const byte sListSize     = 16;
+static const unsigned sEvents   = 512;
+static const unsigned sPasses   = 40;
+static const unsigned sChecks   = 5000;
+
+// -----------------------------------------------------------------------------
+
+// The doubly linked list of the SimpleSynth example, before midi::NoteList:
+// add looks for a free cell, remove, getHigh and getLow walk the list.
+template<byte Size>
+class LinkedNoteList
+{
+public:
+    void clear()
+    {
+        for (byte i = 0; i < Size; ++i)
+            mArray[i].active = false;
+        mHead = 0;
+        mTail = 0;
+        mSize = 0;
+    }
+
+    void add(byte inPitch)
+    {
+        Cell* cell = mArray;
+        while (cell->active)
+            cell++;
+
+        cell->pitch = inPitch;
+        cell->active = true;
+        cell->next = 0;
+        cell->prev = mTail;
+
+        if (mTail)
+            mTail->next = cell;
+        else
+            mHead = cell;
+        mTail = cell;
+        mSize++;
+    }
+
+    void remove(byte inPitch)
+    {
+        for (Cell* it = mTail; it != 0; it = it->prev)
+        {
+            if (it->pitch == inPitch)
+            {
+                it->active = false;
+                if (it->prev) it->prev->next = it->next; else mHead = it->next;
+                if (it->next) it->next->prev = it->prev; else mTail = it->prev;
+                mSize--;
+                break;
+            }
+        }
+    }
+
+    bool getLast(byte& outPitch) const
+    {
+        if (!mTail)
+            return false;
+        outPitch = mTail->pitch;
+        return true;
+    }
+
+    bool getHigh(byte& outPitch) const
+    {
+        if (!mTail)
+            return false;
+        outPitch = 0;
+        for (const Cell* it = mTail; it != 0; it = it->prev)
+            if (it->pitch > outPitch) outPitch = it->pitch;
+        return true;
+    }
+
+    bool getLow(byte& outPitch) const
+    {
+        if (!mTail)
+            return false;
+        outPitch = 0xff;
+        for (const Cell* it = mTail; it != 0; it = it->prev)
+            if (it->pitch < outPitch) outPitch = it->pitch;
+        return true;
+    }
+
+private:
+    struct Cell
+    {
+        byte pitch;
+        bool active;
+        Cell* next;
+        Cell* prev;
+    };
+
+    Cell mArray[Size];
+    Cell* mHead;
+    Cell* mTail;
+    byte mSize;
+};
+
+// -----------------------------------------------------------------------------
+
+// What midi::NoteList should do, the simple way: pitches in the order they
+// were played, a note played again moves to the end, and a new note drops the
+// oldest one when the list is full.
+template<byte Size>
+class ReferenceNoteList
+{
+public:
+    ReferenceNoteList()
+        : mCount(0)
+    {
+    }
+
+    void clear()
+    {
+        mCount = 0;
+    }
+
+    void add(byte inPitch)
+    {
+        const byte index = find(inPitch);
+        if (index < mCount)
+            removeAt(index);
+        else if (mCount == Size)
+            removeAt(0);
+        mPitches[mCount++] = inPitch;
+    }
+
+    void remove(byte inPitch)
+    {
+        const byte index = find(inPitch);
+        if (index < mCount)
+            removeAt(index);
+    }
+
+    byte size() const
+    {
+        return mCount;
+    }
+
+    // 0 is the last note played.
+    byte get(byte inIndex) const
+    {
+        return mPitches[mCount - 1 - inIndex];
+    }
+
+    byte getHigh() const
+    {
+        byte high = 0;
+        for (byte i = 0; i < mCount; ++i)
+            if (mPitches[i] > high) high = mPitches[i];
+        return high;
+    }
+
+    byte getLow() const
+    {
+        byte low = 0xff;
+        for (byte i = 0; i < mCount; ++i)
+            if (mPitches[i] < low) low = mPitches[i];
+        return low;
+    }
+
+private:
+    byte find(byte inPitch) const
+    {
+        byte index = 0;
+        while (index < mCount && mPitches[index] != inPitch)
+            index++;
+        return index;
+    }
+
+    void removeAt(byte inIndex)
+    {
+        mCount--;
+        memmove(mPitches + inIndex, mPitches + inIndex + 1, mCount - inIndex);
+    }
+
+private:
+    byte mPitches[Size];
+    byte mCount;
+};
+
+// -----------------------------------------------------------------------------
+
+// Each event is a pitch, with the top bit set for a NoteOn.
+static const byte sNoteOn = 0x80;
+
+byte gChords[sEvents];
+byte gTrills[sEvents];
+
+LinkedNoteList<sListSize> gLinkedList;
+midi::NoteList<sListSize> gNoteList;
+
+// Sum of the notes picked, so that the work can't be optimized out.
+unsigned long gChecksum = 0;
+
+// -----------------------------------------------------------------------------
+
+void fillChords()
+{
+    static const byte sChord[10] = { 36, 43, 48, 52, 55, 60, 64, 67, 72, 76 };
+    unsigned size = 0;
+
+    for (byte transpose = 0; size + 20 <= sEvents; transpose = (transpose + 5) % 12)
+    {
+        for (byte i = 0; i < 10; ++i)
+            gChords[size++] = sNoteOn | (sChord[i] + transpose);
+
+        // Release from the middle out, as fingers lift unevenly.
+        for (byte i = 0; i < 10; ++i)
+        {
+            const byte index = (i & 1) ? 4 - i / 2 : 5 + i / 2;
+            gChords[size++] = sChord[index] + transpose;
+        }
+    }
+    while (size < sEvents)
+        gChords[size++] = 0;    // NoteOff for a note that isn't held.
+}
+
+void fillTrills()
+{
+    static const byte sChord[12] = { 24, 31, 36, 40, 43, 48, 52, 55, 60, 64, 67, 70 };
+    // Room left at the end to release everything.
+    const unsigned end = sEvents - 16;
+    unsigned size = 0;
+
+    for (byte i = 0; i < 12; ++i)
+        gTrills[size++] = sNoteOn | sChord[i];
+
+    byte low = 84;
+    while (size + 6 <= end)
+    {
+        const byte high = low + 2;
+        for (byte i = 0; i < 8 && size + 4 <= end; ++i)
+        {
+            // Legato: the next note starts before the previous one stops.
+            gTrills[size++] = sNoteOn | high;
+            gTrills[size++] = low;
+            gTrills[size++] = sNoteOn | low;
+            gTrills[size++] = high;
+        }
+        gTrills[size++] = low;
+        low = low < 96 ? low + 1 : 84;
+        gTrills[size++] = sNoteOn | low;
+    }
+    gTrills[size++] = low;
+
+    for (byte i = 0; i < 12; ++i)
+        gTrills[size++] = sChord[i];
+
+    while (size < sEvents)
+        gTrills[size++] = 0;
+}
+
+template<class List>
+unsigned long play(List& inList, const byte* inEvents)
+{
+    unsigned long checksum = 0;
+
+    for (unsigned i = 0; i < sEvents; ++i)
+    {
+        const byte event = inEvents[i];
+        if (event & sNoteOn)
+            inList.add(event & 0x7f);
+        else
+            inList.remove(event);
+
+        byte last = 0, high = 0, low = 0;
+        if (inList.getLast(last) && inList.getHigh(high) && inList.getLow(low))
+            checksum += last + (high << 8) + ((unsigned long)low << 16);
+    }
+    return checksum;
+}
+
+// Returns the time per event, in nanoseconds.
+template<class List>
+unsigned long bench(List& inList, const byte* inEvents)
+{
+    inList.clear();
+    gChecksum = 0;
+
+    const unsigned long start = micros();
+    for (unsigned pass = 0; pass < sPasses; ++pass)
+    {
+        gChecksum += play(inList, inEvents);
+    }
+    const unsigned long time = micros() - start;
+
+    return time * 1000 / ((unsigned long)sEvents * sPasses);
+}
+
+void benchInput(const char* inName, const byte* inEvents)
+{
+    const unsigned long linkedTime = bench(gLinkedList, inEvents);
+    const unsigned long linkedChecksum = gChecksum;
+    const unsigned long bitmapTime = bench(gNoteList, inEvents);
+
+    Serial.print(inName);
+    Serial.print("linked list ");
+    Serial.print(linkedTime);
+    Serial.print(" ns, bitmap ");
+    Serial.print(bitmapTime);
+    Serial.print(" ns per event, ");
+    Serial.println(gChecksum == linkedChecksum ? "same notes" : "DIFFERENT NOTES");
+}
+
+// -----------------------------------------------------------------------------
+
+// Returns the number of mismatches.
+template<byte Size>
+unsigned long check()
+{
+    midi::NoteList<Size> list;
+    ReferenceNoteList<Size> reference;
+    unsigned long mismatches = 0;
+
+    for (unsigned i = 0; i < sChecks; ++i)
+    {
+        // Alternate between a few pitches, often played again while held,
+        // and the whole range.
+        const byte pitch = (i / 500) % 2 ? random(128) : 60 + random(8);
+        const byte kind = random(16);
+
+        if (kind < 8)
+        {
+            list.add(pitch);
+            reference.add(pitch);
+        }
+        else if (kind < 15)
+        {
+            list.remove(pitch);
+            reference.remove(pitch);
+        }
+        else if (random(8) == 0)
+        {
+            list.clear();
+            reference.clear();
+        }
+
+        byte value = 0;
+        if (list.size() != reference.size() || list.empty() != (reference.size() == 0))
+            mismatches++;
+        if (reference.size() == 0)
+        {
+            if (list.getLast(value) || list.getHigh(value) || list.getLow(value))
+                mismatches++;
+            continue;
+        }
+
+        if (!list.getLast(value) || value != reference.get(0))
+            mismatches++;
+        if (!list.getHigh(value) || value != reference.getHigh())
+            mismatches++;
+        if (!list.getLow(value) || value != reference.getLow())
+            mismatches++;
+
+        for (byte j = 0; j < reference.size(); ++j)
+        {
+            if (!list.get(j, value) || value != reference.get(j))
+                mismatches++;
+        }
+        if (list.get(reference.size(), value))
+            mismatches++;
+    }
+    return mismatches;
+}
+
+void checkAll()
+{
+    const unsigned long mismatches = check<1>() + check<4>() + check<sListSize>();
+
+    Serial.print("Checked ");
+    Serial.print(3UL * sChecks);
+    Serial.print(" random events against the reference: ");
+    Serial.print(mismatches);
+    Serial.println(" mismatches");
+}
+
+// -----------------------------------------------------------------------------
+
+void setup()
+{
+    fillChords();
+    fillTrills();
+
+    while(!Serial);
+    Serial.begin(115200);
+    Serial.println("Arduino Ready");
+}
+
+void loop()
+{
+    benchInput("Chords: ", gChords);
+    benchInput("Trills: ", gTrills);
+    checkAll();
+    Serial.println();
+
+    delay(1000);
+}
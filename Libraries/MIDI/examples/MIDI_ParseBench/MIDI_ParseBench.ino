@@ -0,0 +1,149 @@
+#include <MIDI.h>
+#include <midi_MemorySerial.h>
+
+// This program will measure how many bytes per second the parser can handle,
+// independently of the MIDI baudrate: the input is read from a memory buffer
+// instead of an actual serial port (see midi_MemorySerial.h).
+// The same stream is parsed with one byte per read() call, with a whole
+// message per read() call, and with a single readAll() call.
+// Results are printed through the USB serial port.
+
+struct BulkSettings : public midi::DefaultSettings
+{
+    static const bool Use1ByteParsing = false;
+};
+
+static const unsigned sStreamSize = 512;
+static const unsigned sPasses     = 100;
+
+byte gStream[sStreamSize];
+midi::MemorySerial gPort(gStream, sStreamSize);
+
+midi::MidiInterface<midi::MemorySerial>                 gMidi1Byte(gPort);
+midi::MidiInterface<midi::MemorySerial, BulkSettings>   gMidiBulk(gPort);
+
+unsigned long gMessageCount = 0;
+
+// -----------------------------------------------------------------------------
+
+void handleMessage(byte, byte, byte)
+{
+    gMessageCount++;
+}
+
+void handleRealTime()
+{
+    gMessageCount++;
+}
+
+void handleSystemExclusive(byte*, unsigned)
+{
+    gMessageCount++;
+}
+
+// Fill the stream with what a keyboard and a sequencer would send:
+// notes and controllers using running status, interleaved with clocks,
+// and a SysEx dump at the end.
+void fillStream()
+{
+    unsigned size = 0;
+    byte note = 36;
+
+    while (size < sStreamSize - 40)
+    {
+        gStream[size++] = 0x90;
+        gStream[size++] = note;
+        gStream[size++] = 100;
+        gStream[size++] = 0xf8;
+        gStream[size++] = note;
+        gStream[size++] = 0;
+        gStream[size++] = 0xb0;
+        gStream[size++] = 1;
+        gStream[size++] = note;
+        gStream[size++] = 0xf8;
+
+        note = note < 84 ? note + 1 : 36;
+    }
+
+    gStream[size++] = 0xf0;
+    while (size < sStreamSize - 1)
+    {
+        gStream[size] = size & 0x7f;
+        size++;
+    }
+    gStream[size++] = 0xf7;
+}
+
+template<class Interface>
+void setupInterface(Interface& inMidi)
+{
+    inMidi.begin(MIDI_CHANNEL_OMNI);
+    inMidi.turnThruOff();
+    inMidi.setHandleNoteOn(handleMessage);
+    inMidi.setHandleNoteOff(handleMessage);
+    inMidi.setHandleControlChange(handleMessage);
+    inMidi.setHandleClock(handleRealTime);
+    inMidi.setHandleSystemExclusive(handleSystemExclusive);
+}
+
+void printResult(const char* inName, unsigned long inTime)
+{
+    // inTime is in microseconds
+    const float bytesPerSecond = (float)sStreamSize * sPasses * 1000000 / inTime;
+
+    Serial.print(inName);
+    Serial.print((unsigned long)bytesPerSecond);
+    Serial.print(" bytes/s, ");
+    Serial.print(gMessageCount / sPasses);
+    Serial.println(" messages per pass");
+
+    gMessageCount = 0;
+}
+
+template<class Interface>
+unsigned long benchRead(Interface& inMidi)
+{
+    const unsigned long start = micros();
+    for (unsigned pass = 0; pass < sPasses; ++pass)
+    {
+        gPort.rewind();
+        while (gPort.available())
+            inMidi.read();
+    }
+    return micros() - start;
+}
+
+template<class Interface>
+unsigned long benchReadAll(Interface& inMidi)
+{
+    const unsigned long start = micros();
+    for (unsigned pass = 0; pass < sPasses; ++pass)
+    {
+        gPort.rewind();
+        inMidi.readAll();
+    }
+    return micros() - start;
+}
+
+// -----------------------------------------------------------------------------
+
+void setup()
+{
+    fillStream();
+    setupInterface(gMidi1Byte);
+    setupInterface(gMidiBulk);
+
+    while(!Serial);
+    Serial.begin(115200);
+    Serial.println("Arduino Ready");
+}
+
+void loop()
+{
+    printResult("read(), 1 byte:   ", benchRead(gMidi1Byte));
+    printResult("read(), bulk:     ", benchRead(gMidiBulk));
+    printResult("readAll():        ", benchReadAll(gMidi1Byte));
+    Serial.println();
+
+    delay(1000);
+}
@@ -0,0 +1,666 @@
+#include <MIDI.h>
+#include <midi_MockSerial.h>
+
+// This program will check the parser against a reference decoder, on
+// recorded streams and on random streams made of what the parser finds hard:
+// running status, Real Time bytes interleaved in other messages, truncated
+// messages, SysEx larger than the buffer, stray and undefined status bytes.
+// Each stream is read through a MockSerial (see midi_MockSerial.h) that
+// delivers it in bursts of random sizes, with one byte per read() call and
+// with whole bursts per read() call.
+// Each stream is also forwarded in Raw thru mode, while the sketch sends
+// messages of its own between the bytes forwarded. The output is parsed
+// back: it must hold the messages of the stream and those sent, whole.
+// It then measures the parser throughput, and the longest read() call with
+// one byte per call (on AVR, micros() has a 4 microsecs resolution).
+// It runs the same on the board or on a host computer (see extras/host), so
+// that changes to the parser can be checked before they get to the hardware.
+// Results are printed through the USB serial port.
+
+struct FuzzSettings : public midi::DefaultSettings
+{
+    static const unsigned SysExMaxSize = 16;    // Small, to test overflows
+    static const bool UseReceiveTimestamps = true;
+};
+
+struct FuzzBulkSettings : public FuzzSettings
+{
+    static const bool Use1ByteParsing = false;
+};
+
+static const unsigned sStreamSize   = 256;
+static const unsigned sStreamCount  = 1000;
+static const unsigned sBenchPasses  = 100;
+
+// -----------------------------------------------------------------------------
+
+// A decoder written from the MIDI specification rather than from the parser,
+// with the parser's policies for errors:
+// - A status byte other than Real Time or EOX drops an incomplete message.
+// - Undefined Real Time status (0xf9, 0xfd) are ignored, other undefined
+//   status (0xf4, 0xf5) cancel running status like System Common messages.
+// - SysEx that don't fit the buffer are dropped, and so are the SysEx that
+//   another status byte interrupts.
+// - NoteOn with a null velocity are NoteOff.
+// Each message gets the position of its first byte, the timestamp MockSerial
+// gives the parser.
+class ReferenceDecoder
+{
+public:
+    void begin()
+    {
+        mRunningStatus = 0;
+        mPendingStatus = 0;
+        mSysExLength = 0;
+        mPosition = 0;
+    }
+
+    // Returns true when inByte completes a message.
+    bool feed(byte inByte)
+    {
+        mBytePosition = mPosition++;
+
+        if (inByte >= 0xf8)
+        {
+            if (inByte == 0xf9 || inByte == 0xfd)
+                return false;
+            mStartPosition = mBytePosition;
+            return complete(inByte, 0, 0);
+        }
+
+        if (inByte >= 0x80)
+        {
+            const byte sysExLength = mSysExLength;
+            mPendingStatus = 0;
+            mSysExLength = 0;
+
+            if (inByte < 0xf0)
+            {
+                mRunningStatus = inByte;
+                startMessage(inByte);
+                return false;
+            }
+
+            // System Common and SysEx cancel running status.
+            mRunningStatus = 0;
+            switch (inByte)
+            {
+                case 0xf0:
+                    if (FuzzSettings::SysExMaxSize >= 2)
+                    {
+                        mSysEx[0] = inByte;
+                        mSysExLength = 1;
+                        mSysExPosition = mBytePosition;
+                    }
+                    return false;
+
+                case 0xf7:
+                    if (sysExLength == 0)
+                        return false;   // Stray EOX
+
+                    mSysEx[sysExLength] = inByte;
+                    mMessageSysExLength = sysExLength + 1;
+                    mStartPosition = mSysExPosition;
+                    return complete(0xf0, 0, 0);
+
+                case 0xf1:
+                case 0xf2:
+                case 0xf3:
+                    startMessage(inByte);
+                    return false;
+
+                case 0xf6:
+                    mStartPosition = mBytePosition;
+                    return complete(inByte, 0, 0);
+
+                default:
+                    return false;
+            }
+        }
+
+        if (mSysExLength != 0)
+        {
+            if (mSysExLength < FuzzSettings::SysExMaxSize - 1)
+            {
+                mSysEx[mSysExLength++] = inByte;
+            }
+            else
+            {
+                mSysExLength = 0;   // Overflow
+            }
+            return false;
+        }
+
+        if (mPendingStatus == 0)
+        {
+            if (mRunningStatus == 0)
+                return false;   // Data byte without status
+            startMessage(mRunningStatus);
+        }
+
+        mData[mDataCount++] = inByte;
+        if (mDataCount < mExpectedCount)
+            return false;
+
+        const byte status = mPendingStatus;
+        mPendingStatus = 0;
+        mStartPosition = mPendingPosition;
+        return complete(status, mData[0], mExpectedCount == 2 ? mData[1] : 0);
+    }
+
+public:
+    // The last message decoded
+    byte mStatus;
+    byte mData1;
+    byte mData2;
+    byte mSysEx[FuzzSettings::SysExMaxSize];
+    byte mMessageSysExLength;
+    unsigned mStartPosition;
+
+private:
+    void startMessage(byte inStatus)
+    {
+        mPendingStatus = inStatus;
+        mPendingPosition = mBytePosition;
+        mDataCount = 0;
+        mExpectedCount = (inStatus == 0xf2 || (inStatus < 0xf0 && (inStatus & 0xe0) != 0xc0)) ? 2 : 1;
+    }
+
+    bool complete(byte inStatus, byte inData1, byte inData2)
+    {
+        if ((inStatus & 0xf0) == 0x90 && inData2 == 0)
+            inStatus -= 0x10;
+
+        mStatus = inStatus;
+        mData1 = inData1;
+        mData2 = inData2;
+        return true;
+    }
+
+private:
+    byte mRunningStatus;
+    byte mPendingStatus;
+    byte mData[2];
+    byte mDataCount;
+    byte mExpectedCount;
+    byte mSysExLength;
+    unsigned mPosition;
+    unsigned mBytePosition;
+    unsigned mPendingPosition;
+    unsigned mSysExPosition;
+};
+
+// -----------------------------------------------------------------------------
+
+byte gStream[sStreamSize];
+unsigned gStreamSize = 0;
+
+midi::MockSerial gPort;
+midi::MidiInterface<midi::MockSerial, FuzzSettings>     gMidi1Byte(gPort);
+midi::MidiInterface<midi::MockSerial, FuzzBulkSettings> gMidiBulk(gPort);
+
+ReferenceDecoder gReference;
+
+unsigned long gMessageCount = 0;
+unsigned long gMismatchCount = 0;
+
+// A keyboard with running status and clocks, a short SysEx and a SysEx that
+// overflows the buffer.
+const byte sRecorded1[] = {
+    0x90, 0x3c, 0x64, 0x3e, 0x64, 0xf8, 0x40, 0x64, 0x3c, 0x00, 0xf8, 0x3e,
+    0xf8, 0x00, 0xb0, 0x01, 0x20, 0x02, 0x30, 0xc0, 0x05, 0x06, 0xf8, 0x07,
+    0xf0, 0x7e, 0x7f, 0x06, 0x01, 0xf7, 0x40, 0x40,
+    0xf0, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b,
+    0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12, 0xf7, 0x90, 0x3c, 0x64,
+};
+
+// Truncated messages, stray and undefined status bytes, System Common.
+const byte sRecorded2[] = {
+    0x40, 0x90, 0x3c, 0x80, 0x3c, 0x00, 0x3d, 0xb0, 0xe0, 0x00, 0x40,
+    0xf0, 0x01, 0x02, 0x90, 0x3c, 0x64, 0xf7, 0x3c, 0x64, 0xf9, 0x90, 0x3c,
+    0xfd, 0x64, 0xf6, 0x3c, 0x64, 0xf1, 0x20, 0xf2, 0x10, 0x20, 0xf3, 0x01,
+    0xa0, 0x3c, 0xf4, 0x10, 0x90, 0x3c, 0x64, 0xf5, 0x3c, 0x64, 0xff, 0xfe,
+};
+
+// -----------------------------------------------------------------------------
+
+// Messages expected on the Raw thru output, as status, data1, data2 (or the
+// length of a SysEx), after a read() or a send.
+byte gExpected[4][3];
+byte gExpectedCount = 0;
+
+byte gOutput[32];
+midi::MockSerial gOutputPort;
+midi::MidiInterface<midi::MockSerial, FuzzSettings> gOutputDecoder(gOutputPort);
+
+// -----------------------------------------------------------------------------
+
+void printHex(byte inValue)
+{
+    Serial.print(inValue >> 4, HEX);
+    Serial.print(inValue & 0x0f, HEX);
+}
+
+template<class Interface>
+bool isSameMessage(Interface& inMidi)
+{
+    const byte status = gReference.mStatus;
+    const midi::MidiType type = midi::MidiType(status < 0xf0 ? status & 0xf0 : status);
+    const byte channel = status < 0xf0 ? (status & 0x0f) + 1 : 0;
+
+    if (inMidi.getType() != type || inMidi.getChannel() != channel ||
+        inMidi.getTimestamp() != gReference.mStartPosition)
+        return false;
+
+    if (type != midi::SystemExclusive)
+        return inMidi.getData1() == gReference.mData1 && inMidi.getData2() == gReference.mData2;
+
+    if (inMidi.getSysExArrayLength() != gReference.mMessageSysExLength)
+        return false;
+
+    const byte* sysEx = inMidi.getSysExArray();
+    for (byte i = 0; i < gReference.mMessageSysExLength; ++i)
+    {
+        if (sysEx[i] != gReference.mSysEx[i])
+            return false;
+    }
+    return true;
+}
+
+template<class Interface>
+void reportMismatch(Interface& inMidi, const char* inName, unsigned inPosition,
+                    bool inParsed, bool inExpected)
+{
+    gMismatchCount++;
+    if (gMismatchCount > 4)
+        return;
+
+    Serial.print(inName);
+    Serial.print(" mismatch at byte ");
+    Serial.print(inPosition);
+    if (inParsed)
+    {
+        Serial.print(", parsed ");
+        printHex(inMidi.getType() | (inMidi.getChannel() > 0 ? inMidi.getChannel() - 1 : 0));
+        Serial.print(" ");
+        printHex(inMidi.getData1());
+        Serial.print(" ");
+        printHex(inMidi.getData2());
+    }
+    else
+    {
+        Serial.print(", parsed nothing");
+    }
+    if (inExpected)
+    {
+        Serial.print(", expected ");
+        printHex(gReference.mStatus);
+        Serial.print(" ");
+        printHex(gReference.mData1);
+        Serial.print(" ");
+        printHex(gReference.mData2);
+    }
+    Serial.print(", stream:");
+    for (unsigned i = 0; i < gStreamSize; ++i)
+    {
+        Serial.print(" ");
+        printHex(gStream[i]);
+    }
+    Serial.println();
+}
+
+// Parse gStream and check each message against the reference decoder, which
+// is fed the bytes that each read() call consumed.
+template<class Interface>
+void check(Interface& inMidi, const char* inName, unsigned inBurstSize)
+{
+    inMidi.begin(MIDI_CHANNEL_OMNI);
+    inMidi.turnThruOff();
+    gReference.begin();
+    gPort.setInput(gStream, gStreamSize, inBurstSize);
+
+    unsigned checked = 0;
+    while (!gPort.isFinished())
+    {
+        const bool parsed = inMidi.read();
+        const unsigned position = gPort.getPosition();
+
+        for (; checked < position; ++checked)
+        {
+            const byte value = gStream[checked];
+            const bool expected = gReference.feed(value);
+            const bool last = checked + 1 == position;
+
+            if (expected)
+                gMessageCount++;
+
+            if (expected && !last)
+            {
+                reportMismatch(inMidi, inName, checked, false, true);
+            }
+            else if (last && (parsed != expected || (parsed && !isSameMessage(inMidi))))
+            {
+                reportMismatch(inMidi, inName, checked, parsed, expected);
+            }
+        }
+    }
+}
+
+void expect(byte inStatus, byte inData1, byte inData2)
+{
+    if (gExpectedCount == 4)
+        return;
+
+    if ((inStatus & 0xf0) == 0x90 && inData2 == 0)
+        inStatus -= 0x10;
+
+    gExpected[gExpectedCount][0] = inStatus;
+    gExpected[gExpectedCount][1] = inData1;
+    gExpected[gExpectedCount][2] = inData2;
+    gExpectedCount++;
+}
+
+// Send a random message, between the bytes forwarded by Raw thru.
+template<class Interface>
+void sendRandomMessage(Interface& inMidi)
+{
+    static const byte sSysEx[] = { 0x7d, 0x01, 0x02 };
+    const byte channel = 1 + random(2);
+    const byte data1 = random(128);
+    const byte data2 = 1 + random(127);
+
+    switch (random(6))
+    {
+        case 0:
+            expect(0x8f + channel, data1, data2);
+            inMidi.sendNoteOn(data1, data2, channel);
+            break;
+        case 1:
+            expect(0xaf + channel, data1, data2);
+            inMidi.sendControlChange(data1, data2, channel);
+            break;
+        case 2:
+            expect(0xbf + channel, data1, 0);
+            inMidi.sendProgramChange(data1, channel);
+            break;
+        case 3:
+            expect(0xf2, data1, data2);
+            inMidi.sendSongPosition(data1 | (data2 << 7));
+            break;
+        case 4:
+            expect(0xf0, sizeof(sSysEx) + 2, 0);
+            inMidi.sendSysEx(sizeof(sSysEx), sSysEx);
+            break;
+        default:
+            expect(0xf8, 0, 0);
+            inMidi.sendRealTime(midi::Clock);
+            break;
+    }
+}
+
+// Parse what was written since the last call, and check it against the
+// expected messages.
+void checkOutput(const char* inName, unsigned inPosition)
+{
+    gOutputPort.setInput(gOutput, min(gPort.getOutputLength(), sizeof(gOutput)));
+    gPort.setOutput(gOutput, sizeof(gOutput));
+
+    byte checked = 0;
+    while (!gOutputPort.isFinished())
+    {
+        if (!gOutputDecoder.read())
+            continue;
+
+        const byte type = gOutputDecoder.getType();
+        const byte status = type < 0xf0 ? type | (gOutputDecoder.getChannel() - 1) : type;
+        const byte data1 = type == midi::SystemExclusive
+                         ? gOutputDecoder.getSysExArrayLength() : gOutputDecoder.getData1();
+
+        if (checked < gExpectedCount &&
+            status == gExpected[checked][0] && data1 == gExpected[checked][1] &&
+            (type == midi::SystemExclusive || gOutputDecoder.getData2() == gExpected[checked][2]))
+        {
+            checked++;
+            continue;
+        }
+
+        gMismatchCount++;
+        if (gMismatchCount <= 4)
+        {
+            Serial.print(inName);
+            Serial.print(" Raw thru mismatch at byte ");
+            Serial.print(inPosition);
+            Serial.print(", output ");
+            printHex(status);
+            Serial.print(" ");
+            printHex(data1);
+            Serial.println();
+        }
+    }
+
+    if (checked != gExpectedCount)
+    {
+        gMismatchCount++;
+        if (gMismatchCount <= 4)
+        {
+            Serial.print(inName);
+            Serial.print(" Raw thru lost a message at byte ");
+            Serial.println(inPosition);
+        }
+    }
+    gMessageCount += checked;
+    gExpectedCount = 0;
+}
+
+// Forward gStream in Raw thru mode, sending messages between its bytes.
+template<class Interface>
+void checkThru(Interface& inMidi, const char* inName, unsigned inBurstSize)
+{
+    inMidi.begin(MIDI_CHANNEL_OMNI);
+    inMidi.turnThruOn(midi::Raw);
+    gReference.begin();
+    gPort.setInput(gStream, gStreamSize, inBurstSize);
+    gPort.setOutput(gOutput, sizeof(gOutput));
+    gOutputDecoder.begin(MIDI_CHANNEL_OMNI);
+    gOutputDecoder.turnThruOff();
+    gExpectedCount = 0;
+
+    // A SysEx is dropped from the output if the sketch sends a message (other
+    // than Real Time) in the middle of it.
+    bool inSysEx = false;
+    bool sysExCut = false;
+
+    unsigned checked = 0;
+    while (!gPort.isFinished())
+    {
+        inMidi.read();
+        const unsigned position = gPort.getPosition();
+
+        for (; checked < position; ++checked)
+        {
+            const byte value = gStream[checked];
+            const bool cut = sysExCut;
+            if (value >= 0x80 && value < 0xf8)
+            {
+                inSysEx = value == 0xf0;
+                sysExCut = false;
+            }
+
+            if (!gReference.feed(value))
+                continue;
+
+            if (gReference.mStatus != 0xf0)
+                expect(gReference.mStatus, gReference.mData1, gReference.mData2);
+            else if (!cut)
+                expect(0xf0, gReference.mMessageSysExLength, 0);
+        }
+
+        if (random(8) == 0)
+        {
+            sendRandomMessage(inMidi);
+            if (inSysEx && gExpected[gExpectedCount - 1][0] != 0xf8)
+                sysExCut = true;
+        }
+        checkOutput(inName, position);
+    }
+
+    inMidi.turnThruOff();
+    gPort.setOutput(0, 0);
+}
+
+void copyStream(const byte* inData, unsigned inSize)
+{
+    for (unsigned i = 0; i < inSize; ++i)
+        gStream[i] = inData[i];
+    gStreamSize = inSize;
+}
+
+// -----------------------------------------------------------------------------
+
+void addByte(byte inValue)
+{
+    if (gStreamSize == sStreamSize)
+        return;
+
+    // Real Time bytes can come anywhere, even between SysEx bytes.
+    if (random(12) == 0 && gStreamSize < sStreamSize - 1)
+    {
+        static const byte sRealTime[] = { 0xf8, 0xf8, 0xfa, 0xfb, 0xfc, 0xfe, 0xff, 0xf9, 0xfd };
+        gStream[gStreamSize++] = sRealTime[random(sizeof(sRealTime))];
+    }
+
+    gStream[gStreamSize++] = inValue;
+}
+
+// Data bytes, sometimes truncated.
+void addData(byte inCount)
+{
+    if (inCount > 0 && random(10) == 0)
+        inCount = random(inCount);
+
+    for (byte i = 0; i < inCount; ++i)
+        addByte(random(4) == 0 ? 0 : random(128));
+}
+
+void generateStream()
+{
+    byte runningStatus = 0;
+    gStreamSize = 0;
+
+    while (gStreamSize < sStreamSize)
+    {
+        const byte kind = random(16);
+
+        if (kind < 10)
+        {
+            // Two channels, to switch statuses and keep running status.
+            const byte status = 0x80 + random(7) * 0x10 + random(2);
+            if (status != runningStatus || random(4) == 0)
+                addByte(status);
+            runningStatus = status;
+            addData((status & 0xe0) == 0xc0 ? 1 : 2);
+        }
+        else if (kind < 12)
+        {
+            // Sometimes too large, sometimes unterminated.
+            addByte(0xf0);
+            addData(random(FuzzSettings::SysExMaxSize + 4));
+            if (random(4) != 0)
+                addByte(0xf7);
+            runningStatus = 0;
+        }
+        else if (kind < 15)
+        {
+            static const byte sSystem[] = { 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7 };
+            const byte status = sSystem[random(sizeof(sSystem))];
+            addByte(status);
+            addData(midi::getMessageLength(status) > 0 ? midi::getMessageLength(status) - 1 : 0);
+            runningStatus = 0;
+        }
+        else
+        {
+            addByte(random(256));
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+void checkStream(const char* inName)
+{
+    check(gMidi1Byte, inName, 1 + random(16));
+    check(gMidiBulk, inName, 1 + random(16));
+    check(gMidiBulk, inName, 0);
+    checkThru(gMidi1Byte, inName, 1 + random(16));
+    checkThru(gMidiBulk, inName, 1 + random(16));
+}
+
+// Parse gStream, one byte per read() call.
+unsigned long bench(unsigned long& outWorstTime)
+{
+    unsigned long total = 0;
+    outWorstTime = 0;
+
+    for (unsigned pass = 0; pass < sBenchPasses; ++pass)
+    {
+        gPort.setInput(gStream, gStreamSize);
+
+        const unsigned long start = micros();
+        while (!gPort.isFinished())
+            gMidi1Byte.read();
+        total += micros() - start;
+
+        gPort.setInput(gStream, gStreamSize);
+        while (!gPort.isFinished())
+        {
+            const unsigned long callStart = micros();
+            gMidi1Byte.read();
+            const unsigned long time = micros() - callStart;
+            if (time > outWorstTime) outWorstTime = time;
+        }
+    }
+    return total;
+}
+
+// -----------------------------------------------------------------------------
+
+void setup()
+{
+    while(!Serial);
+    Serial.begin(115200);
+    Serial.println("Arduino Ready");
+}
+
+void loop()
+{
+    gMessageCount = 0;
+    gMismatchCount = 0;
+
+    copyStream(sRecorded1, sizeof(sRecorded1));
+    checkStream("Recorded 1:");
+    copyStream(sRecorded2, sizeof(sRecorded2));
+    checkStream("Recorded 2:");
+
+    for (unsigned i = 0; i < sStreamCount; ++i)
+    {
+        generateStream();
+        checkStream("Random:");
+    }
+
+    Serial.print("Checked ");
+    Serial.print(gMessageCount);
+    Serial.print(" messages, ");
+    Serial.print(gMismatchCount);
+    Serial.println(" mismatches");
+
+    unsigned long worstTime;
+    const unsigned long time = bench(worstTime);
+    Serial.print("Parse: ");
+    Serial.print((unsigned long)((float)gStreamSize * sBenchPasses * 1000000 / time));
+    Serial.print(" bytes/s, longest read(): ");
+    Serial.print(worstTime);
+    Serial.println(" microsecs");
+    Serial.println();
+
+    delay(1000);
+}
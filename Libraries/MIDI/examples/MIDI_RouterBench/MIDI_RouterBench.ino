@@ -0,0 +1,350 @@
+#include <MIDI.h>
+#include <midi_Router.h>
+
+// This program will measure the latency and throughput of midi::Router with
+// 2, 3 and 4 ports, all loaded at the full MIDI rate.
+// Time is simulated so that the results don't depend on the board: at each
+// step of 320 microsecs (a byte at 31250 bauds), input ports receive a byte
+// and output ports send a byte, as MIDI cables would. Two setups are measured:
+// - Thru:  each input is routed to its own output, and receives a byte at
+//          each step.
+// - Merge: each input is routed to all outputs, and receives a byte every
+//          N steps (N ports), so that each output gets a full load.
+// The inputs receive NoteOns, Clocks and SysEx, each on its own channel, and
+// each one starts at a different point of the sequence, so that some of them
+// wait for the SysEx of another one while Clocks come in.
+// NoteOns use running status in the Thru setup only: merged outputs switch
+// channels all the time, they would need more bytes than their inputs.
+// The latency of a NoteOn or a Clock goes from the end of its reception to
+// the end of its transmission, a byte time at best.
+// Results are printed through the USB serial port, with the Clocks the
+// outputs had to drop.
+
+static const unsigned long sByteTime = 320;
+static const unsigned sSteps         = 31250;   // 10 seconds
+static const byte sSequenceMask      = 63;
+
+// -----------------------------------------------------------------------------
+
+// Arrival step of the last NoteOns received, by input and sequence number.
+unsigned gArrivals[4][sSequenceMask + 1];
+unsigned gStep = 0;
+
+// Arrival step of the Clocks each output still has to send, oldest first.
+// Clocks carry no channel: when inputs are merged, they are matched in the
+// order they arrived, which gives the right average latency.
+unsigned gClockArrivals[4][sSequenceMask + 1];
+byte gClockHeads[4];
+byte gClockTails[4];
+
+class SimulatedInput
+{
+public:
+    void begin(byte inIndex, bool inUseRunningStatus)
+    {
+        mIndex = inIndex;
+        mUseRunningStatus = inUseRunningStatus;
+        mHead = 0;
+        mTail = 0;
+        mMaxBacklog = 0;
+        mClockArrived = false;
+        mMessage = inIndex * 4;
+        mLength = 0;
+        mPosition = 0;
+        mRunningStatus = 0;
+    }
+
+    // A byte arrives on the cable.
+    void arrive()
+    {
+        if (mPosition == mLength)
+        {
+            generate();
+        }
+
+        const byte value = mPending[mPosition++];
+        mBuffer[mHead++] = value;
+        mClockArrived = value == 0xf8;
+
+        if (mPosition == mLength && mPending[0] == 0x90 + mIndex)
+        {
+            gArrivals[mIndex][mPending[1] & sSequenceMask] = gStep;
+        }
+
+        const byte backlog = mHead - mTail;
+        if (backlog > mMaxBacklog) mMaxBacklog = backlog;
+    }
+
+    int available()
+    {
+        return byte(mHead - mTail);
+    }
+
+    int read()
+    {
+        return mBuffer[mTail++];
+    }
+
+public:
+    byte mMaxBacklog;   // Past 64, a HardwareSerial buffer would overflow.
+    bool mClockArrived;
+
+private:
+    void generate()
+    {
+        const byte kind = mMessage++ & 0x0f;
+        mLength = 0;
+        mPosition = 0;
+
+        if (kind == 15)
+        {
+            mPending[mLength++] = 0xf0;
+            for (byte i = 0; i < 14; ++i) mPending[mLength++] = i;
+            mPending[mLength++] = 0xf7;
+            mRunningStatus = 0;
+        }
+        else if ((kind & 3) == 3)
+        {
+            mPending[mLength++] = 0xf8;
+        }
+        else
+        {
+            const byte status = 0x90 + mIndex;
+            // The status byte is kept in mPending[0] for arrive(), skipped
+            // when running status applies.
+            mPending[0] = status;
+            mPending[1] = mMessage & 0x7f;
+            mPending[2] = 64;
+            mLength = 3;
+            if (mUseRunningStatus && mRunningStatus == status)
+            {
+                mPosition = 1;
+            }
+            mRunningStatus = status;
+        }
+    }
+
+private:
+    byte mIndex;
+    bool mUseRunningStatus;
+    byte mBuffer[256];
+    byte mHead;
+    byte mTail;
+    unsigned mMessage;
+    byte mPending[16];
+    byte mLength;
+    byte mPosition;
+    byte mRunningStatus;
+};
+
+// Hands the bytes sent to an output over to a parser.
+class Loopback
+{
+public:
+    void begin(long)
+    {
+        mHasByte = false;
+    }
+
+    int available()
+    {
+        return mHasByte ? 1 : 0;
+    }
+
+    int read()
+    {
+        mHasByte = false;
+        return mByte;
+    }
+
+    size_t write(byte inByte)
+    {
+        mByte = inByte;
+        mHasByte = true;
+        return 1;
+    }
+
+private:
+    byte mByte;
+    bool mHasByte;
+};
+
+struct DecoderSettings : public midi::DefaultSettings
+{
+    static const unsigned SysExMaxSize = 0;
+};
+
+SimulatedInput gInputs[4];
+Loopback gLoopbacks[4];
+midi::MidiInterface<Loopback, DecoderSettings> gDecoders[4] = {
+    midi::MidiInterface<Loopback, DecoderSettings>(gLoopbacks[0]),
+    midi::MidiInterface<Loopback, DecoderSettings>(gLoopbacks[1]),
+    midi::MidiInterface<Loopback, DecoderSettings>(gLoopbacks[2]),
+    midi::MidiInterface<Loopback, DecoderSettings>(gLoopbacks[3]),
+};
+
+unsigned long gNoteCount;
+unsigned long gLatencySum;
+unsigned long gLatencyMax;
+unsigned long gClockCount;
+unsigned long gClockLatencySum;
+unsigned long gClockLatencyMax;
+unsigned long gBytesOut;
+
+// -----------------------------------------------------------------------------
+
+void decode(byte inOutput)
+{
+    midi::MidiInterface<Loopback, DecoderSettings>& decoder = gDecoders[inOutput];
+    if (!decoder.read())
+    {
+        return;
+    }
+
+    if (decoder.getType() == midi::NoteOn)
+    {
+        const byte input = decoder.getChannel() - 1;
+        const unsigned arrival = gArrivals[input][decoder.getData1() & sSequenceMask];
+        const unsigned long latency = (unsigned long)(gStep - arrival + 1) * sByteTime;
+
+        gNoteCount++;
+        gLatencySum += latency;
+        if (latency > gLatencyMax) gLatencyMax = latency;
+    }
+    else if (decoder.getType() == midi::Clock)
+    {
+        const unsigned arrival = gClockArrivals[inOutput][gClockTails[inOutput]++ & sSequenceMask];
+        const unsigned long latency = (unsigned long)(gStep - arrival + 1) * sByteTime;
+
+        gClockCount++;
+        gClockLatencySum += latency;
+        if (latency > gClockLatencyMax) gClockLatencyMax = latency;
+    }
+}
+
+template<byte PortCount>
+void bench(bool inMerge)
+{
+    midi::Router<PortCount> router;
+
+    for (byte i = 0; i < PortCount; ++i)
+    {
+        gInputs[i].begin(i, !inMerge);
+        gDecoders[i].begin(MIDI_CHANNEL_OMNI);
+        gDecoders[i].turnThruOff();
+
+        for (byte o = 0; o < PortCount; ++o)
+        {
+            if (inMerge || i == o)
+            {
+                router.connect(i, o);
+            }
+        }
+        gClockHeads[i] = 0;
+        gClockTails[i] = 0;
+    }
+
+    gNoteCount = 0;
+    gLatencySum = 0;
+    gLatencyMax = 0;
+    gClockCount = 0;
+    gClockLatencySum = 0;
+    gClockLatencyMax = 0;
+    gBytesOut = 0;
+
+    for (gStep = 0; gStep < sSteps; ++gStep)
+    {
+        for (byte i = 0; i < PortCount; ++i)
+        {
+            if (!inMerge || gStep % PortCount == i)
+            {
+                gInputs[i].arrive();
+            }
+
+            if (gInputs[i].mClockArrived)
+            {
+                gInputs[i].mClockArrived = false;
+                for (byte o = 0; o < PortCount; ++o)
+                {
+                    if (router.isConnected(i, o))
+                    {
+                        gClockArrivals[o][gClockHeads[o]++ & sSequenceMask] = gStep;
+                    }
+                }
+            }
+
+            unsigned drops[PortCount];
+            for (byte o = 0; o < PortCount; ++o)
+            {
+                drops[o] = router.getRealTimeDropCount(o);
+            }
+            router.read(i, gInputs[i]);
+            for (byte o = 0; o < PortCount; ++o)
+            {
+                // The newest Clock is the one that didn't fit.
+                if (router.getRealTimeDropCount(o) != drops[o])
+                {
+                    gClockHeads[o]--;
+                }
+            }
+        }
+
+        for (byte o = 0; o < PortCount; ++o)
+        {
+            if (router.getPendingCount(o) > 0)
+            {
+                router.write(o, gLoopbacks[o], 1);
+                gBytesOut++;
+                decode(o);
+            }
+        }
+    }
+
+    byte maxBacklog = 0;
+    unsigned long clockDrops = 0;
+    for (byte i = 0; i < PortCount; ++i)
+    {
+        if (gInputs[i].mMaxBacklog > maxBacklog) maxBacklog = gInputs[i].mMaxBacklog;
+        clockDrops += router.getRealTimeDropCount(i);
+    }
+
+    Serial.print(PortCount);
+    Serial.print(inMerge ? " ports, merge: " : " ports, thru:  ");
+    Serial.print(gNoteCount * 1000000 / ((unsigned long)sSteps * sByteTime) / PortCount);
+    Serial.print(" notes/s per output, output load ");
+    Serial.print(gBytesOut * 100 / ((unsigned long)sSteps * PortCount));
+    Serial.print("%, latency ");
+    Serial.print(gLatencySum / gNoteCount);
+    Serial.print(" microsecs (max ");
+    Serial.print(gLatencyMax);
+    Serial.print("), Clock latency ");
+    Serial.print(gClockLatencySum / gClockCount);
+    Serial.print(" microsecs (max ");
+    Serial.print(gClockLatencyMax);
+    Serial.print("), input backlog max ");
+    Serial.print(maxBacklog);
+    Serial.print(", Clocks dropped ");
+    Serial.println(clockDrops);
+}
+
+// -----------------------------------------------------------------------------
+
+void setup()
+{
+    while(!Serial);
+    Serial.begin(115200);
+    Serial.println("Arduino Ready");
+}
+
+void loop()
+{
+    bench<2>(false);
+    bench<2>(true);
+    bench<3>(false);
+    bench<3>(true);
+    bench<4>(false);
+    bench<4>(true);
+    Serial.println();
+
+    delay(1000);
+}
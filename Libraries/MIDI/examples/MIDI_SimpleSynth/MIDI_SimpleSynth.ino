@@ -1,5 +1,6 @@
 #include <MIDI.h>
-#include "noteList.h"
+#include <midi_NoteList.h>
+#include <midi_Watchdog.h>
 #include "pitches.h"
 
 MIDI_CREATE_DEFAULT_INSTANCE();
@@ -12,11 +13,15 @@ MIDI_CREATE_DEFAULT_INSTANCE();
 // This example shows how to make a simple synth out of an Arduino, using the
 // tone() function. It also outputs a gate signal for controlling external
 // analog synth components (like envelopes).
+// If the keyboard sends Active Sensing, the notes are released when it goes
+// silent (cable unplugged), instead of playing forever. So does System Reset.
 
 static const unsigned sGatePin     = 13;
 static const unsigned sAudioOutPin = 10;
 static const unsigned sMaxNumNotes = 16;
-MidiNoteList<sMaxNumNotes> midiNotes;
+static const byte sChannel         = 1;
+midi::NoteList<sMaxNumNotes> midiNotes;
+midi::ActiveSensingWatchdog<1> watchdog;
 
 // -----------------------------------------------------------------------------
 
@@ -69,17 +74,29 @@ void handleNotesChanged(bool isFirstNote = false)
 
 void handleNoteOn(byte inChannel, byte inNote, byte inVelocity)
 {
+    if (inChannel != sChannel)
+        return;
+
     const bool firstNote = midiNotes.empty();
-    midiNotes.add(MidiNote(inNote, inVelocity));
+    midiNotes.add(inNote);
     handleNotesChanged(firstNote);
 }
 
 void handleNoteOff(byte inChannel, byte inNote, byte inVelocity)
 {
+    if (inChannel != sChannel)
+        return;
+
     midiNotes.remove(inNote);
     handleNotesChanged();
 }
 
+void releaseAllNotes()
+{
+    midiNotes.clear();
+    handleNotesChanged();
+}
+
 // -----------------------------------------------------------------------------
 
 void setup()
@@ -88,10 +105,22 @@ void setup()
     pinMode(sAudioOutPin, OUTPUT);
     MIDI.setHandleNoteOn(handleNoteOn);
     MIDI.setHandleNoteOff(handleNoteOff);
-    MIDI.begin();
+    MIDI.setHandleSystemReset(releaseAllNotes);
+
+    // Listen to all channels, so that the watchdog sees every message, the
+    // note handlers filter sChannel.
+    MIDI.begin(MIDI_CHANNEL_OMNI);
 }
 
 void loop()
 {
-    MIDI.read();
+    if (MIDI.read())
+    {
+        watchdog.receive(0, MIDI.getType(), micros());
+    }
+
+    if (watchdog.update(micros()))
+    {
+        releaseAllNotes();
+    }
 }
@@ -0,0 +1,228 @@
+#include <MIDI.h>
+#include <midi_MemorySerial.h>
+#include <midi_Smf.h>
+
+// This program will record a MIDI stream into a Standard MIDI File with
+// midi::SmfWriter, turn it into a type 1 file with several copies of the
+// track, and check that midi::SmfReader reads back the recorded messages,
+// in time order. It will then measure how many events per second the reader
+// can parse, from a file in RAM.
+// The stream is read from a memory buffer (see midi_MemorySerial.h) and
+// timestamped with a simulated clock, so that it runs on a host computer too.
+// Results are printed through the USB serial port.
+
+static const unsigned sStreamSize   = 192;
+static const unsigned sFileSize     = 1280;
+static const byte sTrackCount       = 4;
+static const unsigned sPasses       = 100;
+
+byte gStream[sStreamSize];
+unsigned gStreamLength = 0;
+byte gFile[sFileSize];
+unsigned long gFileLength = 0;
+
+midi::MemorySerial gPort(gStream, sStreamSize);
+midi::MidiInterface<midi::MemorySerial> gMidi(gPort);
+
+// -----------------------------------------------------------------------------
+
+void append(byte inByte)
+{
+    if (gStreamLength < sStreamSize)
+    {
+        gStream[gStreamLength++] = inByte;
+    }
+}
+
+// Notes, Control Changes, Program Changes and Pitch Bends on 4 channels, with
+// running status and a SysEx.
+void generateStream()
+{
+    gStreamLength = 0;
+    for (byte i = 0; gStreamLength < sStreamSize - 24; ++i)
+    {
+        const byte channel = i & 3;
+        switch (i % 5)
+        {
+            case 0:  append(0x90 | channel); append(i & 0x7f); append(100); append(i & 0x7f); append(0); break;
+            case 1:  append(0xb0 | channel); append(7);        append(i & 0x7f);                          break;
+            case 2:  append(0xc0 | channel); append(i & 0x7f);                                            break;
+            case 3:  append(0xe0 | channel); append(0);        append(i & 0x7f);                          break;
+            default: append(0x80 | channel); append(i & 0x7f); append(64);                                break;
+        }
+    }
+    const byte sysEx[] = { 0xf0, 0x7d, 0x01, 0x02, 0x03, 0xf7 };
+    for (byte i = 0; i < sizeof(sysEx); ++i)
+    {
+        append(sysEx[i]);
+    }
+    gPort = midi::MemorySerial(gStream, gStreamLength);
+}
+
+// Record the stream in a type 0 file, a message every 1.5 milliseconds.
+unsigned record()
+{
+    midi::SmfMemorySink sink(gFile, sFileSize);
+    midi::SmfWriter<midi::SmfMemorySink> writer(sink);
+    unsigned long time = 1000000;
+    unsigned count = 0;
+
+    gMidi.begin(MIDI_CHANNEL_OMNI);
+    gMidi.turnThruOff();
+    writer.begin(time);
+    while (gPort.available() > 0)
+    {
+        if (gMidi.read())
+        {
+            time += 1500;
+            writer.record(gMidi, time);
+            count++;
+        }
+    }
+    writer.end(time);
+    gFileLength = writer.getLength();
+    return count;
+}
+
+// Copy the track of the type 0 file to make a type 1 file.
+bool makeType1()
+{
+    const unsigned long trackLength = gFileLength - 14;
+    if (14 + trackLength * sTrackCount > sFileSize)
+    {
+        return false;
+    }
+    for (byte t = 1; t < sTrackCount; ++t)
+    {
+        memcpy(gFile + 14 + trackLength * t, gFile + 14, trackLength);
+    }
+    gFile[9]  = 1;              // Type 1
+    gFile[11] = sTrackCount;
+    gFileLength = 14 + trackLength * sTrackCount;
+    return true;
+}
+
+// Check the events of the first track against the stream, and the time order.
+bool check(unsigned inCount)
+{
+    midi::SmfMemorySource source(gFile, gFileLength);
+    midi::SmfReader<midi::SmfMemorySource> reader(source);
+    midi::SmfEvent event;
+    unsigned long lastTick = 0;
+    unsigned long lastTime = 0;
+    unsigned count = 0;
+    unsigned otherTracks = 0;
+    byte data[8];
+
+    if (!reader.begin() || reader.getTrackCount() != sTrackCount)
+    {
+        return false;
+    }
+
+    gPort.rewind();
+    gMidi.begin(MIDI_CHANNEL_OMNI);
+    while (reader.read(event))
+    {
+        if (event.tick < lastTick || event.time < lastTime)
+        {
+            return false;
+        }
+        lastTick = event.tick;
+        lastTime = event.time;
+
+        if (event.status == 0xff)
+        {
+            continue;
+        }
+        if (event.track != 0)
+        {
+            otherTracks++;
+            continue;
+        }
+        while (!gMidi.read())
+        {
+            if (gPort.available() == 0)
+            {
+                return false;
+            }
+        }
+        if (event.isChannelMessage())
+        {
+            if (event.getType() != gMidi.getType() || event.getChannel() != gMidi.getChannel() ||
+                event.data1 != gMidi.getData1() || event.data2 != gMidi.getData2())
+            {
+                return false;
+            }
+        }
+        else
+        {
+            // The array starts with 0xf0, which the event doesn't include.
+            const unsigned length = reader.readData(event, data, sizeof(data));
+            if (length + 1 != gMidi.getSysExArrayLength() ||
+                memcmp(data, gMidi.getSysExArray() + 1, length) != 0)
+            {
+                return false;
+            }
+        }
+        count++;
+    }
+    return count == inCount && otherTracks == inCount * (sTrackCount - 1);
+}
+
+unsigned long bench()
+{
+    midi::SmfMemorySource source(gFile, gFileLength);
+    midi::SmfReader<midi::SmfMemorySource> reader(source);
+    midi::SmfEvent event;
+    unsigned long events = 0;
+
+    const unsigned long start = micros();
+    for (unsigned pass = 0; pass < sPasses; ++pass)
+    {
+        reader.begin();
+        while (reader.read(event))
+        {
+            events++;
+        }
+    }
+    const unsigned long duration = micros() - start;
+
+    return events * 1000 / max(duration / 1000, 1UL);
+}
+
+// -----------------------------------------------------------------------------
+
+void setup()
+{
+    while(!Serial);
+    Serial.begin(115200);
+    Serial.println("Arduino Ready");
+}
+
+void loop()
+{
+    generateStream();
+    const unsigned count = record();
+
+    Serial.print("Recorded ");
+    Serial.print(count);
+    Serial.print(" messages in ");
+    Serial.print(gFileLength);
+    Serial.println(" bytes");
+
+    if (!makeType1())
+    {
+        Serial.println("The file buffer is too small");
+        return;
+    }
+    Serial.println(check(count) ? "Read back: OK" : "Read back: FAILED");
+
+    Serial.print("Type 1, ");
+    Serial.print(sTrackCount);
+    Serial.print(" tracks: ");
+    Serial.print(bench());
+    Serial.println(" events/s");
+    Serial.println();
+
+    delay(1000);
+}
@@ -0,0 +1,67 @@
+#include <MIDI.h>
+#include <midi_Smf.h>
+
+// This program will play a Standard MIDI File stored in flash, in a loop.
+// Events are read one at a time, each is sent once micros() reaches its time,
+// so the file can be much bigger than the RAM. Reading a file from an SD card
+// works the same, with a File object as the source.
+
+MIDI_CREATE_DEFAULT_INSTANCE();
+
+// A type 1 file with a tempo track and an arpeggio on channel 1, 96 ticks per
+// quarter note.
+const byte sSong[] PROGMEM = {
+    'M', 'T', 'h', 'd', 0, 0, 0, 6,   0, 1,   0, 2,   0, 96,
+    'M', 'T', 'r', 'k', 0, 0, 0, 11,
+        0x00, 0xff, 0x51, 0x03, 0x07, 0xa1, 0x20,   // 120 BPM
+        0x00, 0xff, 0x2f, 0x00,
+    'M', 'T', 'r', 'k', 0, 0, 0, 29,
+        0x00, 0x90, 60, 100,    0x30, 60, 0,    // Running status, NoteOn
+        0x00, 64, 100,          0x30, 64, 0,    // with a null velocity
+        0x00, 67, 100,          0x30, 67, 0,    // as NoteOff.
+        0x00, 72, 100,          0x60, 72, 0,
+        0x00, 0xff, 0x2f, 0x00,
+};
+
+midi::SmfProgmemSource gSource(sSong, sizeof(sSong));
+midi::SmfReader<midi::SmfProgmemSource, 2> gReader(gSource);
+midi::SmfEvent gEvent;
+bool gHasEvent = false;
+unsigned long gStart = 0;
+
+// -----------------------------------------------------------------------------
+
+void setup()
+{
+    MIDI.begin(MIDI_CHANNEL_OMNI);
+    MIDI.turnThruOff();
+
+    gReader.begin();
+    gStart = micros();
+}
+
+void loop()
+{
+    if (!gHasEvent)
+    {
+        gHasEvent = gReader.read(gEvent);
+        if (!gHasEvent)
+        {
+            // Start over, one beat after the end, at the tempo the file
+            // ended with (begin() goes back to the default one).
+            const unsigned long beat = gReader.getTempo();
+            gReader.begin();
+            gStart = micros() + beat;
+            return;
+        }
+    }
+
+    if ((long)(micros() - (gStart + gEvent.time)) >= 0)
+    {
+        if (gEvent.isChannelMessage())
+        {
+            MIDI.send(gEvent.getType(), gEvent.data1, gEvent.data2, gEvent.getChannel());
+        }
+        gHasEvent = false;
+    }
+}
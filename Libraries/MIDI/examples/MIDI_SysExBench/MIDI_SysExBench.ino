@@ -0,0 +1,214 @@
+#include <MIDI.h>
+
+// This program will check that encodeSysEx and decodeSysEx, which work on
+// whole groups of 7/8 bytes, and the chunked SysExEncoder and SysExDecoder
+// give the same results as the original byte per byte functions (kept below
+// as a reference), on random data, lengths and chunk sizes.
+// It will then measure how many bytes per second each of them can handle.
+// Results are printed through the USB serial port.
+
+static const unsigned sDataSize   = 448;    // 64 groups of 7 bytes
+static const unsigned sSysExSize  = 512;    // Encoded size of sDataSize
+static const unsigned sFuzzRounds = 2000;
+static const unsigned sPasses     = 200;
+
+byte gData[sDataSize];
+byte gSysEx[sSysExSize + 8];
+byte gReference[sSysExSize + 8];
+byte gDecoded[sDataSize + 8];
+
+// Size of the chunks given to SysExEncoder and SysExDecoder, 0 for random.
+unsigned gChunkSize = 0;
+
+// -----------------------------------------------------------------------------
+
+// The original byte per byte implementations.
+unsigned referenceEncode(const byte* inData, byte* outSysEx, unsigned inLength)
+{
+    unsigned outLength  = 0;
+    byte count          = 0;
+    outSysEx[0]         = 0;
+
+    for (unsigned i = 0; i < inLength; ++i)
+    {
+        const byte data = inData[i];
+        outSysEx[0] |= ((data >> 7) << count);
+        outSysEx[1 + count] = data & 0x7f;
+
+        if (count++ == 6)
+        {
+            outSysEx   += 8;
+            outLength  += 8;
+            outSysEx[0] = 0;
+            count       = 0;
+        }
+    }
+    return outLength + count + (count != 0 ? 1 : 0);
+}
+
+unsigned referenceDecode(const byte* inSysEx, byte* outData, unsigned inLength)
+{
+    unsigned count  = 0;
+    byte msbStorage = 0;
+
+    for (unsigned i = 0; i < inLength; ++i)
+    {
+        if ((i % 8) == 0)
+        {
+            msbStorage = inSysEx[i];
+        }
+        else
+        {
+            outData[count++] = inSysEx[i] | ((msbStorage & 1) << 7);
+            msbStorage >>= 1;
+        }
+    }
+    return count;
+}
+
+// -----------------------------------------------------------------------------
+
+void randomize(byte* outBuffer, unsigned inLength)
+{
+    for (unsigned i = 0; i < inLength; ++i)
+    {
+        outBuffer[i] = random(256);
+    }
+}
+
+unsigned nextChunkSize()
+{
+    return gChunkSize != 0 ? gChunkSize : random(1, 20);
+}
+
+unsigned encodeInChunks(const byte* inData, byte* outSysEx, unsigned inLength)
+{
+    midi::SysExEncoder encoder;
+    unsigned length = 0;
+    while (inLength > 0)
+    {
+        unsigned chunk = nextChunkSize();
+        if (chunk > inLength) chunk = inLength;
+        length   += encoder.encode(inData, chunk, outSysEx + length);
+        inData   += chunk;
+        inLength -= chunk;
+    }
+    return length + encoder.flush(outSysEx + length);
+}
+
+unsigned decodeInChunks(const byte* inSysEx, byte* outData, unsigned inLength)
+{
+    midi::SysExDecoder decoder;
+    unsigned length = 0;
+    while (inLength > 0)
+    {
+        unsigned chunk = nextChunkSize();
+        if (chunk > inLength) chunk = inLength;
+        length   += decoder.decode(inSysEx, chunk, outData + length);
+        inSysEx  += chunk;
+        inLength -= chunk;
+    }
+    return length;
+}
+
+bool same(const byte* inA, const byte* inB, unsigned inLength)
+{
+    return memcmp(inA, inB, inLength) == 0;
+}
+
+// Returns the number of rounds that didn't match the reference.
+unsigned fuzz()
+{
+    unsigned failures = 0;
+
+    for (unsigned round = 0; round < sFuzzRounds; ++round)
+    {
+        const unsigned dataLength  = random(sDataSize + 1);
+        const unsigned sysExLength = random(sSysExSize + 1);
+        bool ok = true;
+
+        randomize(gData, dataLength);
+        const unsigned refLength = referenceEncode(gData, gReference, dataLength);
+        unsigned length = midi::encodeSysEx(gData, gSysEx, dataLength);
+        ok = ok && length == refLength && same(gSysEx, gReference, length);
+        length = encodeInChunks(gData, gSysEx, dataLength);
+        ok = ok && length == refLength && same(gSysEx, gReference, length);
+        ok = ok && refLength == midi::SysExEncoder::getEncodedLength(dataLength);
+
+        // Any byte value, including invalid ones with their MSB set.
+        randomize(gSysEx, sysExLength);
+        const unsigned refDecoded = referenceDecode(gSysEx, gReference, sysExLength);
+        length = midi::decodeSysEx(gSysEx, gDecoded, sysExLength);
+        ok = ok && length == refDecoded && same(gDecoded, gReference, length);
+        length = decodeInChunks(gSysEx, gDecoded, sysExLength);
+        ok = ok && length == refDecoded && same(gDecoded, gReference, length);
+        ok = ok && refDecoded == midi::SysExDecoder::getDecodedLength(sysExLength);
+
+        if (!ok)
+        {
+            failures++;
+        }
+    }
+    return failures;
+}
+
+// -----------------------------------------------------------------------------
+
+typedef unsigned (*Codec)(const byte*, byte*, unsigned);
+
+void bench(const char* inName, Codec inCodec, const byte* inInput, byte* outOutput, unsigned inLength)
+{
+    const unsigned long start = micros();
+    for (unsigned pass = 0; pass < sPasses; ++pass)
+    {
+        inCodec(inInput, outOutput, inLength);
+    }
+    const unsigned long duration = micros() - start;
+
+    Serial.print(inName);
+    Serial.print((unsigned long)inLength * sPasses * 1000 / max(duration, 1UL));
+    Serial.println(" KB/s");
+}
+
+unsigned encodeWords(const byte* inData, byte* outSysEx, unsigned inLength)
+{
+    return midi::encodeSysEx(inData, outSysEx, inLength);
+}
+
+unsigned decodeWords(const byte* inSysEx, byte* outData, unsigned inLength)
+{
+    return midi::decodeSysEx(inSysEx, outData, inLength);
+}
+
+// -----------------------------------------------------------------------------
+
+void setup()
+{
+    while(!Serial);
+    Serial.begin(115200);
+    Serial.println("Arduino Ready");
+}
+
+void loop()
+{
+    Serial.print("Mismatches: ");
+    Serial.print(fuzz());
+    Serial.print(" out of ");
+    Serial.println(sFuzzRounds);
+
+    // Chunks of the size of a serial port buffer.
+    gChunkSize = 64;
+    randomize(gData, sDataSize);
+    midi::encodeSysEx(gData, gSysEx, sDataSize);
+
+    bench("Encode, byte per byte: ", referenceEncode, gData, gSysEx, sDataSize);
+    bench("Encode, whole groups:  ", encodeWords, gData, gSysEx, sDataSize);
+    bench("Encode, in chunks:     ", encodeInChunks, gData, gSysEx, sDataSize);
+    bench("Decode, byte per byte: ", referenceDecode, gSysEx, gDecoded, sSysExSize);
+    bench("Decode, whole groups:  ", decodeWords, gSysEx, gDecoded, sSysExSize);
+    bench("Decode, in chunks:     ", decodeInChunks, gSysEx, gDecoded, sSysExSize);
+    Serial.println();
+
+    gChunkSize = 0;
+    delay(1000);
+}
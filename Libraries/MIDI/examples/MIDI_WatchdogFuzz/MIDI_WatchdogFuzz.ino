@@ -0,0 +1,357 @@
+#include <MIDI.h>
+#include <midi_MockSerial.h>
+#include <midi_Watchdog.h>
+
+// This program will check midi::HeldNotes against a reference list of held
+// notes, on random streams of NoteOn, NoteOff (some as null velocity NoteOn),
+// All Notes Off, All Sound Off and System Reset messages, on all 16 channels.
+// After each stream, the notes are released through a MidiInterface (running
+// status is on by default), into a MockSerial (see midi_MockSerial.h). The output is
+// parsed back, to check that each held note got exactly one NoteOff, with
+// 2 bytes per NoteOff after the first of each channel.
+// It then checks midi::ActiveSensingWatchdog on a few timelines, including
+// one where micros() wraps around.
+// It runs the same on the board or on a host computer (see extras/host).
+// Results are printed through the USB serial port.
+
+struct FuzzSettings : public midi::DefaultSettings
+{
+    static const unsigned SysExMaxSize = 0;
+};
+
+static const byte sMaxHeld          = 48;
+static const unsigned sMessages     = 200;
+static const unsigned sStreamCount  = 200;
+
+// -----------------------------------------------------------------------------
+
+// Held notes as an unsorted list of (channel, note) pairs, the simplest thing
+// that can't share a bug with the bit maps of HeldNotes.
+class ReferenceNotes
+{
+public:
+    void clear()
+    {
+        mCount = 0;
+    }
+
+    void clear(byte inChannel)
+    {
+        for (byte i = 0; i < mCount; )
+        {
+            if (mChannels[i] == inChannel)
+                removeAt(i);
+            else
+                ++i;
+        }
+    }
+
+    void noteOn(byte inChannel, byte inNote)
+    {
+        if (find(inChannel, inNote) == mCount && mCount < sMaxHeld)
+        {
+            mChannels[mCount] = inChannel;
+            mNotes[mCount] = inNote;
+            mCount++;
+        }
+    }
+
+    // Returns false if the note wasn't held.
+    bool noteOff(byte inChannel, byte inNote)
+    {
+        const byte index = find(inChannel, inNote);
+        if (index == mCount)
+            return false;
+
+        removeAt(index);
+        return true;
+    }
+
+    bool isHeld(byte inChannel, byte inNote) const
+    {
+        return find(inChannel, inNote) != mCount;
+    }
+
+    byte getCount() const
+    {
+        return mCount;
+    }
+
+    byte getChannelCount() const
+    {
+        unsigned mask = 0;
+        byte count = 0;
+        for (byte i = 0; i < mCount; ++i)
+        {
+            if (!(mask & (1U << (mChannels[i] - 1))))
+            {
+                mask |= 1U << (mChannels[i] - 1);
+                count++;
+            }
+        }
+        return count;
+    }
+
+    void get(byte inIndex, byte& outChannel, byte& outNote) const
+    {
+        outChannel = mChannels[inIndex];
+        outNote = mNotes[inIndex];
+    }
+
+private:
+    byte find(byte inChannel, byte inNote) const
+    {
+        for (byte i = 0; i < mCount; ++i)
+        {
+            if (mChannels[i] == inChannel && mNotes[i] == inNote)
+                return i;
+        }
+        return mCount;
+    }
+
+    void removeAt(byte inIndex)
+    {
+        mCount--;
+        mChannels[inIndex] = mChannels[mCount];
+        mNotes[inIndex] = mNotes[mCount];
+    }
+
+private:
+    byte mChannels[sMaxHeld];
+    byte mNotes[sMaxHeld];
+    byte mCount;
+};
+
+// -----------------------------------------------------------------------------
+
+byte gOutput[sMaxHeld * 3];
+
+midi::MockSerial gPort;
+midi::MidiInterface<midi::MockSerial, FuzzSettings> gMidi(gPort);
+
+midi::HeldNotes gHeldNotes;
+ReferenceNotes gReference;
+
+unsigned long gMessageCount = 0;
+unsigned long gReleaseCount = 0;
+unsigned long gMismatchCount = 0;
+
+// -----------------------------------------------------------------------------
+
+// Only the first mismatches are printed.
+bool countMismatch()
+{
+    gMismatchCount++;
+    return gMismatchCount <= 10;
+}
+
+void reportNote(const char* inWhat, byte inChannel, byte inNote)
+{
+    if (!countMismatch())
+        return;
+
+    Serial.print(inWhat);
+    Serial.print(" mismatch, channel ");
+    Serial.print(inChannel);
+    Serial.print(", note ");
+    Serial.println(inNote);
+}
+
+void reportValue(const char* inWhat, unsigned inValue, unsigned inExpected)
+{
+    if (!countMismatch())
+        return;
+
+    Serial.print(inWhat);
+    Serial.print(" mismatch, got ");
+    Serial.print(inValue);
+    Serial.print(", expected ");
+    Serial.println(inExpected);
+}
+
+void sendRandomMessage()
+{
+    const byte kind = random(64);
+    byte channel = random(1, 17);
+    byte note = random(128);
+
+    // Mostly play on a few channels, so that NoteOffs find held notes.
+    if (random(4) != 0)
+    {
+        channel = random(1, 4);
+        note = 60 + random(12);
+    }
+
+    if (kind < 30 && gReference.getCount() < sMaxHeld)
+    {
+        gHeldNotes.update(midi::NoteOn, channel, note, random(1, 128));
+        gReference.noteOn(channel, note);
+    }
+    else if (kind < 61)
+    {
+        // Release a held note most of the time.
+        if (gReference.getCount() > 0 && random(4) != 0)
+            gReference.get(random(gReference.getCount()), channel, note);
+
+        const bool nullVelocity = random(2) == 0;
+        gHeldNotes.update(nullVelocity ? midi::NoteOn : midi::NoteOff, channel, note, 0);
+        gReference.noteOff(channel, note);
+    }
+    else if (kind < 63)
+    {
+        const byte control = kind == 61 ? midi::AllNotesOff : midi::AllSoundOff;
+        gHeldNotes.update(midi::ControlChange, channel, control, 0);
+        gReference.clear(channel);
+    }
+    else if (random(4) == 0)
+    {
+        gHeldNotes.update(midi::SystemReset, 0, 0, 0);
+        gReference.clear();
+    }
+
+    gMessageCount++;
+
+    if (gHeldNotes.isHeld(channel, note) != gReference.isHeld(channel, note))
+        reportNote("isHeld", channel, note);
+}
+
+void checkAllNotes()
+{
+    for (byte channel = 1; channel <= 16; ++channel)
+    {
+        for (byte note = 0; note < 128; ++note)
+        {
+            if (gHeldNotes.isHeld(channel, note) != gReference.isHeld(channel, note))
+                reportNote("Held notes", channel, note);
+        }
+    }
+
+    if (gHeldNotes.isEmpty() != (gReference.getCount() == 0))
+        reportValue("isEmpty", gHeldNotes.isEmpty(), gReference.getCount() == 0);
+}
+
+void checkRelease()
+{
+    const byte held = gReference.getCount();
+    const byte channels = gReference.getChannelCount();
+
+    // The output is parsed by a new decoder: start without running status.
+    gMidi.begin(MIDI_CHANNEL_OMNI);
+    gPort.setOutput(gOutput, sizeof(gOutput));
+    const unsigned released = gHeldNotes.releaseAll(gMidi);
+    gReleaseCount += released;
+
+    if (released != held)
+        reportValue("Release count", released, held);
+    if (gPort.getOutputLength() != 2U * held + channels)
+        reportValue("Output length", gPort.getOutputLength(), 2U * held + channels);
+    if (!gHeldNotes.isEmpty())
+        reportValue("isEmpty after release", false, true);
+
+    // Parse the NoteOffs back, each must release a held note.
+    midi::MockSerial output;
+    midi::MidiInterface<midi::MockSerial, FuzzSettings> decoder(output);
+    decoder.begin(MIDI_CHANNEL_OMNI);
+    decoder.turnThruOff();
+    output.setInput(gOutput, gPort.getOutputLength());
+
+    while (!output.isFinished())
+    {
+        if (decoder.read())
+        {
+            if (decoder.getType() != midi::NoteOff ||
+                !gReference.noteOff(decoder.getChannel(), decoder.getData1()))
+            {
+                reportNote("Released note", decoder.getChannel(), decoder.getData1());
+            }
+        }
+    }
+
+    if (gReference.getCount() != 0)
+        reportValue("Notes left held", gReference.getCount(), 0);
+    gReference.clear();
+}
+
+void checkStream()
+{
+    for (unsigned i = 0; i < sMessages; ++i)
+        sendRandomMessage();
+
+    checkAllNotes();
+    checkRelease();
+}
+
+// -----------------------------------------------------------------------------
+
+void expectTimeouts(byte inTimedOut, byte inExpected, const char* inName)
+{
+    if (inTimedOut != inExpected)
+        reportValue(inName, inTimedOut, inExpected);
+}
+
+void checkWatchdog()
+{
+    typedef midi::ActiveSensingWatchdog<3> Watchdog;
+    const unsigned long timeout = Watchdog::sTimeout;
+
+    Watchdog watchdog;
+    expectTimeouts(watchdog.update(10 * timeout), 0, "Not sensing yet");
+
+    // Input 0 only sends notes, it is never watched.
+    watchdog.receive(0, midi::NoteOn, 100);
+    watchdog.receive(1, midi::ActiveSensing, 100);
+    watchdog.receive(2, midi::ActiveSensing, 100);
+    expectTimeouts(watchdog.update(100 + timeout), 0, "Alive");
+
+    // Any message keeps an input alive, not only Active Sensing.
+    watchdog.receive(2, midi::Clock, 100 + timeout);
+    expectTimeouts(watchdog.update(101 + timeout), 0x02, "Silent input");
+    expectTimeouts(watchdog.update(102 + timeout), 0, "Reported once");
+    expectTimeouts(watchdog.update(101 + 2 * timeout), 0x04, "Second input");
+
+    // A timed out input is watched again from its next Active Sensing.
+    watchdog.receive(1, midi::NoteOn, 200 + 2 * timeout);
+    expectTimeouts(watchdog.update(201 + 3 * timeout), 0, "Not watched");
+    watchdog.receive(1, midi::ActiveSensing, 300 + 3 * timeout);
+    expectTimeouts(watchdog.update(301 + 4 * timeout), 0x02, "Watched again");
+
+    // micros() wraps around every 71 minutes.
+    const unsigned long beforeWrap = 0UL - timeout / 2;
+    watchdog.receive(0, midi::ActiveSensing, beforeWrap);
+    expectTimeouts(watchdog.update(beforeWrap + timeout), 0, "Wrap, alive");
+    expectTimeouts(watchdog.update(beforeWrap + timeout + 1), 0x01, "Wrap, silent");
+}
+
+// -----------------------------------------------------------------------------
+
+void setup()
+{
+    while(!Serial);
+    Serial.begin(115200);
+    Serial.println("Arduino Ready");
+}
+
+void loop()
+{
+    gMessageCount = 0;
+    gReleaseCount = 0;
+    gMismatchCount = 0;
+
+    gHeldNotes.clear();
+    gReference.clear();
+    for (unsigned i = 0; i < sStreamCount; ++i)
+        checkStream();
+
+    checkWatchdog();
+
+    Serial.print("Checked ");
+    Serial.print(gMessageCount);
+    Serial.print(" messages and ");
+    Serial.print(gReleaseCount);
+    Serial.print(" released notes, ");
+    Serial.print(gMismatchCount);
+    Serial.println(" mismatches");
+    Serial.println();
+
+    delay(1000);
+}
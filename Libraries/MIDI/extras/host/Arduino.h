@@ -0,0 +1,105 @@
+/*!
+ *  @file       Arduino.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Host stand-in for the Arduino core
+ *  @version    4.2
+ *  @author     Francois Best
+ *  @date       24/02/11
+ *  @license    GPL v3.0 - Copyright Forty Seven Effects 2014
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Just what the examples that run on memory serial ports need to build on a
+// host computer: integer types, timing, random numbers and a Serial object
+// printing to the standard output. The library itself is built without this
+// file (ARDUINO is left undefined), see the Makefile.
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef uint16_t word;
+
+#define HIGH    1
+#define LOW     0
+#define INPUT   0
+#define OUTPUT  1
+
+#define DEC     10
+#define HEX     16
+#define OCT     8
+#define BIN     2
+
+#define min(a, b)   ((a) < (b) ? (a) : (b))
+#define max(a, b)   ((a) > (b) ? (a) : (b))
+#define F(inString) inString
+
+#define noInterrupts()
+#define interrupts()
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long inMillis);
+
+long random(long inMax);
+long random(long inMin, long inMax);
+void randomSeed(unsigned long inSeed);
+
+inline void pinMode(uint8_t, uint8_t)       {}
+inline void digitalWrite(uint8_t, uint8_t)  {}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Serial port writing to the standard output, with the print and
+ println overloads of the Arduino Print class. It never receives anything.
+ */
+class HardwareSerial
+{
+public:
+    void begin(unsigned long)       {}
+    int available()                 { return 0; }
+    int read()                      { return -1; }
+    size_t write(uint8_t inByte);
+    operator bool()                 { return true; }
+
+public:
+    size_t print(const char* inString);
+    size_t print(char inChar)                                   { return write(inChar); }
+    size_t print(unsigned char inValue, int inBase = DEC)       { return print((unsigned long)inValue, inBase); }
+    size_t print(int inValue, int inBase = DEC)                 { return print((long)inValue, inBase); }
+    size_t print(unsigned int inValue, int inBase = DEC)        { return print((unsigned long)inValue, inBase); }
+    size_t print(long inValue, int inBase = DEC);
+    size_t print(unsigned long inValue, int inBase = DEC);
+    size_t print(double inValue, int inDigits = 2);
+
+    size_t println()                                            { return write('\n'); }
+    template<class Value> size_t println(Value inValue)         { return print(inValue) + println(); }
+    template<class Value> size_t println(Value inValue, int inFormat)
+    {
+        return print(inValue, inFormat) + println();
+    }
+};
+
+extern HardwareSerial Serial;
+
+// -----------------------------------------------------------------------------
+
+void setup();
+void loop();
@@ -0,0 +1,132 @@
+/*!
+ *  @file       main.cpp
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Host stand-in for the Arduino core
+ *  @version    4.2
+ *  @author     Francois Best
+ *  @date       24/02/11
+ *  @license    GPL v3.0 - Copyright Forty Seven Effects 2014
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Arduino.h"
+#include <stdio.h>
+#include <time.h>
+
+HardwareSerial Serial;
+
+// -----------------------------------------------------------------------------
+
+static unsigned long long getNanos()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static const unsigned long long sStart = getNanos();
+
+unsigned long millis()
+{
+    return (unsigned long)((getNanos() - sStart) / 1000000);
+}
+
+unsigned long micros()
+{
+    return (unsigned long)((getNanos() - sStart) / 1000);
+}
+
+void delay(unsigned long inMillis)
+{
+    const timespec duration = { (time_t)(inMillis / 1000), (long)(inMillis % 1000) * 1000000 };
+    nanosleep(&duration, 0);
+}
+
+// Seeded the same on every run, like the boards, so that runs can be compared.
+long random(long inMax)
+{
+    return inMax > 0 ? rand() % inMax : 0;
+}
+
+long random(long inMin, long inMax)
+{
+    return inMin < inMax ? inMin + random(inMax - inMin) : inMin;
+}
+
+void randomSeed(unsigned long inSeed)
+{
+    if (inSeed != 0)
+        srand((unsigned)inSeed);
+}
+
+// -----------------------------------------------------------------------------
+
+size_t HardwareSerial::write(uint8_t inByte)
+{
+    return putchar(inByte) == EOF ? 0 : 1;
+}
+
+size_t HardwareSerial::print(const char* inString)
+{
+    return fputs(inString, stdout) == EOF ? 0 : strlen(inString);
+}
+
+size_t HardwareSerial::print(long inValue, int inBase)
+{
+    if (inBase == DEC && inValue < 0)
+        return write('-') + print(0UL - (unsigned long)inValue, DEC);
+    return print((unsigned long)inValue, inBase);
+}
+
+size_t HardwareSerial::print(unsigned long inValue, int inBase)
+{
+    char digits[8 * sizeof(unsigned long) + 1];
+    char* digit = digits + sizeof(digits) - 1;
+    *digit = 0;
+
+    const unsigned long base = inBase < 2 ? 10 : inBase;
+    do
+    {
+        const unsigned long value = inValue % base;
+        *--digit = value < 10 ? '0' + value : 'A' + value - 10;
+        inValue /= base;
+    }
+    while (inValue != 0);
+    return print(digit);
+}
+
+size_t HardwareSerial::print(double inValue, int inDigits)
+{
+    const int length = printf("%.*f", inDigits, inValue);
+    return length < 0 ? 0 : length;
+}
+
+// -----------------------------------------------------------------------------
+
+/*! Runs setup(), then loop() as many times as the first argument says (once
+ by default), and flushes what was printed.
+ */
+int main(int argc, char** argv)
+{
+    const long loops = argc > 1 ? atol(argv[1]) : 1;
+
+    setup();
+    for (long i = 0; i < loops; ++i)
+    {
+        loop();
+        fflush(stdout);
+    }
+    return 0;
+}
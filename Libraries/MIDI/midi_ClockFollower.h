@@ -0,0 +1,297 @@
+/*!
+ *  @file       midi_ClockFollower.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - MIDI Clock follower
+ *  @version    4.2
+ *  @author     Francois Best
+ *  @date       24/02/11
+ *  @license    GPL v3.0 - Copyright Forty Seven Effects 2014
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "midi_Defs.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Follows the tempo and position of a received MIDI Clock, with a
+ finer resolution than its 24 pulses per quarter note.
+
+ Feed it with the Clock, Start, Continue, Stop and Song Position messages
+ (from the callbacks of a MidiInterface, for instance), with the time each
+ Clock was received. Then call update from loop(): it returns true each time
+ a tick is due, Ppqn ticks per quarter note (a multiple of 24, like 96 or 384).
+
+ Ticks falling on a Clock are due as soon as that Clock is received, the
+ ticks in between are spread evenly, using the tempo measured on the previous
+ Clocks and smoothed out, so that they don't follow the jitter of a single
+ Clock. Each Clock puts the ticks back in phase, and ticks never get ahead of
+ the Clock: if it stops or slows down, the ticks wait for it. Ticks are never
+ skipped either, late ticks are all due right away.
+
+ \code{.cpp}
+ midi::ClockFollower<96> follower;
+
+ void handleClock() { follower.clock(micros()); }
+ void handleStart() { follower.start(); }
+ ...
+ void loop()
+ {
+     MIDI.read();
+     while (follower.update(micros()))
+         step(follower.getTick());
+ }
+ \endcode
+ */
+template<unsigned Ppqn = 96>
+class ClockFollower
+{
+public:
+    static const byte sTicksPerClock = Ppqn / 24;
+
+public:
+    inline ClockFollower();
+
+public:
+    inline void clock(unsigned long inTime);
+    inline void start();
+    inline void resume();
+    inline void stop();
+    inline void setSongPosition(unsigned inBeats);
+
+public:
+    inline bool update(unsigned long inTime);
+
+public:
+    inline unsigned long getTick() const;
+    inline bool isPlaying() const;
+    inline unsigned long getClockPeriod() const;
+    inline unsigned long getTickPeriod() const;
+    inline float getBpm() const;
+
+private:
+    typedef char PpqnMustBeAMultipleOf24[(Ppqn > 0 && Ppqn % 24 == 0 && Ppqn / 24 < 256) ? 1 : -1];
+
+    /*! Each Clock moves the smoothed period by 1/2^sSmoothing of its error.
+     */
+    static const byte sSmoothing = 3;
+
+    /*! Clocks further apart than that (10 BPM) mean the Clock was interrupted.
+     */
+    static const unsigned long sTimeout = 250000;
+
+private:
+    inline void measure(unsigned long inPeriod);
+
+private:
+    unsigned long mLastClockTime;
+    unsigned long mPeriod;          ///< Smoothed period of the Clock, 0 until known.
+    unsigned long mClocks;          ///< Clocks received since Start.
+    unsigned long mTicks;           ///< Ticks returned by update since Start.
+    unsigned long mTickClock;       ///< Clock of the next tick.
+    byte mTickPhase;                ///< Position of the next tick in its Clock.
+    byte mOutliers;
+    bool mHasLastClock;
+    bool mPlaying;
+};
+
+// -----------------------------------------------------------------------------
+
+template<unsigned Ppqn>
+inline ClockFollower<Ppqn>::ClockFollower()
+    : mLastClockTime(0)
+    , mPeriod(0)
+    , mClocks(0)
+    , mTicks(0)
+    , mTickClock(0)
+    , mTickPhase(0)
+    , mOutliers(0)
+    , mHasLastClock(false)
+    , mPlaying(false)
+{
+}
+
+/*! \brief To call when a Clock message is received.
+ \param inTime The reception time, in microseconds (from micros()).
+
+ The tempo is measured even when stopped, so that ticks are evenly spread
+ right from the start.
+ */
+template<unsigned Ppqn>
+inline void ClockFollower<Ppqn>::clock(unsigned long inTime)
+{
+    if (mHasLastClock)
+    {
+        const unsigned long period = inTime - mLastClockTime;
+        if (period < sTimeout)
+        {
+            measure(period);
+        }
+    }
+    mLastClockTime = inTime;
+    mHasLastClock = true;
+
+    if (mPlaying)
+    {
+        mClocks++;
+    }
+}
+
+/*! \brief To call when a Start message is received: ticks start over from 0
+ with the next Clock.
+ */
+template<unsigned Ppqn>
+inline void ClockFollower<Ppqn>::start()
+{
+    mClocks = 0;
+    mTicks = 0;
+    mTickClock = 0;
+    mTickPhase = 0;
+    mPlaying = true;
+}
+
+/*! \brief To call when a Continue message is received.
+ */
+template<unsigned Ppqn>
+inline void ClockFollower<Ppqn>::resume()
+{
+    mPlaying = true;
+}
+
+/*! \brief To call when a Stop message is received.
+ */
+template<unsigned Ppqn>
+inline void ClockFollower<Ppqn>::stop()
+{
+    mPlaying = false;
+}
+
+/*! \brief To call when a Song Position message is received.
+ \param inBeats The position, in sixteenth notes (6 Clocks).
+ */
+template<unsigned Ppqn>
+inline void ClockFollower<Ppqn>::setSongPosition(unsigned inBeats)
+{
+    mClocks = (unsigned long)inBeats * 6;
+    mTickClock = mClocks;
+    mTickPhase = 0;
+    mTicks = mClocks * sTicksPerClock;
+}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Check whether a tick is due.
+ \param inTime The current time, in microseconds (from micros()).
+ \return True when a tick is due, getTick then gives its number. Call it
+ again until it returns false, in case several ticks are due.
+ */
+template<unsigned Ppqn>
+inline bool ClockFollower<Ppqn>::update(unsigned long inTime)
+{
+    if (!mPlaying || mTickClock >= mClocks)
+    {
+        return false; // Waiting for the Clock of this tick.
+    }
+
+    if (mTickPhase != 0 && mTickClock + 1 == mClocks)
+    {
+        // Between the last Clock received and the next one.
+        if (mPeriod == 0 ||
+            inTime - mLastClockTime < mPeriod * mTickPhase / sTicksPerClock)
+        {
+            return false;
+        }
+    }
+
+    mTicks++;
+    if (++mTickPhase == sTicksPerClock)
+    {
+        mTickPhase = 0;
+        mTickClock++;
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Get the number of the last tick returned by update, from 0 at Start.
+ */
+template<unsigned Ppqn>
+inline unsigned long ClockFollower<Ppqn>::getTick() const
+{
+    return mTicks - 1;
+}
+
+template<unsigned Ppqn>
+inline bool ClockFollower<Ppqn>::isPlaying() const
+{
+    return mPlaying;
+}
+
+/*! \brief Get the smoothed time between two Clocks, in microseconds, or 0 if
+ it isn't known yet.
+ */
+template<unsigned Ppqn>
+inline unsigned long ClockFollower<Ppqn>::getClockPeriod() const
+{
+    return mPeriod;
+}
+
+/*! \brief Get the time between two ticks, in microseconds, or 0 if it isn't
+ known yet.
+ */
+template<unsigned Ppqn>
+inline unsigned long ClockFollower<Ppqn>::getTickPeriod() const
+{
+    return mPeriod / sTicksPerClock;
+}
+
+/*! \brief Get the tempo, in beats per minute, or 0 if it isn't known yet.
+ */
+template<unsigned Ppqn>
+inline float ClockFollower<Ppqn>::getBpm() const
+{
+    return mPeriod != 0 ? 60000000.0f / (24.0f * mPeriod) : 0.0f;
+}
+
+// -----------------------------------------------------------------------------
+
+template<unsigned Ppqn>
+inline void ClockFollower<Ppqn>::measure(unsigned long inPeriod)
+{
+    // A period off by more than a factor of 2 is a lost or doubled Clock,
+    // unless it happens twice in a row: then the tempo changed.
+    if (mPeriod != 0 && (inPeriod > mPeriod * 2 || inPeriod * 2 < mPeriod))
+    {
+        if (++mOutliers < 2)
+        {
+            return;
+        }
+        mPeriod = 0;
+    }
+    mOutliers = 0;
+
+    if (mPeriod == 0)
+    {
+        mPeriod = inPeriod;
+    }
+    else
+    {
+        mPeriod += ((long)inPeriod - (long)mPeriod) / (1 << sSmoothing);
+    }
+}
+
+END_MIDI_NAMESPACE
@@ -30,6 +30,10 @@
 #else
 #include <inttypes.h>
 typedef uint8_t byte;
+// Without Arduino, constant tables stay in RAM and are read as such.
+#define PROGMEM
+#define pgm_read_byte(inAddress)    (*(const uint8_t*)(inAddress))
+#define pgm_read_word(inAddress)    (*(const uint16_t*)(inAddress))
 #endif
 
 BEGIN_MIDI_NAMESPACE
@@ -85,6 +89,25 @@ enum MidiFilterMode
     Full                  = 1,  ///< Fully enabled Thru (every incoming message is sent back).
     SameChannel           = 2,  ///< Only the messages on the Input Channel will be sent back.
     DifferentChannel      = 3,  ///< All the messages but the ones on the Input Channel will be sent back.
+    Raw                   = 4,  ///< Incoming bytes are sent back as soon as they are received, see MidiInterface::setThruChannelMask.
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Flags telling where a chunk of streamed SysEx lies in its message.
+
+ With a SysEx chunk callback (see MidiInterface::setHandleSystemExclusiveChunk),
+ SysEx messages of any length are received through the SysEx buffer, which is
+ handed over to the callback each time it is full, and when 0xf7 is received.
+ A message that fits in the buffer comes in a single chunk, with both flags.
+ A message cut short by another status byte ends with an aborted chunk,
+ holding the bytes received since the previous chunk (maybe none).
+ */
+enum SysExChunkFlags
+{
+    SysExChunkFirst       = 0x01,   ///< The chunk starts the message, with 0xf0.
+    SysExChunkLast        = 0x02,   ///< The chunk ends the message, with 0xf7.
+    SysExChunkAborted     = 0x04,   ///< The message was truncated, without 0xf7.
 };
 
 // -----------------------------------------------------------------------------
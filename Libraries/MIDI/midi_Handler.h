@@ -0,0 +1,193 @@
+/*!
+ *  @file       midi_Handler.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Compile-time message handlers
+ *  @version    4.2
+ *  @author     Francois Best
+ *  @date       24/02/11
+ *  @license    GPL v3.0 - Copyright Forty Seven Effects 2014
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "midi_Defs.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Base class for compile-time message handlers.
+
+ An alternative to the setHandle******** callbacks: derive a class from
+ Handler, redefine the methods for the messages you are interested in, and
+ pass an instance to MidiInterface::dispatch or MidiInterface::dispatchAll.
+ \code{.cpp}
+ struct MyHandler : public midi::Handler
+ {
+    void handleNoteOn(byte inChannel, byte inNote, byte inVelocity)
+    {
+        // ...
+    }
+ };
+ \endcode
+ The right method is picked at compile time, so it is called directly (and
+ can be inlined), and the empty methods of the types you don't handle
+ vanish: they cost no code and no RAM. Callbacks take a function pointer per
+ type of message in each MidiInterface (38 bytes of RAM on AVR), unless they
+ are turned off with DefaultSettings::UseCallbacks.
+ */
+struct Handler
+{
+    inline void handleNoteOff(Channel, DataByte, DataByte)          {}
+    inline void handleNoteOn(Channel, DataByte, DataByte)           {}
+    inline void handleAfterTouchPoly(Channel, DataByte, DataByte)   {}
+    inline void handleControlChange(Channel, DataByte, DataByte)    {}
+    inline void handleProgramChange(Channel, DataByte)              {}
+    inline void handleAfterTouchChannel(Channel, DataByte)          {}
+    inline void handlePitchBend(Channel, int)                       {}
+    inline void handleSystemExclusive(byte*, unsigned)              {}
+    inline void handleTimeCodeQuarterFrame(DataByte)                {}
+    inline void handleSongPosition(unsigned)                        {}
+    inline void handleSongSelect(DataByte)                          {}
+    inline void handleTuneRequest()                                 {}
+    inline void handleClock()                                       {}
+    inline void handleStart()                                       {}
+    inline void handleContinue()                                    {}
+    inline void handleStop()                                        {}
+    inline void handleActiveSensing()                               {}
+    inline void handleSystemReset()                                 {}
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief The setHandle******** callbacks of a MidiInterface, as a Handler
+ calling the functions that were set. See DefaultSettings::UseCallbacks.
+ */
+template<bool Enabled>
+struct Callbacks : public Handler
+{
+    inline Callbacks()
+        : mNoteOffCallback(0)
+        , mNoteOnCallback(0)
+        , mAfterTouchPolyCallback(0)
+        , mControlChangeCallback(0)
+        , mProgramChangeCallback(0)
+        , mAfterTouchChannelCallback(0)
+        , mPitchBendCallback(0)
+        , mSystemExclusiveCallback(0)
+        , mSystemExclusiveChunkCallback(0)
+        , mTimeCodeQuarterFrameCallback(0)
+        , mSongPositionCallback(0)
+        , mSongSelectCallback(0)
+        , mTuneRequestCallback(0)
+        , mClockCallback(0)
+        , mStartCallback(0)
+        , mContinueCallback(0)
+        , mStopCallback(0)
+        , mActiveSensingCallback(0)
+        , mSystemResetCallback(0)
+    {
+    }
+
+    inline void handleNoteOff(Channel inChannel, DataByte inNote, DataByte inVelocity)          { if (mNoteOffCallback != 0)               mNoteOffCallback(inChannel, inNote, inVelocity); }
+    inline void handleNoteOn(Channel inChannel, DataByte inNote, DataByte inVelocity)           { if (mNoteOnCallback != 0)                mNoteOnCallback(inChannel, inNote, inVelocity); }
+    inline void handleAfterTouchPoly(Channel inChannel, DataByte inNote, DataByte inPressure)   { if (mAfterTouchPolyCallback != 0)        mAfterTouchPolyCallback(inChannel, inNote, inPressure); }
+    inline void handleControlChange(Channel inChannel, DataByte inNumber, DataByte inValue)     { if (mControlChangeCallback != 0)         mControlChangeCallback(inChannel, inNumber, inValue); }
+    inline void handleProgramChange(Channel inChannel, DataByte inNumber)                       { if (mProgramChangeCallback != 0)         mProgramChangeCallback(inChannel, inNumber); }
+    inline void handleAfterTouchChannel(Channel inChannel, DataByte inPressure)                 { if (mAfterTouchChannelCallback != 0)     mAfterTouchChannelCallback(inChannel, inPressure); }
+    inline void handlePitchBend(Channel inChannel, int inBend)                                  { if (mPitchBendCallback != 0)             mPitchBendCallback(inChannel, inBend); }
+    inline void handleSystemExclusive(byte* inArray, unsigned inSize)                           { if (mSystemExclusiveCallback != 0)       mSystemExclusiveCallback(inArray, inSize); }
+    inline void handleTimeCodeQuarterFrame(DataByte inData)                                     { if (mTimeCodeQuarterFrameCallback != 0)  mTimeCodeQuarterFrameCallback(inData); }
+    inline void handleSongPosition(unsigned inBeats)                                            { if (mSongPositionCallback != 0)          mSongPositionCallback(inBeats); }
+    inline void handleSongSelect(DataByte inSongNumber)                                         { if (mSongSelectCallback != 0)            mSongSelectCallback(inSongNumber); }
+    inline void handleTuneRequest()                                                             { if (mTuneRequestCallback != 0)           mTuneRequestCallback(); }
+    inline void handleClock()                                                                   { if (mClockCallback != 0)                 mClockCallback(); }
+    inline void handleStart()                                                                   { if (mStartCallback != 0)                 mStartCallback(); }
+    inline void handleContinue()                                                                { if (mContinueCallback != 0)              mContinueCallback(); }
+    inline void handleStop()                                                                    { if (mStopCallback != 0)                  mStopCallback(); }
+    inline void handleActiveSensing()                                                           { if (mActiveSensingCallback != 0)         mActiveSensingCallback(); }
+    inline void handleSystemReset()                                                             { if (mSystemResetCallback != 0)           mSystemResetCallback(); }
+
+    /// SysEx are delivered in chunks by handleSystemExclusiveChunk.
+    inline bool hasSystemExclusiveChunkCallback() const
+    {
+        return mSystemExclusiveChunkCallback != 0;
+    }
+
+    inline void handleSystemExclusiveChunk(byte* inArray, unsigned inSize, byte inFlags)
+    {
+        mSystemExclusiveChunkCallback(inArray, inSize, inFlags);
+    }
+
+    inline void disconnect(MidiType inType)
+    {
+        switch (inType)
+        {
+            case NoteOff:               mNoteOffCallback                = 0; break;
+            case NoteOn:                mNoteOnCallback                 = 0; break;
+            case AfterTouchPoly:        mAfterTouchPolyCallback         = 0; break;
+            case ControlChange:         mControlChangeCallback          = 0; break;
+            case ProgramChange:         mProgramChangeCallback          = 0; break;
+            case AfterTouchChannel:     mAfterTouchChannelCallback      = 0; break;
+            case PitchBend:             mPitchBendCallback              = 0; break;
+            case SystemExclusive:       mSystemExclusiveCallback        = 0;
+                                        mSystemExclusiveChunkCallback   = 0; break;
+            case TimeCodeQuarterFrame:  mTimeCodeQuarterFrameCallback   = 0; break;
+            case SongPosition:          mSongPositionCallback           = 0; break;
+            case SongSelect:            mSongSelectCallback             = 0; break;
+            case TuneRequest:           mTuneRequestCallback            = 0; break;
+            case Clock:                 mClockCallback                  = 0; break;
+            case Start:                 mStartCallback                  = 0; break;
+            case Continue:              mContinueCallback               = 0; break;
+            case Stop:                  mStopCallback                   = 0; break;
+            case ActiveSensing:         mActiveSensingCallback          = 0; break;
+            case SystemReset:           mSystemResetCallback            = 0; break;
+            default:
+                break;
+        }
+    }
+
+    void (*mNoteOffCallback)(byte channel, byte note, byte velocity);
+    void (*mNoteOnCallback)(byte channel, byte note, byte velocity);
+    void (*mAfterTouchPolyCallback)(byte channel, byte note, byte velocity);
+    void (*mControlChangeCallback)(byte channel, byte, byte);
+    void (*mProgramChangeCallback)(byte channel, byte);
+    void (*mAfterTouchChannelCallback)(byte channel, byte);
+    void (*mPitchBendCallback)(byte channel, int);
+    void (*mSystemExclusiveCallback)(byte * array, unsigned size);
+    void (*mSystemExclusiveChunkCallback)(byte * array, unsigned size, byte flags);
+    void (*mTimeCodeQuarterFrameCallback)(byte data);
+    void (*mSongPositionCallback)(unsigned beats);
+    void (*mSongSelectCallback)(byte songnumber);
+    void (*mTuneRequestCallback)(void);
+    void (*mClockCallback)(void);
+    void (*mStartCallback)(void);
+    void (*mContinueCallback)(void);
+    void (*mStopCallback)(void);
+    void (*mActiveSensingCallback)(void);
+    void (*mSystemResetCallback)(void);
+};
+
+/*! Without callbacks, nothing is called, and the setHandle******** methods
+ don't compile.
+ */
+template<>
+struct Callbacks<false> : public Handler
+{
+    inline bool hasSystemExclusiveChunkCallback() const                 { return false; }
+    inline void handleSystemExclusiveChunk(byte*, unsigned, byte)       {}
+    inline void disconnect(MidiType)                                    {}
+};
+
+END_MIDI_NAMESPACE
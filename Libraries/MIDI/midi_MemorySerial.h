@@ -0,0 +1,79 @@
+/*!
+ *  @file       midi_MemorySerial.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Serial port in memory, for benchmarks
+ *  @version    4.2
+ *  @author     Francois Best
+ *  @date       24/02/11
+ *  @license    GPL v3.0 - Copyright Forty Seven Effects 2014
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "midi_Defs.h"
+#include <stddef.h>
+
+BEGIN_MIDI_NAMESPACE
+
+/*! Implements the begin, read, write and available methods that
+ MidiInterface needs, on top of a byte array: every byte of the array is
+ "received" right away, and whatever is sent is dropped.
+ As it does not touch any hardware, the parser can be timed without being
+ limited by the MIDI baudrate, on the board or on a host computer.
+ */
+class MemorySerial
+{
+public:
+    inline MemorySerial(const byte* inData, unsigned inSize)
+        : mData(inData)
+        , mSize(inSize)
+        , mPosition(0)
+    {
+    }
+
+public:
+    inline void begin(long)
+    {
+    }
+
+    inline int available() const
+    {
+        return mSize - mPosition;
+    }
+
+    inline int read()
+    {
+        return mPosition < mSize ? mData[mPosition++] : -1;
+    }
+
+    inline size_t write(byte)
+    {
+        return 1;
+    }
+
+    /// Receive the whole buffer again.
+    inline void rewind()
+    {
+        mPosition = 0;
+    }
+
+private:
+    const byte* mData;
+    unsigned mSize;
+    unsigned mPosition;
+};
+
+END_MIDI_NAMESPACE
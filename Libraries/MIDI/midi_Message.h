@@ -28,53 +28,195 @@
 
 BEGIN_MIDI_NAMESPACE
 
-/*! The Message structure contains decoded data of a MIDI message
-    read from the serial port with read()
+/*! \brief Compact representation of a message, without any SysEx payload.
+
+ It fits in 32 bits, so it can be copied around and queued cheaply.
+ System Exclusive payloads are stored apart, see SysExStorage.
+ @see MessageQueue
  */
-template<unsigned SysExMaxSize>
-struct Message
+struct PackedMessage
 {
-    /*! The maximum size for the System Exclusive array.
-    */
-    static const unsigned sSysExMaxSize = SysExMaxSize;
-
-    /*! The MIDI channel on which the message was recieved.
-     \n Value goes from 1 to 16.
+    /*! Set on the first message queued after some messages were dropped
+     because the queue was full.
      */
-    Channel channel;
+    static const byte Overflow = 0x01;
 
-    /*! The type of the message
-     (see the MidiType enum for types reference)
+    /*! Set on messages that were fully received and respect the MIDI norm.
      */
-    MidiType type;
+    static const byte Valid = 0x02;
 
-    /*! The first data byte.
-     \n Value goes from 0 to 127.
+    /*! The status byte, including the channel for Channel messages.
      */
+    StatusByte status;
     DataByte data1;
-
-    /*! The second data byte.
-     If the message is only 2 bytes long, this one is null.
-     \n Value goes from 0 to 127.
-     */
     DataByte data2;
+    byte flags;
 
-    /*! System Exclusive dedicated byte array.
-     \n Array length is stocked on 16 bits,
-     in data1 (LSB) and data2 (MSB)
-     */
-    DataByte sysexArray[sSysExMaxSize];
+    inline MidiType getType() const
+    {
+        return status < 0xf0 ? MidiType(status & 0xf0) : MidiType(status);
+    }
 
-    /*! This boolean indicates if the message is valid or not.
-     There is no channel consideration here,
-     validity means the message respects the MIDI norm.
+    /*! \return The channel, from 1 to 16, or 0 for System messages.
      */
-    bool valid;
+    inline Channel getChannel() const
+    {
+        return (status >= 0x80 && status < 0xf0) ? (status & 0x0f) + 1 : 0;
+    }
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Flags of the status information words, see getStatusInfo.
+ */
+enum StatusInfoFlags
+{
+    StatusTypeMask      = 0x00ff,   ///< MidiType, InvalidType for data bytes and undefined status.
+    StatusLengthMask    = 0x0300,   ///< Length, status included, 0 for SysEx and undefined status.
+    StatusChannel       = 0x0400,   ///< Channel message, running status applies.
+    StatusRealTime      = 0x0800,   ///< Real Time, can be interleaved in other messages.
+};
+
+static const byte StatusLengthShift = 8;
+
+/// Status information words of 0x80 to 0xff, in flash, see getStatusInfo.
+extern const uint16_t gStatusInfo[128] PROGMEM;
+
+/*! \brief Classify a status byte in a single lookup.
+ \return Its type, message length and flags, see StatusInfoFlags.
+ Data bytes get 0.
+ */
+inline uint16_t getStatusInfo(byte inStatus)
+{
+    return inStatus < 0x80 ? 0 : pgm_read_word(&gStatusInfo[inStatus & 0x7f]);
+}
+
+/*! \brief Get the type of a message from its status byte.
+ \return InvalidType for data bytes and undefined status.
+ */
+inline MidiType getStatusType(byte inStatus)
+{
+    return MidiType(getStatusInfo(inStatus) & StatusTypeMask);
+}
+
+/*! \brief Get the length of a message from its status byte, status included.
+
+ \return 1 to 3 for fixed length messages, 0 for System Exclusive (whose
+ length is only known when EOX is received), data bytes and undefined status.
+ */
+inline byte getMessageLength(byte inStatus)
+{
+    return (getStatusInfo(inStatus) & StatusLengthMask) >> StatusLengthShift;
+}
+
+/*! \brief Get the bit of a message type in 32-bit type masks, from its status
+ byte: bits 0 to 6 for Channel messages, 8 to 23 for System messages.
+ */
+inline uint32_t getTypeMaskBit(byte inStatus)
+{
+    return uint32_t(1) << (inStatus < 0xf0 ? (inStatus >> 4) & 0x07 : (inStatus & 0x0f) + 8);
+}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Storage for received System Exclusive messages.
+
+ Each MidiInterface has one, of Settings::SysExMaxSize bytes, unless
+ another buffer is supplied with MidiInterface::setSysExBuffer.
+ With a size of 0, it takes no RAM and SysEx messages are ignored.
+ */
+template<unsigned Size>
+struct SysExStorage
+{
+    static const unsigned sSize = Size;
+
+    inline DataByte* getArray()
+    {
+        return mArray;
+    }
+
+private:
+    DataByte mArray[Size];
+};
+
+template<>
+struct SysExStorage<0>
+{
+    static const unsigned sSize = 0;
+
+    inline DataByte* getArray()
+    {
+        return 0;
+    }
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Arrival times of received messages, see
+ DefaultSettings::UseReceiveTimestamps.
+
+ The serial port gives the arrival time of each byte it returns, and the
+ time of the first byte of a message is kept until the message is complete.
+ Without timestamps, it takes no RAM and all times are 0.
+ */
+template<bool Enabled>
+struct ReceiveTimestamps
+{
+    inline ReceiveTimestamps()
+        : mByte(0)
+        , mPending(0)
+        , mMessage(0)
+    {
+    }
+
+    /// Get the time of the byte that was just read from inSerial.
+    template<class SerialPort>
+    inline void readByte(SerialPort& inSerial)
+    {
+        mByte = inSerial.getTimestamp();
+    }
+
+    /// That byte starts a new message.
+    inline void startMessage()
+    {
+        mPending = mByte;
+    }
+
+    /// That byte completes the message it started.
+    inline void completeMessage()
+    {
+        mMessage = mPending;
+    }
+
+    /// That byte is a Real Time message, interleaved in another one.
+    inline void completeRealTime()
+    {
+        mMessage = mByte;
+    }
+
+    inline unsigned long getMessageTime() const
+    {
+        return mMessage;
+    }
+
+private:
+    unsigned long mByte;
+    unsigned long mPending;
+    unsigned long mMessage;
+};
+
+template<>
+struct ReceiveTimestamps<false>
+{
+    template<class SerialPort>
+    inline void readByte(SerialPort&)   { }
+    inline void startMessage()          { }
+    inline void completeMessage()       { }
+    inline void completeRealTime()      { }
 
-    inline unsigned getSysExSize() const
+    inline unsigned long getMessageTime() const
     {
-        const unsigned size = unsigned(data2) << 8 | data1;
-        return size > sSysExMaxSize ? sSysExMaxSize : size;
+        return 0;
     }
 };
 
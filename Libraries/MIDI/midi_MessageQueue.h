@@ -0,0 +1,204 @@
+/*!
+ *  @file       midi_MessageQueue.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Input message queue
+ *  @version    4.2
+ *  @author     Francois Best
+ *  @date       24/02/11
+ *  @license    GPL v3.0 - Copyright Forty Seven Effects 2014
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "midi_Defs.h"
+#include "midi_Message.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Ring buffer of PackedMessages, to decouple parsing from handling.
+
+ Messages are pushed by a single producer (a parse pass with
+ MidiInterface::readAll, or an interrupt routine) and popped by a single
+ consumer (usually loop()), without ever disabling interrupts: each index is
+ only written by one side, and fits in a byte so it is read atomically.
+
+ When the queue is full, new messages are dropped and counted, and the next
+ message that makes it in the queue gets the PackedMessage::Overflow flag.
+
+ Size must be a power of two, up to 128.
+ */
+template<byte Size>
+class MessageQueue
+{
+public:
+    inline MessageQueue();
+
+public:
+    // Producer side
+    inline bool push(const PackedMessage& inMessage);
+
+public:
+    // Consumer side
+    inline bool pop(PackedMessage& outMessage);
+    inline byte pop(PackedMessage* outMessages, byte inMaxCount);
+    inline void clear();
+
+public:
+    inline byte getCount() const;
+    inline bool isEmpty() const;
+    inline unsigned getDropCount() const;
+    inline byte getHighWaterMark() const;
+
+private:
+    typedef char SizeMustBeAPowerOfTwoUpTo128[((Size & (Size - 1)) == 0 && Size <= 128) ? 1 : -1];
+    static const byte sMask = Size - 1;
+
+private:
+    volatile PackedMessage mBuffer[Size];
+    volatile byte mHead;            ///< Next slot to write, producer only.
+    volatile byte mTail;            ///< Next slot to read, consumer only.
+    volatile unsigned mDropCount;   ///< Producer only.
+    volatile byte mHighWaterMark;   ///< Producer only.
+    bool mDropped;                  ///< Producer only.
+};
+
+// -----------------------------------------------------------------------------
+
+template<byte Size>
+inline MessageQueue<Size>::MessageQueue()
+    : mHead(0)
+    , mTail(0)
+    , mDropCount(0)
+    , mHighWaterMark(0)
+    , mDropped(false)
+{
+}
+
+/*! \brief Add a message at the end of the queue.
+ \return False if the queue was full and the message was dropped.
+ */
+template<byte Size>
+inline bool MessageQueue<Size>::push(const PackedMessage& inMessage)
+{
+    const byte head  = mHead;
+    const byte count = head - mTail;
+
+    if (count >= Size)
+    {
+        mDropCount = mDropCount + 1;
+        mDropped = true;
+        return false;
+    }
+
+    volatile PackedMessage& slot = mBuffer[head & sMask];
+    slot.status = inMessage.status;
+    slot.data1  = inMessage.data1;
+    slot.data2  = inMessage.data2;
+    slot.flags  = mDropped ? inMessage.flags | PackedMessage::Overflow : inMessage.flags;
+    mDropped = false;
+
+    if (count + 1 > mHighWaterMark)
+        mHighWaterMark = count + 1;
+
+    // Publish the message only once it is fully written.
+    mHead = head + 1;
+    return true;
+}
+
+/*! \brief Take the oldest message out of the queue.
+ \return False if the queue was empty.
+ */
+template<byte Size>
+inline bool MessageQueue<Size>::pop(PackedMessage& outMessage)
+{
+    return pop(&outMessage, 1) != 0;
+}
+
+/*! \brief Take up to inMaxCount messages out of the queue, oldest first.
+ \return The number of messages copied to outMessages.
+ */
+template<byte Size>
+inline byte MessageQueue<Size>::pop(PackedMessage* outMessages, byte inMaxCount)
+{
+    byte tail = mTail;
+    byte count = mHead - tail;
+    if (count > inMaxCount)
+        count = inMaxCount;
+
+    for (byte i = 0; i < count; ++i, ++tail)
+    {
+        const volatile PackedMessage& slot = mBuffer[tail & sMask];
+        outMessages[i].status = slot.status;
+        outMessages[i].data1  = slot.data1;
+        outMessages[i].data2  = slot.data2;
+        outMessages[i].flags  = slot.flags;
+    }
+
+    // Release the slots only once they have been read.
+    mTail = tail;
+    return count;
+}
+
+/*! \brief Drop all the queued messages. Consumer side only.
+ */
+template<byte Size>
+inline void MessageQueue<Size>::clear()
+{
+    mTail = mHead;
+}
+
+// -----------------------------------------------------------------------------
+
+template<byte Size>
+inline byte MessageQueue<Size>::getCount() const
+{
+    return byte(mHead - mTail);
+}
+
+template<byte Size>
+inline bool MessageQueue<Size>::isEmpty() const
+{
+    return mHead == mTail;
+}
+
+/*! \brief Get the number of messages dropped because the queue was full.
+
+ The counter is 16 bits wide, it is read until two reads agree so that an
+ interrupt updating it in the middle of the read can't tear it.
+ */
+template<byte Size>
+inline unsigned MessageQueue<Size>::getDropCount() const
+{
+    unsigned count;
+    do
+    {
+        count = mDropCount;
+    }
+    while (count != mDropCount);
+    return count;
+}
+
+/*! \brief Get the highest number of messages the queue held at once.
+
+ Use it to tune Size: if it reaches Size, messages were probably dropped.
+ */
+template<byte Size>
+inline byte MessageQueue<Size>::getHighWaterMark() const
+{
+    return mHighWaterMark;
+}
+
+END_MIDI_NAMESPACE
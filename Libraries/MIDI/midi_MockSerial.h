@@ -0,0 +1,157 @@
+/*!
+ *  @file       midi_MockSerial.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Serial port for replay and fuzz tests
+ *  @version    4.2
+ *  @author     Francois Best
+ *  @date       24/02/11
+ *  @license    GPL v3.0 - Copyright Forty Seven Effects 2014
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "midi_Defs.h"
+#include <stddef.h>
+
+BEGIN_MIDI_NAMESPACE
+
+/*! A serial port stand-in for tests, on the board or on a host computer:
+ MidiInterface<MockSerial> parses a recorded or generated byte stream, and
+ what it sends is captured.
+
+ Unlike MemorySerial, the input can arrive in bursts: available() reports
+ the bytes of the current burst only, then 0 once the burst is read, as if
+ the next bytes were still on the cable. This exercises the parser across
+ read() calls, with any burst size (see setBurstSize).
+ */
+class MockSerial
+{
+public:
+    inline MockSerial()
+        : mInput(0)
+        , mInputSize(0)
+        , mPosition(0)
+        , mBurstSize(0)
+        , mBurstLeft(0)
+        , mOutput(0)
+        , mOutputSize(0)
+        , mOutputLength(0)
+    {
+    }
+
+public:
+    inline void begin(long)
+    {
+    }
+
+    inline int available()
+    {
+        if (mBurstLeft == 0)
+        {
+            // Gap between two bursts, the next one arrives on the next call.
+            const unsigned left = mInputSize - mPosition;
+            mBurstLeft = (mBurstSize == 0 || mBurstSize > left) ? left : mBurstSize;
+            return 0;
+        }
+        return mBurstLeft;
+    }
+
+    inline int read()
+    {
+        if (mBurstLeft == 0)
+            return -1;
+
+        mBurstLeft--;
+        return mInput[mPosition++];
+    }
+
+    inline size_t write(byte inByte)
+    {
+        if (mOutputLength < mOutputSize)
+            mOutput[mOutputLength] = inByte;
+        mOutputLength++;
+        return 1;
+    }
+
+public:
+    /*! \brief Receive a new stream, from its first byte.
+     \param inBurstSize Bytes received at a time, 0 for the whole stream.
+     */
+    inline void setInput(const byte* inData, unsigned inSize, unsigned inBurstSize = 0)
+    {
+        mInput = inData;
+        mInputSize = inSize;
+        mPosition = 0;
+        mBurstLeft = 0;
+        mBurstSize = inBurstSize;
+    }
+
+    /*! \brief Change the size of the next bursts, 0 for the rest of the stream.
+     The current burst is not affected.
+     */
+    inline void setBurstSize(unsigned inBurstSize)
+    {
+        mBurstSize = inBurstSize;
+    }
+
+    /// Bytes of the stream read so far.
+    inline unsigned getPosition() const
+    {
+        return mPosition;
+    }
+
+    /*! \brief The position in the stream of the byte returned by the last
+     read(), standing for its arrival time (see
+     DefaultSettings::UseReceiveTimestamps).
+     */
+    inline unsigned long getTimestamp() const
+    {
+        return mPosition - 1;
+    }
+
+    inline bool isFinished() const
+    {
+        return mPosition == mInputSize;
+    }
+
+    /*! \brief Capture the bytes written from now on.
+     Bytes past inSize are counted but not stored.
+     */
+    inline void setOutput(byte* outData, unsigned inSize)
+    {
+        mOutput = outData;
+        mOutputSize = inSize;
+        mOutputLength = 0;
+    }
+
+    /// Bytes written since setOutput.
+    inline unsigned getOutputLength() const
+    {
+        return mOutputLength;
+    }
+
+private:
+    const byte* mInput;
+    unsigned mInputSize;
+    unsigned mPosition;
+    unsigned mBurstSize;
+    unsigned mBurstLeft;
+    byte* mOutput;
+    unsigned mOutputSize;
+    unsigned mOutputLength;
+};
+
+END_MIDI_NAMESPACE
@@ -0,0 +1,332 @@
+/*!
+ *  @file       midi_NoteList.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Held note list for monophonic synths
+ *  @version    4.2
+ *  @author     Francois Best
+ *  @date       24/02/11
+ *  @license    GPL v3.0 - Copyright Forty Seven Effects 2014
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "midi_Defs.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief The notes held on a keyboard, for the Low, High and Last playing
+ modes of a monophonic synth.
+
+ A 128 bit map tells which notes are held, and a 16 bit mask which bytes of
+ the map hold notes, so that the lowest and highest notes are found with a
+ find-first-set on the mask, then on a byte. The order notes were played in
+ is kept in a stack of Size pitches, the last one on top, for the Last mode.
+
+ Released notes are only dropped from the stack when they reach its top, so
+ that add and remove don't move the other notes. When the stack is full, it
+ is compacted, and if Size notes are held, the oldest one is released to
+ make room for the new one.
+
+ A note is either held or not: a NoteOn for a held note plays it again (it
+ becomes the last), a single NoteOff releases it.
+ */
+template<byte Size = 16>
+class NoteList
+{
+public:
+    inline NoteList();
+
+public:
+    inline void add(DataByte inPitch);
+    inline void remove(DataByte inPitch);
+    inline void clear();
+
+public:
+    inline bool get(byte inIndex, DataByte& outPitch) const;
+    inline bool getLast(DataByte& outPitch) const;
+    inline bool getHigh(DataByte& outPitch) const;
+    inline bool getLow(DataByte& outPitch) const;
+
+public:
+    inline bool isHeld(DataByte inPitch) const;
+    inline bool empty() const;
+    inline byte size() const;
+
+private:
+    typedef char SizeMustBeBetween1And128[(Size > 0 && Size <= 128) ? 1 : -1];
+
+private:
+    inline void compact();
+    static inline byte getLowestBit(unsigned inBits);
+    static inline byte getHighestBit(unsigned inBits);
+
+private:
+    byte mBits[16];         ///< Bit (pitch & 7) of byte (pitch >> 3) set when held.
+    uint16_t mBytes;        ///< Bit i set when mBits[i] holds notes.
+    DataByte mOrder[Size];  ///< Pitches in the order they were played, last on top.
+    byte mTop;
+    byte mSize;
+};
+
+// -----------------------------------------------------------------------------
+
+template<byte Size>
+inline NoteList<Size>::NoteList()
+{
+    clear();
+}
+
+/*! \brief Hold a note, as the last one played.
+ Call this when receiving a NoteOn event.
+ */
+template<byte Size>
+inline void NoteList<Size>::add(DataByte inPitch)
+{
+    if (inPitch > 127)
+        return;
+
+    if (mTop == Size)
+    {
+        compact();
+        if (mTop == Size)
+        {
+            // Size notes are held: take the note out of the stack if it is
+            // one of them, or else drop the oldest one.
+            byte index = mTop - 1;
+            while (index > 0 && mOrder[index] != inPitch)
+            {
+                index--;
+            }
+
+            const DataByte dropped = mOrder[index];
+            for (byte i = index + 1; i < mTop; ++i)
+            {
+                mOrder[i - 1] = mOrder[i];
+            }
+            mTop--;
+
+            if (dropped != inPitch)
+            {
+                remove(dropped);
+            }
+        }
+    }
+
+    if (!isHeld(inPitch))
+    {
+        mBits[inPitch >> 3] |= 1 << (inPitch & 7);
+        mBytes |= 1U << (inPitch >> 3);
+        mSize++;
+    }
+    mOrder[mTop++] = inPitch;
+}
+
+/*! \brief Release a note.
+ Call this when receiving a NoteOff event.
+ */
+template<byte Size>
+inline void NoteList<Size>::remove(DataByte inPitch)
+{
+    if (!isHeld(inPitch))
+        return;
+
+    byte& bits = mBits[inPitch >> 3];
+    bits &= ~(1 << (inPitch & 7));
+    if (bits == 0)
+    {
+        mBytes &= ~(1U << (inPitch >> 3));
+    }
+    mSize--;
+
+    // Keep a held note on top of the stack, for getLast.
+    while (mTop > 0 && !isHeld(mOrder[mTop - 1]))
+    {
+        mTop--;
+    }
+}
+
+/*! \brief Release all notes.
+ */
+template<byte Size>
+inline void NoteList<Size>::clear()
+{
+    for (byte i = 0; i < 16; ++i)
+    {
+        mBits[i] = 0;
+    }
+    mBytes = 0;
+    mTop = 0;
+    mSize = 0;
+}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Get a note by the order it was played in, 0 being the last.
+ This can be interesting for duo/multi/polyphony operations. Unlike the other
+ getters, it walks through the stack.
+ */
+template<byte Size>
+inline bool NoteList<Size>::get(byte inIndex, DataByte& outPitch) const
+{
+    byte index = 0;
+    for (byte i = mTop; i-- > 0; )
+    {
+        const DataByte pitch = mOrder[i];
+        if (!isHeld(pitch))
+            continue;
+
+        // Only the last time a note was played counts (a single note can't
+        // have been played again).
+        bool playedAgain = false;
+        for (byte j = i + 1; Size > 1 && j < mTop && !playedAgain; ++j)
+        {
+            playedAgain = mOrder[j] == pitch;
+        }
+
+        if (!playedAgain && index++ == inIndex)
+        {
+            outPitch = pitch;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*! \brief Get the last active note played
+ This implements the Mono Last playing mode.
+ */
+template<byte Size>
+inline bool NoteList<Size>::getLast(DataByte& outPitch) const
+{
+    if (mTop == 0)
+        return false;
+
+    outPitch = mOrder[mTop - 1];
+    return true;
+}
+
+/*! \brief Get the highest pitched active note
+ This implements the Mono High playing mode.
+ */
+template<byte Size>
+inline bool NoteList<Size>::getHigh(DataByte& outPitch) const
+{
+    if (mBytes == 0)
+        return false;
+
+    const byte index = getHighestBit(mBytes);
+    outPitch = (index << 3) | getHighestBit(mBits[index]);
+    return true;
+}
+
+/*! \brief Get the lowest pitched active note
+ This implements the Mono Low playing mode.
+ */
+template<byte Size>
+inline bool NoteList<Size>::getLow(DataByte& outPitch) const
+{
+    if (mBytes == 0)
+        return false;
+
+    const byte index = getLowestBit(mBytes);
+    outPitch = (index << 3) | getLowestBit(mBits[index]);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+
+template<byte Size>
+inline bool NoteList<Size>::isHeld(DataByte inPitch) const
+{
+    return inPitch < 128 && (mBits[inPitch >> 3] & (1 << (inPitch & 7)));
+}
+
+template<byte Size>
+inline bool NoteList<Size>::empty() const
+{
+    return mSize == 0;
+}
+
+/*! \brief Get the number of active notes.
+ */
+template<byte Size>
+inline byte NoteList<Size>::size() const
+{
+    return mSize;
+}
+
+// -----------------------------------------------------------------------------
+// Private implementations, for internal use only.
+
+// Drop released notes from the stack, and the older entries of notes played
+// more than once, keeping the order of the others.
+template<byte Size>
+inline void NoteList<Size>::compact()
+{
+    byte seen[16] = { 0 };
+    byte bottom = mTop;
+
+    for (byte i = mTop; i-- > 0; )
+    {
+        const DataByte pitch = mOrder[i];
+        const byte mask = 1 << (pitch & 7);
+        if (isHeld(pitch) && !(seen[pitch >> 3] & mask))
+        {
+            seen[pitch >> 3] |= mask;
+            mOrder[--bottom] = pitch;
+        }
+    }
+
+    mTop -= bottom;
+    for (byte i = 0; i < mTop; ++i)
+    {
+        mOrder[i] = mOrder[bottom + i];
+    }
+}
+
+template<byte Size>
+inline byte NoteList<Size>::getLowestBit(unsigned inBits)
+{
+#if defined(__GNUC__)
+    return __builtin_ctz(inBits);
+#else
+    byte bit = 0;
+    while (!(inBits & 1))
+    {
+        inBits >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+template<byte Size>
+inline byte NoteList<Size>::getHighestBit(unsigned inBits)
+{
+#if defined(__GNUC__)
+    return 8 * sizeof(unsigned) - 1 - __builtin_clz(inBits);
+#else
+    byte bit = 0;
+    while (inBits >>= 1)
+    {
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+END_MIDI_NAMESPACE
@@ -0,0 +1,164 @@
+/*!
+ *  @file       midi_RingBuffer.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Byte ring buffer
+ *  @version    4.2
+ *  @author     Francois Best
+ *  @date       24/02/11
+ *  @license    GPL v3.0 - Copyright Forty Seven Effects 2014
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "midi_Defs.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Ring buffer of raw bytes, used to queue the MIDI output.
+
+ Like MessageQueue, it is safe to use with a single producer and a single
+ consumer (one of them possibly being an interrupt routine) without
+ disabling interrupts.
+
+ Size must be a power of two, up to 128. With a size of 0, it takes no RAM
+ and can't hold anything, so that MidiInterface can write straight to the
+ serial port.
+ */
+template<byte Size>
+class RingBuffer
+{
+public:
+    static const byte sSize = Size;
+
+public:
+    inline RingBuffer();
+
+public:
+    // Producer side
+    inline bool push(byte inByte);
+
+public:
+    // Consumer side
+    inline byte pop();
+    inline byte peek() const;
+    inline void clear();
+
+public:
+    inline byte getCount() const;
+    inline bool isEmpty() const;
+    inline bool isFull() const;
+
+private:
+    typedef char SizeMustBeAPowerOfTwoUpTo128[((Size & (Size - 1)) == 0 && Size <= 128) ? 1 : -1];
+    static const byte sMask = Size - 1;
+
+private:
+    volatile byte mBuffer[Size];
+    volatile byte mHead;            ///< Next slot to write, producer only.
+    volatile byte mTail;            ///< Next slot to read, consumer only.
+};
+
+template<>
+class RingBuffer<0>
+{
+public:
+    static const byte sSize = 0;
+
+public:
+    inline bool push(byte)      { return false; }
+    inline byte pop()           { return 0; }
+    inline byte peek() const    { return 0; }
+    inline void clear()         { }
+
+public:
+    inline byte getCount() const    { return 0; }
+    inline bool isEmpty() const     { return true; }
+    inline bool isFull() const      { return true; }
+};
+
+// -----------------------------------------------------------------------------
+
+template<byte Size>
+inline RingBuffer<Size>::RingBuffer()
+    : mHead(0)
+    , mTail(0)
+{
+}
+
+/*! \brief Add a byte at the end of the buffer.
+ \return False if the buffer was full and the byte was not added.
+ */
+template<byte Size>
+inline bool RingBuffer<Size>::push(byte inByte)
+{
+    const byte head = mHead;
+    if (byte(head - mTail) >= Size)
+        return false;
+
+    mBuffer[head & sMask] = inByte;
+    mHead = head + 1;
+    return true;
+}
+
+/*! \brief Take the oldest byte out of the buffer.
+ Check that the buffer is not empty first, or you'll get garbage.
+ */
+template<byte Size>
+inline byte RingBuffer<Size>::pop()
+{
+    const byte tail = mTail;
+    const byte value = mBuffer[tail & sMask];
+    mTail = tail + 1;
+    return value;
+}
+
+/*! \brief Get the oldest byte without taking it out of the buffer.
+ */
+template<byte Size>
+inline byte RingBuffer<Size>::peek() const
+{
+    return mBuffer[mTail & sMask];
+}
+
+/*! \brief Drop all the buffered bytes. Consumer side only.
+ */
+template<byte Size>
+inline void RingBuffer<Size>::clear()
+{
+    mTail = mHead;
+}
+
+// -----------------------------------------------------------------------------
+
+template<byte Size>
+inline byte RingBuffer<Size>::getCount() const
+{
+    return byte(mHead - mTail);
+}
+
+template<byte Size>
+inline bool RingBuffer<Size>::isEmpty() const
+{
+    return mHead == mTail;
+}
+
+template<byte Size>
+inline bool RingBuffer<Size>::isFull() const
+{
+    return byte(mHead - mTail) >= Size;
+}
+
+END_MIDI_NAMESPACE
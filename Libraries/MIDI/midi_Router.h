@@ -0,0 +1,509 @@
+/*!
+ *  @file       midi_Router.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Multi-port router and merger
+ *  @version    4.2
+ *  @author     Francois Best
+ *  @date       24/02/11
+ *  @license    GPL v3.0 - Copyright Forty Seven Effects 2014
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "midi_Defs.h"
+#include "midi_Message.h"
+#include "midi_RingBuffer.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Routes and merges the MIDI streams of several ports.
+
+ Each of the PortCount inputs can be routed to any of the PortCount outputs,
+ and each route has its own channel and type filters. The bytes are routed as
+ they are received, without being parsed into messages and sent again, so
+ every type of message goes through: SysEx of any length, Real Time and System
+ Common messages included.
+
+ When several inputs are merged into an output, messages are never mixed:
+ a message is only queued once it is complete, and a SysEx takes hold of its
+ outputs until it ends, the other inputs waiting meanwhile. The one exception
+ is Real Time messages, which have their own queue in each output, and are
+ sent before anything else, as the MIDI spec allows them anywhere. A waiting
+ input still reads its port, so that its Real Time messages go through, as
+ long as it only has to put aside one byte of another message. They are
+ dropped if 8 of them are already waiting, which breaks the sync of devices
+ following a Clock: write the outputs often enough, and check
+ getRealTimeDropCount. Each output keeps its own running status.
+
+ The router doesn't own the serial ports, call read and write from loop() for
+ each port, whatever its type. PortCount can go up to 8, QueueSize is the size
+ of each output queue (a power of two, up to 128).
+ */
+template<byte PortCount, byte QueueSize = 64>
+class Router
+{
+public:
+    inline Router();
+
+public:
+    inline void connect(byte inInput, byte inOutput);
+    inline void disconnect(byte inInput, byte inOutput);
+    inline bool isConnected(byte inInput, byte inOutput) const;
+    inline void setRouteChannelMask(byte inInput, byte inOutput, uint16_t inMask);
+    inline void setRouteTypeFilter(byte inInput, byte inOutput, MidiType inType, bool inForward);
+
+public:
+    template<class SerialPort> inline void read(byte inInput, SerialPort& inPort);
+    template<class SerialPort> byte write(byte inOutput, SerialPort& inPort, byte inMaxBytes);
+
+public:
+    bool isReady(byte inInput);
+    void receive(byte inInput, byte inByte);
+    inline byte getPendingCount(byte inOutput) const;
+    inline unsigned getRealTimeDropCount(byte inOutput) const;
+
+private:
+    typedef char PortCountMustBeUpTo8[(PortCount > 0 && PortCount <= 8) ? 1 : -1];
+
+    struct Route
+    {
+        uint16_t mChannels;
+        uint32_t mTypes;
+    };
+
+    struct Input
+    {
+        byte mMessage[3];           ///< Message being received, or waiting to be queued.
+        byte mLength;               ///< Number of bytes in mMessage.
+        byte mExpectedLength;       ///< 0 when waiting for a status byte.
+        StatusByte mRunningStatus;
+        bool mInSysEx;
+        byte mSysExOutputs;         ///< Outputs the current SysEx goes to.
+        byte mPendingOutputs;       ///< Outputs mMessage still has to be queued to.
+        byte mLookahead;            ///< Byte read while waiting for the outputs.
+        bool mHasLookahead;
+    };
+
+    struct Output
+    {
+        RingBuffer<QueueSize> mQueue;
+        RingBuffer<8> mRealTime;
+        unsigned mRealTimeDropCount;
+        StatusByte mRunningStatus;
+        byte mOwner;                ///< Input sending a SysEx, or sNoOwner.
+    };
+
+    static const byte sNoOwner = 0xff;
+
+private:
+    inline byte getOutputs(byte inInput, StatusByte inStatus, byte inChannel) const;
+    inline bool canQueue(byte inInput, byte inOutput) const;
+    void queue(byte inInput);
+    void endSysEx(byte inInput);
+
+private:
+    Route  mRoutes[PortCount][PortCount];
+    byte   mConnections[PortCount];     ///< Outputs of each input, one bit each.
+    Input  mInputs[PortCount];
+    Output mOutputs[PortCount];
+};
+
+// -----------------------------------------------------------------------------
+
+template<byte PortCount, byte QueueSize>
+inline Router<PortCount, QueueSize>::Router()
+{
+    for (byte i = 0; i < PortCount; ++i)
+    {
+        mConnections[i] = 0;
+        for (byte o = 0; o < PortCount; ++o)
+        {
+            mRoutes[i][o].mChannels = 0xffff;
+            mRoutes[i][o].mTypes    = 0xffffffff;
+        }
+
+        Input& input = mInputs[i];
+        input.mLength           = 0;
+        input.mExpectedLength   = 0;
+        input.mRunningStatus    = 0;
+        input.mInSysEx          = false;
+        input.mSysExOutputs     = 0;
+        input.mPendingOutputs   = 0;
+        input.mHasLookahead     = false;
+
+        mOutputs[i].mRealTimeDropCount  = 0;
+        mOutputs[i].mRunningStatus      = 0;
+        mOutputs[i].mOwner              = sNoOwner;
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Send what is received on an input to an output.
+ All the messages go through, until filters are set with setRouteChannelMask
+ and setRouteTypeFilter.
+ */
+template<byte PortCount, byte QueueSize>
+inline void Router<PortCount, QueueSize>::connect(byte inInput, byte inOutput)
+{
+    mConnections[inInput] |= 1 << inOutput;
+}
+
+template<byte PortCount, byte QueueSize>
+inline void Router<PortCount, QueueSize>::disconnect(byte inInput, byte inOutput)
+{
+    mConnections[inInput] &= ~(1 << inOutput);
+}
+
+template<byte PortCount, byte QueueSize>
+inline bool Router<PortCount, QueueSize>::isConnected(byte inInput, byte inOutput) const
+{
+    return mConnections[inInput] & (1 << inOutput);
+}
+
+/*! \brief Select the channels going through a route.
+ \param inMask Bit 0 for channel 1 to bit 15 for channel 16.
+ */
+template<byte PortCount, byte QueueSize>
+inline void Router<PortCount, QueueSize>::setRouteChannelMask(byte inInput,
+                                                              byte inOutput,
+                                                              uint16_t inMask)
+{
+    mRoutes[inInput][inOutput].mChannels = inMask;
+}
+
+/*! \brief Select whether a type of message goes through a route.
+ */
+template<byte PortCount, byte QueueSize>
+inline void Router<PortCount, QueueSize>::setRouteTypeFilter(byte inInput,
+                                                             byte inOutput,
+                                                             MidiType inType,
+                                                             bool inForward)
+{
+    if (inForward)
+        mRoutes[inInput][inOutput].mTypes |= getTypeMaskBit(inType);
+    else
+        mRoutes[inInput][inOutput].mTypes &= ~getTypeMaskBit(inType);
+}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Route the bytes received by a serial port.
+
+ While the input waits for its outputs (because their queue is full, or
+ another input is sending a SysEx to them), Real Time bytes are still routed
+ as they come, and the first other byte is put aside until the input is
+ ready again. Bytes after it are left in the serial port.
+ */
+template<byte PortCount, byte QueueSize>
+template<class SerialPort>
+inline void Router<PortCount, QueueSize>::read(byte inInput, SerialPort& inPort)
+{
+    Input& input = mInputs[inInput];
+
+    while (true)
+    {
+        const bool ready = isReady(inInput);
+        if (ready && input.mHasLookahead)
+        {
+            input.mHasLookahead = false;
+            receive(inInput, input.mLookahead);
+        }
+        else if ((ready || !input.mHasLookahead) && inPort.available())
+        {
+            const byte value = inPort.read();
+            if (ready || value >= 0xf8)
+            {
+                receive(inInput, value);
+            }
+            else
+            {
+                input.mLookahead    = value;
+                input.mHasLookahead = true;
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+}
+
+/*! \brief Write the queued bytes of an output to a serial port.
+ \param inMaxBytes The maximum number of bytes to write, to bound the time spent
+ waiting for ports like SoftwareSerial.
+ \return The number of bytes still queued.
+ */
+template<byte PortCount, byte QueueSize>
+template<class SerialPort>
+byte Router<PortCount, QueueSize>::write(byte inOutput, SerialPort& inPort, byte inMaxBytes)
+{
+    Output& output = mOutputs[inOutput];
+
+    for (byte i = 0; i < inMaxBytes; ++i)
+    {
+        if (!output.mRealTime.isEmpty())
+        {
+            inPort.write(output.mRealTime.pop());
+        }
+        else if (!output.mQueue.isEmpty())
+        {
+            inPort.write(output.mQueue.pop());
+        }
+        else
+        {
+            break;
+        }
+    }
+    return getPendingCount(inOutput);
+}
+
+/*! \brief Check whether an input can take a new byte.
+
+ It can't while the last message it received could not be queued to all of
+ its outputs yet. This tries to queue it again.
+ */
+template<byte PortCount, byte QueueSize>
+bool Router<PortCount, QueueSize>::isReady(byte inInput)
+{
+    if (mInputs[inInput].mPendingOutputs != 0)
+    {
+        queue(inInput);
+    }
+    return mInputs[inInput].mPendingOutputs == 0;
+}
+
+/*! \brief Route a byte received on an input.
+
+ Use it to route bytes coming from something else than a serial port, after
+ checking isReady (Real Time bytes can be routed anytime).
+ */
+template<byte PortCount, byte QueueSize>
+void Router<PortCount, QueueSize>::receive(byte inInput, byte inByte)
+{
+    Input& input = mInputs[inInput];
+
+    if (inByte >= 0xf8)
+    {
+        if (getMessageLength(inByte) != 1)
+        {
+            return; // Undefined
+        }
+
+        const byte outputs = getOutputs(inInput, inByte, 0);
+        for (byte o = 0; o < PortCount; ++o)
+        {
+            if ((outputs & (1 << o)) && !mOutputs[o].mRealTime.push(inByte))
+            {
+                mOutputs[o].mRealTimeDropCount++;
+            }
+        }
+        return;
+    }
+
+    if (input.mInSysEx)
+    {
+        if (inByte < 0x80 || inByte == 0xf7)
+        {
+            // Forward the SysEx byte by byte, the outputs are held until 0xf7.
+            input.mMessage[0]       = inByte;
+            input.mLength           = 1;
+            input.mPendingOutputs   = input.mSysExOutputs;
+            queue(inInput);
+            return;
+        }
+
+        // Any other status byte ends the SysEx.
+        endSysEx(inInput);
+    }
+
+    if (inByte >= 0x80)
+    {
+        input.mMessage[0]       = inByte;
+        input.mLength           = 1;
+        input.mExpectedLength   = getMessageLength(inByte);
+        input.mRunningStatus    = inByte < 0xf0 ? inByte : 0;
+
+        if (inByte == SystemExclusive)
+        {
+            input.mInSysEx          = true;
+            input.mSysExOutputs     = getOutputs(inInput, inByte, 0);
+            input.mPendingOutputs   = input.mSysExOutputs;
+            queue(inInput);
+        }
+        else if (input.mExpectedLength == 1)
+        {
+            input.mPendingOutputs = getOutputs(inInput, inByte, 0);
+            input.mExpectedLength = 0;
+            queue(inInput);
+        }
+        return;
+    }
+
+    if (input.mExpectedLength == 0)
+    {
+        if (input.mRunningStatus == 0)
+        {
+            return; // Lost data byte
+        }
+        input.mMessage[0]       = input.mRunningStatus;
+        input.mLength           = 1;
+        input.mExpectedLength   = getMessageLength(input.mRunningStatus);
+    }
+
+    input.mMessage[input.mLength++] = inByte;
+
+    if (input.mLength == input.mExpectedLength)
+    {
+        const StatusByte status = input.mMessage[0];
+        input.mPendingOutputs = getOutputs(inInput, status, status < 0xf0 ? status & 0x0f : 0);
+        input.mExpectedLength = 0;
+        queue(inInput);
+    }
+}
+
+template<byte PortCount, byte QueueSize>
+inline byte Router<PortCount, QueueSize>::getPendingCount(byte inOutput) const
+{
+    return mOutputs[inOutput].mRealTime.getCount() + mOutputs[inOutput].mQueue.getCount();
+}
+
+/*! \brief Get the number of Real Time messages dropped by an output, because
+ 8 of them were already waiting to be written.
+ */
+template<byte PortCount, byte QueueSize>
+inline unsigned Router<PortCount, QueueSize>::getRealTimeDropCount(byte inOutput) const
+{
+    return mOutputs[inOutput].mRealTimeDropCount;
+}
+
+// -----------------------------------------------------------------------------
+
+template<byte PortCount, byte QueueSize>
+inline byte Router<PortCount, QueueSize>::getOutputs(byte inInput,
+                                                     StatusByte inStatus,
+                                                     byte inChannel) const
+{
+    const uint32_t typeBit    = getTypeMaskBit(inStatus);
+    const uint16_t channelBit = 1 << inChannel;
+    const byte connections    = mConnections[inInput];
+
+    byte outputs = 0;
+    for (byte o = 0; o < PortCount; ++o)
+    {
+        const Route& route = mRoutes[inInput][o];
+        if ((connections & (1 << o)) &&
+            (route.mTypes & typeBit) &&
+            (inStatus >= 0xf0 || (route.mChannels & channelBit)))
+        {
+            outputs |= 1 << o;
+        }
+    }
+    return outputs;
+}
+
+// An output can take a message when it has room for it, and isn't held by
+// another input sending a SysEx.
+template<byte PortCount, byte QueueSize>
+inline bool Router<PortCount, QueueSize>::canQueue(byte inInput, byte inOutput) const
+{
+    const Output& output = mOutputs[inOutput];
+    return (output.mOwner == sNoOwner || output.mOwner == inInput) &&
+           output.mQueue.getCount() + mInputs[inInput].mLength <= QueueSize;
+}
+
+// Queue the message of an input to the outputs that can take it now.
+template<byte PortCount, byte QueueSize>
+void Router<PortCount, QueueSize>::queue(byte inInput)
+{
+    Input& input = mInputs[inInput];
+    const StatusByte status = input.mMessage[0];
+
+    if (status == SystemExclusive)
+    {
+        // Take hold of all the outputs at once, or of none of them: two inputs
+        // each holding an output the other one waits for would wait forever.
+        for (byte o = 0; o < PortCount; ++o)
+        {
+            if ((input.mPendingOutputs & (1 << o)) && !canQueue(inInput, o))
+            {
+                return;
+            }
+        }
+    }
+
+    for (byte o = 0; o < PortCount; ++o)
+    {
+        const byte bit = 1 << o;
+        if (!(input.mPendingOutputs & bit) || !canQueue(inInput, o))
+        {
+            continue; // Try again later.
+        }
+
+        Output& output = mOutputs[o];
+
+        byte first = 0;
+        if (status >= 0x80 && status < 0xf0)
+        {
+            if (output.mRunningStatus == status)
+            {
+                first = 1;
+            }
+            output.mRunningStatus = status;
+        }
+        else if (status >= 0x80)
+        {
+            output.mRunningStatus = 0;
+        }
+
+        for (byte i = first; i < input.mLength; ++i)
+        {
+            output.mQueue.push(input.mMessage[i]);
+        }
+
+        if (status == SystemExclusive)
+        {
+            output.mOwner = inInput;
+        }
+        else if (status == 0xf7)
+        {
+            output.mOwner = sNoOwner;
+        }
+        input.mPendingOutputs &= ~bit;
+    }
+
+    if (input.mPendingOutputs == 0 && status == 0xf7)
+    {
+        input.mInSysEx = false;
+    }
+}
+
+// A status byte other than 0xf7 came in the middle of a SysEx: it ends the
+// SysEx for the receivers, and the outputs are freed for the other inputs.
+template<byte PortCount, byte QueueSize>
+void Router<PortCount, QueueSize>::endSysEx(byte inInput)
+{
+    for (byte o = 0; o < PortCount; ++o)
+    {
+        if (mOutputs[o].mOwner == inInput)
+        {
+            mOutputs[o].mOwner = sNoOwner;
+        }
+    }
+    mInputs[inInput].mInSysEx = false;
+}
+
+END_MIDI_NAMESPACE
@@ -56,9 +56,17 @@ struct DefaultSettings
      */
     static const bool HandleNullVelocityNoteOnAsNoteOff = true;
 
+    /*! Send NoteOff messages as null-velocity NoteOn messages, so that notes
+     being started and stopped on the same channel all share the same running
+     status (saves a byte per NoteOff). The release velocity is lost.\n
+     Only used with UseRunningStatus.
+     */
+    static const bool SendNoteOffAsNullVelocityNoteOn = false;
+
     // Setting this to 1 will make MIDI.read parse only one byte of data for each
     // call when data is available. This can speed up your application if receiving
     // a lot of traffic, but might induce MIDI Thru and treatment latency.
+    // readAll() ignores this setting and always drains the whole serial buffer.
     static const bool Use1ByteParsing = true;
 
     /*! Override the default MIDI baudrate to transmit over USB serial, to
@@ -68,9 +76,35 @@ struct DefaultSettings
     static const long BaudRate = 31250;
 
     /*! Maximum size of SysEx receivable. Decrease to save RAM if you don't expect
-    to receive SysEx, or adjust accordingly.
+    to receive SysEx, or adjust accordingly.\n
+    Set to 0 to ignore SysEx without using any RAM, or to supply your own
+    buffer with MidiInterface::setSysExBuffer.\n
+    When SysEx is streamed in chunks (see SysExChunkFlags), this is the chunk size.
     */
     static const unsigned SysExMaxSize = 128;
+
+    /*! Size of the output buffer, in bytes (a power of two, up to 128).\n
+    With 0, the send methods write straight to the serial port and return
+    once all the bytes are written. Otherwise, they only fill the buffer
+    (and write to the serial port only when it is full), and MidiInterface::flush
+    must be called from loop() to actually send the buffered bytes.
+    */
+    static const byte TxBufferSize = 0;
+
+    /*! Keep the arrival time of each received message, given by
+    MidiInterface::getTimestamp, so that the time spent in loop() before
+    read() does not delay recorded or followed events.\n
+    The serial port must have a getTimestamp() method returning the arrival
+    time of the byte returned by the last read(), like midi::Uart with
+    Timestamps. Costs 12 bytes of RAM.
+    */
+    static const bool UseReceiveTimestamps = false;
+
+    /*! Set to false if you only use compile-time handlers (see midi::Handler)
+    or read the messages yourself: the setHandle******** callbacks are then
+    compiled out, with their function pointers (38 bytes of RAM on AVR).
+    */
+    static const bool UseCallbacks = true;
 };
 
 END_MIDI_NAMESPACE
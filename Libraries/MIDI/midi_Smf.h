@@ -0,0 +1,909 @@
+/*!
+ *  @file       midi_Smf.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Standard MIDI Files
+ *  @version    4.2
+ *  @author     Francois Best
+ *  @date       24/02/11
+ *  @license    GPL v3.0 - Copyright Forty Seven Effects 2014
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "midi_Defs.h"
+#include "midi_Message.h"
+#include <stddef.h>
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief An event read from a Standard MIDI File.
+
+ Channel events come with their status and data bytes, like on the wire
+ (running status is resolved). SysEx (0xf0 and 0xf7) and meta (0xff) events
+ come with the length and position of their data in the file, which stays
+ there until read with SmfReader::readData, so that they take no memory.
+ */
+struct SmfEvent
+{
+    unsigned long tick;     ///< Ticks from the start of the file.
+    unsigned long time;     ///< Microseconds from the start of the file.
+    byte track;
+    byte status;            ///< Status byte, 0xf0/0xf7 for SysEx, 0xff for meta.
+    byte data1;             ///< Meta event type for meta events.
+    byte data2;
+    unsigned long length;   ///< Length of the SysEx or meta data.
+    unsigned long position; ///< Position of the SysEx or meta data in the file.
+
+    inline bool isChannelMessage() const
+    {
+        return status >= 0x80 && status < 0xf0;
+    }
+
+    inline MidiType getType() const
+    {
+        return isChannelMessage() ? MidiType(status & 0xf0) : MidiType(status);
+    }
+
+    /*! \return The channel, from 1 to 16, for channel events.
+     */
+    inline Channel getChannel() const
+    {
+        return (status & 0x0f) + 1;
+    }
+};
+
+/*! \brief Meta event types handled by SmfReader and SmfWriter.
+ */
+enum SmfMetaType
+{
+    SmfEndOfTrack   = 0x2f,
+    SmfTempo        = 0x51,
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Reads a Standard MIDI File of type 0 or 1 as a stream of events, in
+ time order.
+
+ Source is where the file is read from, it must implement the seek and read
+ methods of the SD library's File class:
+ - bool seek(unsigned long inPosition)
+ - int read(), returning -1 at the end of the file.
+ SmfMemorySource and SmfProgmemSource read files stored in RAM or in flash.
+
+ Memory use does not depend on the file: each track only keeps its position
+ in the file, the tick of its next event and its running status, and tracks
+ are merged by a heap of MaxTracks track numbers, ordered by the tick of their
+ next event (the lowest track number comes first when ticks are equal).
+ Files with more tracks than MaxTracks are rejected.
+
+ Events carry their time in microseconds, following the tempo changes, so
+ that they can be scheduled against micros(), or with Coroutine::wait:
+
+ \code{.cpp}
+ while (reader.read(event))
+ {
+     // Late events are played right away.
+     const long ahead = (long)(start + event.time - micros());
+     coroutine.wait(ahead > 0 ? ahead / 1000 : 0);
+     COROUTINE_YIELD;
+     play(event);
+ }
+ \endcode
+ */
+template<class Source, byte MaxTracks = 16>
+class SmfReader
+{
+public:
+    inline SmfReader(Source& inSource);
+
+public:
+    inline bool begin();
+    inline bool read(SmfEvent& outEvent);
+    inline unsigned readData(const SmfEvent& inEvent, byte* outData, unsigned inMaxLength);
+
+public:
+    inline bool isFinished() const;
+    inline unsigned getFormat() const;
+    inline byte getTrackCount() const;
+    inline unsigned getDivision() const;
+    inline unsigned long getTempo() const;
+
+private:
+    struct Track
+    {
+        unsigned long position;     ///< Next byte to read.
+        unsigned long end;
+        unsigned long tick;         ///< Tick of the next event.
+        byte runningStatus;
+    };
+
+    inline int readByte(Track& inTrack);
+    inline bool readVariableLength(Track& inTrack, unsigned long& outValue);
+    inline unsigned long readBigEndian(byte inSize);
+    inline bool readEvent(Track& inTrack, SmfEvent& outEvent);
+    inline unsigned long getTime(unsigned long inTick) const;
+
+    inline bool isBefore(byte inTrackA, byte inTrackB) const;
+    inline void siftUp(byte inPosition);
+    inline void siftDown(byte inPosition);
+
+private:
+    Source& mSource;
+    Track mTracks[MaxTracks];
+    byte mHeap[MaxTracks];
+    byte mHeapSize;
+    byte mTrackCount;
+    unsigned mFormat;
+    unsigned mDivision;             ///< Ticks per quarter note, or per second.
+    unsigned long mTempo;           ///< Microseconds per quarter note.
+    unsigned long mTempoTick;       ///< Tick of the last tempo change.
+    unsigned long mTempoTime;       ///< Time of the last tempo change.
+    bool mSmpte;                    ///< Ticks are frame subdivisions, the tempo is ignored.
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Writes a Standard MIDI File of type 0 (a single track), from
+ messages timestamped in microseconds.
+
+ Sink is where the file is written, it must implement the write and seek
+ methods of the SD library's File class:
+ - size_t write(byte inByte)
+ - bool seek(unsigned long inPosition), to write the track length at the end.
+
+ The file uses sDivision ticks per quarter note at sTempo microseconds per
+ quarter note (120 BPM), about half a millisecond per tick. Times are
+ converted into ticks without accumulating rounding errors.
+ Channel messages are written with running status. Real Time and System
+ Common messages are not recorded, as they can't be stored in SMF tracks.
+
+ \code{.cpp}
+ writer.begin(micros());
+ ...
+ if (MIDI.read())
+     writer.record(MIDI, micros());
+ ...
+ writer.end(micros());
+ \endcode
+ */
+template<class Sink>
+class SmfWriter
+{
+public:
+    static const unsigned sDivision     = 960;
+    static const unsigned long sTempo   = 500000;
+
+public:
+    inline SmfWriter(Sink& inSink);
+
+public:
+    inline void begin(unsigned long inTime);
+    inline void write(byte inStatus, byte inData1, byte inData2, unsigned long inTime);
+    inline void writeSysEx(const byte* inArray, unsigned inLength, unsigned long inTime);
+    template<class Midi> inline void record(const Midi& inMidi, unsigned long inTime);
+    inline void end(unsigned long inTime);
+
+public:
+    inline unsigned long getLength() const;
+
+private:
+    static const byte sHeaderLength = 14;
+
+    inline void writeByte(byte inByte);
+    inline void writeBigEndian(unsigned long inValue, byte inSize);
+    inline void writeVariableLength(unsigned long inValue);
+    inline void writeDelta(unsigned long inTime);
+
+private:
+    Sink& mSink;
+    unsigned long mLength;
+    unsigned long mLastTime;
+    unsigned long mRemainder;       ///< Time not converted to ticks yet, times sDivision.
+    byte mRunningStatus;
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Source for SmfReader, reading a file stored in RAM.
+ */
+class SmfMemorySource
+{
+public:
+    inline SmfMemorySource(const byte* inData, unsigned long inSize)
+        : mData(inData)
+        , mSize(inSize)
+        , mPosition(0)
+    {
+    }
+
+    inline bool seek(unsigned long inPosition)
+    {
+        mPosition = inPosition;
+        return inPosition <= mSize;
+    }
+
+    inline int read()
+    {
+        return mPosition < mSize ? mData[mPosition++] : -1;
+    }
+
+private:
+    const byte* mData;
+    unsigned long mSize;
+    unsigned long mPosition;
+};
+
+#if defined(pgm_read_byte)
+
+/*! \brief Source for SmfReader, reading a file stored in flash with PROGMEM.
+ */
+class SmfProgmemSource
+{
+public:
+    inline SmfProgmemSource(const byte* inData, unsigned long inSize)
+        : mData(inData)
+        , mSize(inSize)
+        , mPosition(0)
+    {
+    }
+
+    inline bool seek(unsigned long inPosition)
+    {
+        mPosition = inPosition;
+        return inPosition <= mSize;
+    }
+
+    inline int read()
+    {
+        return mPosition < mSize ? pgm_read_byte(mData + mPosition++) : -1;
+    }
+
+private:
+    const byte* mData;
+    unsigned long mSize;
+    unsigned long mPosition;
+};
+
+#endif
+
+/*! \brief Sink for SmfWriter, writing to a buffer in RAM. Bytes past the end
+ of the buffer are dropped.
+ */
+class SmfMemorySink
+{
+public:
+    inline SmfMemorySink(byte* inBuffer, unsigned long inSize)
+        : mBuffer(inBuffer)
+        , mSize(inSize)
+        , mPosition(0)
+        , mLength(0)
+    {
+    }
+
+    inline size_t write(byte inByte)
+    {
+        if (mPosition >= mSize)
+        {
+            return 0;
+        }
+        mBuffer[mPosition++] = inByte;
+        if (mPosition > mLength)
+        {
+            mLength = mPosition;
+        }
+        return 1;
+    }
+
+    inline bool seek(unsigned long inPosition)
+    {
+        mPosition = inPosition;
+        return inPosition <= mSize;
+    }
+
+    /// The number of bytes written, up to the size of the buffer.
+    inline unsigned long getLength() const
+    {
+        return mLength;
+    }
+
+private:
+    byte* mBuffer;
+    unsigned long mSize;
+    unsigned long mPosition;
+    unsigned long mLength;
+};
+
+// -----------------------------------------------------------------------------
+
+template<class Source, byte MaxTracks>
+inline SmfReader<Source, MaxTracks>::SmfReader(Source& inSource)
+    : mSource(inSource)
+    , mHeapSize(0)
+    , mTrackCount(0)
+    , mFormat(0)
+    , mDivision(0)
+    , mTempo(500000)
+    , mTempoTick(0)
+    , mTempoTime(0)
+    , mSmpte(false)
+{
+}
+
+/*! \brief Read the header of the file and locate its tracks.
+ \return False if the file is not an SMF of type 0 or 1, or if it has more
+ than MaxTracks tracks.
+ */
+template<class Source, byte MaxTracks>
+inline bool SmfReader<Source, MaxTracks>::begin()
+{
+    mHeapSize = 0;
+    mTrackCount = 0;
+    mTempo = 500000;
+    mTempoTick = 0;
+    mTempoTime = 0;
+
+    mSource.seek(0);
+    if (readBigEndian(4) != 0x4d546864) // "MThd"
+    {
+        return false;
+    }
+    const unsigned long headerLength = readBigEndian(4);
+    mFormat = readBigEndian(2);
+    const unsigned trackCount = readBigEndian(2);
+    const unsigned division = readBigEndian(2);
+
+    if (headerLength < 6 || mFormat > 1 || trackCount > MaxTracks ||
+        (mFormat == 0 && trackCount != 1) || division == 0)
+    {
+        return false;
+    }
+
+    mSmpte = (division & 0x8000) != 0;
+    if (mSmpte)
+    {
+        // Negative frames per second (29 stands for 29.97), ticks per frame.
+        const byte framesPerSecond = 256 - (division >> 8);
+        mDivision = (framesPerSecond == 29 ? 30 : framesPerSecond) * (division & 0xff);
+        mTempo = 1000000;
+    }
+    else
+    {
+        mDivision = division;
+    }
+
+    // Chunks that are not tracks are skipped.
+    unsigned long position = 8 + headerLength;
+    while (mTrackCount < trackCount)
+    {
+        mSource.seek(position);
+        const unsigned long id = readBigEndian(4);
+        const unsigned long length = readBigEndian(4);
+        position += 8;
+
+        if (id == 0x4d54726b) // "MTrk"
+        {
+            Track& track = mTracks[mTrackCount];
+            track.position = position;
+            track.end = position + length;
+            track.tick = 0;
+            track.runningStatus = 0;
+
+            if (readVariableLength(track, track.tick))
+            {
+                mHeap[mHeapSize] = mTrackCount;
+                siftUp(mHeapSize++);
+            }
+            mTrackCount++;
+        }
+        else if (id == 0xffffffff)
+        {
+            return false; // End of the file.
+        }
+        position += length;
+    }
+    return true;
+}
+
+/*! \brief Read the next event of the file, in time order.
+ \return False once all the events were read.
+ */
+template<class Source, byte MaxTracks>
+inline bool SmfReader<Source, MaxTracks>::read(SmfEvent& outEvent)
+{
+    while (mHeapSize != 0)
+    {
+        const byte index = mHeap[0];
+        Track& track = mTracks[index];
+
+        // The time is computed before a tempo change applies.
+        mSource.seek(track.position);
+        outEvent.tick  = track.tick;
+        outEvent.time  = getTime(track.tick);
+        outEvent.track = index;
+        const bool valid = readEvent(track, outEvent);
+
+        unsigned long delta = 0;
+        if (valid && track.position < track.end &&
+            readVariableLength(track, delta))
+        {
+            track.tick += delta;
+            siftDown(0);
+        }
+        else
+        {
+            // End of the track, or a truncated event.
+            mHeap[0] = mHeap[--mHeapSize];
+            siftDown(0);
+        }
+
+        if (valid)
+        {
+            if (outEvent.status == 0xff && outEvent.data1 == SmfTempo)
+            {
+                mTempoTime = outEvent.time;
+                mTempoTick = outEvent.tick;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+/*! \brief Read the data of a SysEx or meta event.
+ \return The number of bytes read, at most inMaxLength.
+ */
+template<class Source, byte MaxTracks>
+inline unsigned SmfReader<Source, MaxTracks>::readData(const SmfEvent& inEvent,
+                                                       byte* outData,
+                                                       unsigned inMaxLength)
+{
+    const unsigned length = inEvent.length < inMaxLength ? inEvent.length : inMaxLength;
+    mSource.seek(inEvent.position);
+    for (unsigned i = 0; i < length; ++i)
+    {
+        const int value = mSource.read();
+        if (value < 0)
+        {
+            return i;
+        }
+        outData[i] = value;
+    }
+    return length;
+}
+
+template<class Source, byte MaxTracks>
+inline bool SmfReader<Source, MaxTracks>::isFinished() const
+{
+    return mHeapSize == 0;
+}
+
+template<class Source, byte MaxTracks>
+inline unsigned SmfReader<Source, MaxTracks>::getFormat() const
+{
+    return mFormat;
+}
+
+template<class Source, byte MaxTracks>
+inline byte SmfReader<Source, MaxTracks>::getTrackCount() const
+{
+    return mTrackCount;
+}
+
+/*! \brief Get the ticks per quarter note, or per second for SMPTE timing.
+ */
+template<class Source, byte MaxTracks>
+inline unsigned SmfReader<Source, MaxTracks>::getDivision() const
+{
+    return mDivision;
+}
+
+/*! \brief Get the current tempo, in microseconds per quarter note.
+ */
+template<class Source, byte MaxTracks>
+inline unsigned long SmfReader<Source, MaxTracks>::getTempo() const
+{
+    return mTempo;
+}
+
+// -----------------------------------------------------------------------------
+
+template<class Source, byte MaxTracks>
+inline int SmfReader<Source, MaxTracks>::readByte(Track& inTrack)
+{
+    if (inTrack.position >= inTrack.end)
+    {
+        return -1;
+    }
+    inTrack.position++;
+    return mSource.read();
+}
+
+template<class Source, byte MaxTracks>
+inline bool SmfReader<Source, MaxTracks>::readVariableLength(Track& inTrack,
+                                                             unsigned long& outValue)
+{
+    unsigned long value = 0;
+    for (byte i = 0; i < 4; ++i)
+    {
+        const int data = readByte(inTrack);
+        if (data < 0)
+        {
+            return false;
+        }
+        value = (value << 7) | (data & 0x7f);
+        if ((data & 0x80) == 0)
+        {
+            outValue = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+template<class Source, byte MaxTracks>
+inline unsigned long SmfReader<Source, MaxTracks>::readBigEndian(byte inSize)
+{
+    unsigned long value = 0;
+    for (byte i = 0; i < inSize; ++i)
+    {
+        const int data = mSource.read();
+        if (data < 0)
+        {
+            return 0xffffffff;
+        }
+        value = (value << 8) | data;
+    }
+    return value;
+}
+
+/*! The source must be at the position of the track. Leaves the track at the
+ delta time of its next event.
+ */
+template<class Source, byte MaxTracks>
+inline bool SmfReader<Source, MaxTracks>::readEvent(Track& inTrack, SmfEvent& outEvent)
+{
+    int data = readByte(inTrack);
+    if (data < 0)
+    {
+        return false;
+    }
+
+    byte status = data;
+    if (status < 0x80)
+    {
+        // Running status, this was the first data byte.
+        status = inTrack.runningStatus;
+        if (status == 0)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        data = -1;
+    }
+
+    outEvent.status = status;
+    outEvent.data1  = 0;
+    outEvent.data2  = 0;
+    outEvent.length = 0;
+
+    if (status < 0xf0)
+    {
+        inTrack.runningStatus = status;
+        if (data < 0)
+        {
+            data = readByte(inTrack);
+        }
+        outEvent.data1 = data;
+        if (getMessageLength(status) == 3)
+        {
+            data = readByte(inTrack);
+            outEvent.data2 = data;
+        }
+        return data >= 0;
+    }
+
+    // SysEx and meta events cancel running status.
+    inTrack.runningStatus = 0;
+    if (status == 0xff)
+    {
+        data = readByte(inTrack);
+        if (data < 0)
+        {
+            return false;
+        }
+        outEvent.data1 = data;
+    }
+    else if (status != 0xf0 && status != 0xf7)
+    {
+        return false;
+    }
+
+    if (!readVariableLength(inTrack, outEvent.length) ||
+        outEvent.length > inTrack.end - inTrack.position)
+    {
+        return false;
+    }
+    outEvent.position = inTrack.position;
+
+    if (status == 0xff && outEvent.data1 == SmfTempo && outEvent.length == 3)
+    {
+        const unsigned long tempo = readBigEndian(3);
+        if (!mSmpte && tempo != 0)
+        {
+            // The tick and time of the change are set by read.
+            mTempo = tempo;
+        }
+    }
+    else if (status == 0xff && outEvent.data1 == SmfEndOfTrack)
+    {
+        inTrack.end = inTrack.position;
+    }
+
+    inTrack.position += outEvent.length;
+    mSource.seek(inTrack.position);
+    return true;
+}
+
+template<class Source, byte MaxTracks>
+inline unsigned long SmfReader<Source, MaxTracks>::getTime(unsigned long inTick) const
+{
+    return mTempoTime + (unsigned long)((unsigned long long)(inTick - mTempoTick) * mTempo / mDivision);
+}
+
+template<class Source, byte MaxTracks>
+inline bool SmfReader<Source, MaxTracks>::isBefore(byte inTrackA, byte inTrackB) const
+{
+    const unsigned long tickA = mTracks[inTrackA].tick;
+    const unsigned long tickB = mTracks[inTrackB].tick;
+    return tickA < tickB || (tickA == tickB && inTrackA < inTrackB);
+}
+
+template<class Source, byte MaxTracks>
+inline void SmfReader<Source, MaxTracks>::siftUp(byte inPosition)
+{
+    while (inPosition > 0)
+    {
+        const byte parent = (inPosition - 1) / 2;
+        if (!isBefore(mHeap[inPosition], mHeap[parent]))
+        {
+            break;
+        }
+        const byte swap = mHeap[parent];
+        mHeap[parent] = mHeap[inPosition];
+        mHeap[inPosition] = swap;
+        inPosition = parent;
+    }
+}
+
+template<class Source, byte MaxTracks>
+inline void SmfReader<Source, MaxTracks>::siftDown(byte inPosition)
+{
+    for (;;)
+    {
+        const byte left = inPosition * 2 + 1;
+        if (left >= mHeapSize)
+        {
+            break;
+        }
+        const byte right = left + 1;
+        const byte child = (right < mHeapSize && isBefore(mHeap[right], mHeap[left])) ? right : left;
+        if (!isBefore(mHeap[child], mHeap[inPosition]))
+        {
+            break;
+        }
+        const byte swap = mHeap[child];
+        mHeap[child] = mHeap[inPosition];
+        mHeap[inPosition] = swap;
+        inPosition = child;
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+template<class Sink>
+inline SmfWriter<Sink>::SmfWriter(Sink& inSink)
+    : mSink(inSink)
+    , mLength(0)
+    , mLastTime(0)
+    , mRemainder(0)
+    , mRunningStatus(0)
+{
+}
+
+/*! \brief Write the file header, the tempo, and start the track.
+ \param inTime The time of the start of the file, in microseconds.
+ */
+template<class Sink>
+inline void SmfWriter<Sink>::begin(unsigned long inTime)
+{
+    mLength = 0;
+    mLastTime = inTime;
+    mRemainder = 0;
+    mRunningStatus = 0;
+
+    mSink.seek(0);
+    writeBigEndian(0x4d546864, 4);  // "MThd"
+    writeBigEndian(6, 4);
+    writeBigEndian(0, 2);           // Type 0
+    writeBigEndian(1, 2);           // 1 track
+    writeBigEndian(sDivision, 2);
+    writeBigEndian(0x4d54726b, 4);  // "MTrk"
+    writeBigEndian(0, 4);           // Length, written by end
+
+    writeByte(0);
+    writeByte(0xff);
+    writeByte(SmfTempo);
+    writeByte(3);
+    writeBigEndian(sTempo, 3);
+}
+
+/*! \brief Write a channel message.
+ \param inStatus The status byte, with the channel.
+ \param inData1 The first data byte.
+ \param inData2 The second data byte, ignored by two bytes messages.
+ \param inTime The time of the message, in microseconds.
+ */
+template<class Sink>
+inline void SmfWriter<Sink>::write(byte inStatus,
+                                   byte inData1,
+                                   byte inData2,
+                                   unsigned long inTime)
+{
+    writeDelta(inTime);
+    if (inStatus != mRunningStatus)
+    {
+        writeByte(inStatus);
+        mRunningStatus = inStatus;
+    }
+    writeByte(inData1);
+    if (getMessageLength(inStatus) == 3)
+    {
+        writeByte(inData2);
+    }
+}
+
+/*! \brief Write a SysEx.
+ \param inArray The SysEx, starting with 0xf0. Without it, the bytes are
+ written as the continuation of the previous SysEx (an 0xf7 event).
+ \param inLength The number of bytes in the array.
+ \param inTime The time of the message, in microseconds.
+ */
+template<class Sink>
+inline void SmfWriter<Sink>::writeSysEx(const byte* inArray,
+                                        unsigned inLength,
+                                        unsigned long inTime)
+{
+    if (inLength == 0)
+    {
+        return;
+    }
+
+    writeDelta(inTime);
+    if (inArray[0] == SystemExclusive)
+    {
+        writeByte(0xf0);
+        inArray++;
+        inLength--;
+    }
+    else
+    {
+        writeByte(0xf7);
+    }
+    writeVariableLength(inLength);
+    for (unsigned i = 0; i < inLength; ++i)
+    {
+        writeByte(inArray[i]);
+    }
+    mRunningStatus = 0;
+}
+
+/*! \brief Write the message last read by a MidiInterface.
+ \param inMidi The MidiInterface, right after its read method returned true.
+ \param inTime The time of the message, in microseconds.
+ */
+template<class Sink>
+template<class Midi>
+inline void SmfWriter<Sink>::record(const Midi& inMidi, unsigned long inTime)
+{
+    const MidiType type = inMidi.getType();
+    if (type >= NoteOff && type < SystemExclusive)
+    {
+        write(type | (inMidi.getChannel() - 1), inMidi.getData1(), inMidi.getData2(), inTime);
+    }
+    else if (type == SystemExclusive)
+    {
+        writeSysEx(inMidi.getSysExArray(), inMidi.getSysExArrayLength(), inTime);
+    }
+}
+
+/*! \brief End the track and write its length.
+ \param inTime The time of the end of the file, in microseconds.
+ */
+template<class Sink>
+inline void SmfWriter<Sink>::end(unsigned long inTime)
+{
+    writeDelta(inTime);
+    writeByte(0xff);
+    writeByte(SmfEndOfTrack);
+    writeByte(0);
+
+    const unsigned long length = mLength;
+    mSink.seek(sHeaderLength + 4);
+    writeBigEndian(length - sHeaderLength - 8, 4);
+    mLength = length;
+    mSink.seek(length);
+}
+
+/*! \brief Get the number of bytes written in the file.
+ */
+template<class Sink>
+inline unsigned long SmfWriter<Sink>::getLength() const
+{
+    return mLength;
+}
+
+// -----------------------------------------------------------------------------
+
+template<class Sink>
+inline void SmfWriter<Sink>::writeByte(byte inByte)
+{
+    mSink.write(inByte);
+    mLength++;
+}
+
+template<class Sink>
+inline void SmfWriter<Sink>::writeBigEndian(unsigned long inValue, byte inSize)
+{
+    while (inSize-- > 0)
+    {
+        writeByte(inValue >> (inSize * 8));
+    }
+}
+
+template<class Sink>
+inline void SmfWriter<Sink>::writeVariableLength(unsigned long inValue)
+{
+    byte groups = 1;
+    while (groups < 4 && (inValue >> (7 * groups)) != 0)
+    {
+        groups++;
+    }
+    while (--groups > 0)
+    {
+        writeByte(0x80 | ((inValue >> (7 * groups)) & 0x7f));
+    }
+    writeByte(inValue & 0x7f);
+}
+
+template<class Sink>
+inline void SmfWriter<Sink>::writeDelta(unsigned long inTime)
+{
+    // Whole quarter notes first, so that the products never overflow.
+    const unsigned long elapsed = inTime - mLastTime;
+    mLastTime = inTime;
+
+    unsigned long ticks = elapsed / sTempo * sDivision;
+    mRemainder += elapsed % sTempo * sDivision;
+    ticks += mRemainder / sTempo;
+    mRemainder %= sTempo;
+
+    writeVariableLength(ticks);
+}
+
+END_MIDI_NAMESPACE
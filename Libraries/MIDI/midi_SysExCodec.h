@@ -0,0 +1,362 @@
+/*!
+ *  @file       midi_SysExCodec.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - SysEx 7-bit encoding
+ *  @version    4.2
+ *  @author     Francois Best
+ *  @date       24/02/11
+ *  @license    GPL v3.0 - Copyright Forty Seven Effects 2014
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "midi_Defs.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Encode a group of 7 data bytes into 8 SysEx bytes.
+ The first SysEx byte holds the MSBs of the 7 data bytes (bit 0 for the first
+ one), followed by their 7 lower bits. This is the group encodeSysEx works on.
+
+ The group is handled as a whole word: on 64-bit hosts, the MSBs are gathered
+ with a single multiply (SWAR), 32-bit hosts do it in two halves, and AVR
+ works on unrolled bytes, as its multiplier is 8-bit only.
+ */
+inline void encodeSysExBlock(const byte* inData, byte* outSysEx)
+{
+#if defined(__AVR__)
+    byte msbs = 0;
+    if (inData[0] & 0x80) msbs |= 0x01;
+    if (inData[1] & 0x80) msbs |= 0x02;
+    if (inData[2] & 0x80) msbs |= 0x04;
+    if (inData[3] & 0x80) msbs |= 0x08;
+    if (inData[4] & 0x80) msbs |= 0x10;
+    if (inData[5] & 0x80) msbs |= 0x20;
+    if (inData[6] & 0x80) msbs |= 0x40;
+    outSysEx[0] = msbs;
+    outSysEx[1] = inData[0] & 0x7f;
+    outSysEx[2] = inData[1] & 0x7f;
+    outSysEx[3] = inData[2] & 0x7f;
+    outSysEx[4] = inData[3] & 0x7f;
+    outSysEx[5] = inData[4] & 0x7f;
+    outSysEx[6] = inData[5] & 0x7f;
+    outSysEx[7] = inData[6] & 0x7f;
+#elif defined(__LP64__) || defined(_WIN64)
+    // Byte-wise loads and stores, merged into words by the compiler without
+    // depending on the endianness or on the alignment.
+    const uint64_t data = uint64_t(inData[0])         | uint64_t(inData[1]) << 8
+                        | uint64_t(inData[2]) << 16   | uint64_t(inData[3]) << 24
+                        | uint64_t(inData[4]) << 32   | uint64_t(inData[5]) << 40
+                        | uint64_t(inData[6]) << 48;
+
+    // MSB of byte i moves to bit 8i, then to bit 56 + i.
+    const uint64_t msbs = (data >> 7) & 0x0001010101010101ULL;
+    const uint64_t sysEx = uint64_t((msbs * 0x0102040810204000ULL) >> 56)
+                         | (data & 0x007f7f7f7f7f7f7fULL) << 8;
+
+    outSysEx[0] = byte(sysEx);          outSysEx[1] = byte(sysEx >> 8);
+    outSysEx[2] = byte(sysEx >> 16);    outSysEx[3] = byte(sysEx >> 24);
+    outSysEx[4] = byte(sysEx >> 32);    outSysEx[5] = byte(sysEx >> 40);
+    outSysEx[6] = byte(sysEx >> 48);    outSysEx[7] = byte(sysEx >> 56);
+#else
+    const uint32_t low  = uint32_t(inData[0])         | uint32_t(inData[1]) << 8
+                        | uint32_t(inData[2]) << 16   | uint32_t(inData[3]) << 24;
+    const uint32_t high = uint32_t(inData[4])         | uint32_t(inData[5]) << 8
+                        | uint32_t(inData[6]) << 16;
+
+    // MSB of byte i moves to bit 8i, then to bit 24 + i.
+    const uint32_t msbs = ((((low  >> 7) & 0x01010101UL) * 0x01020408UL) >> 24)
+                        | ((((high >> 7) & 0x00010101UL) * 0x01020408UL) >> 20);
+    const uint32_t lowBody  = low  & 0x7f7f7f7fUL;
+    const uint32_t highBody = high & 0x007f7f7fUL;
+
+    outSysEx[0] = byte(msbs);
+    outSysEx[1] = byte(lowBody);        outSysEx[2] = byte(lowBody >> 8);
+    outSysEx[3] = byte(lowBody >> 16);  outSysEx[4] = byte(lowBody >> 24);
+    outSysEx[5] = byte(highBody);       outSysEx[6] = byte(highBody >> 8);
+    outSysEx[7] = byte(highBody >> 16);
+#endif
+}
+
+/*! \brief Decode a group of 8 SysEx bytes into 7 data bytes.
+ @see encodeSysExBlock
+ */
+inline void decodeSysExBlock(const byte* inSysEx, byte* outData)
+{
+    const byte msbs = inSysEx[0];
+#if defined(__AVR__)
+    outData[0] = inSysEx[1] | ((msbs & 0x01) ? 0x80 : 0);
+    outData[1] = inSysEx[2] | ((msbs & 0x02) ? 0x80 : 0);
+    outData[2] = inSysEx[3] | ((msbs & 0x04) ? 0x80 : 0);
+    outData[3] = inSysEx[4] | ((msbs & 0x08) ? 0x80 : 0);
+    outData[4] = inSysEx[5] | ((msbs & 0x10) ? 0x80 : 0);
+    outData[5] = inSysEx[6] | ((msbs & 0x20) ? 0x80 : 0);
+    outData[6] = inSysEx[7] | ((msbs & 0x40) ? 0x80 : 0);
+#elif defined(__LP64__) || defined(_WIN64)
+    const uint64_t body = uint64_t(inSysEx[1])         | uint64_t(inSysEx[2]) << 8
+                        | uint64_t(inSysEx[3]) << 16   | uint64_t(inSysEx[4]) << 24
+                        | uint64_t(inSysEx[5]) << 32   | uint64_t(inSysEx[6]) << 40
+                        | uint64_t(inSysEx[7]) << 48;
+
+    // Copies of the MSBs every 7 bits put bit i of copy i at bit 8i, then
+    // at bit 8i + 7. Bit 7 of the MSBs byte is ignored.
+    const uint64_t spread = ((uint64_t(msbs & 0x7f) * 0x0000040810204081ULL)
+                             & 0x0001010101010101ULL) << 7;
+    const uint64_t data = body | spread;
+
+    outData[0] = byte(data);            outData[1] = byte(data >> 8);
+    outData[2] = byte(data >> 16);      outData[3] = byte(data >> 24);
+    outData[4] = byte(data >> 32);      outData[5] = byte(data >> 40);
+    outData[6] = byte(data >> 48);
+#else
+    const uint32_t low  = uint32_t(inSysEx[1])         | uint32_t(inSysEx[2]) << 8
+                        | uint32_t(inSysEx[3]) << 16   | uint32_t(inSysEx[4]) << 24;
+    const uint32_t high = uint32_t(inSysEx[5])         | uint32_t(inSysEx[6]) << 8
+                        | uint32_t(inSysEx[7]) << 16;
+
+    const uint32_t lowData  = low  | ((uint32_t(msbs & 0x0f) * 0x00204081UL) & 0x01010101UL) << 7;
+    const uint32_t highData = high | ((uint32_t((msbs >> 4) & 0x07) * 0x00204081UL) & 0x00010101UL) << 7;
+
+    outData[0] = byte(lowData);         outData[1] = byte(lowData >> 8);
+    outData[2] = byte(lowData >> 16);   outData[3] = byte(lowData >> 24);
+    outData[4] = byte(highData);        outData[5] = byte(highData >> 8);
+    outData[6] = byte(highData >> 16);
+#endif
+}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Incremental SysEx encoder, for data that comes in chunks.
+
+ Each call to encode outputs the complete groups of 8 SysEx bytes, the data
+ bytes of an incomplete group are kept until the next call. Once all the data
+ went through, flush outputs the last incomplete group. Concatenated, the
+ outputs are the same as encodeSysEx on the whole data.
+
+ \code{.cpp}
+ midi::SysExEncoder encoder;
+ length  = encoder.encode(chunk1, size1, sysEx);
+ length += encoder.encode(chunk2, size2, sysEx + length);
+ length += encoder.flush(sysEx + length);
+ \endcode
+ */
+class SysExEncoder
+{
+public:
+    inline SysExEncoder();
+
+public:
+    inline void reset();
+    inline unsigned encode(const byte* inData, unsigned inLength, byte* outSysEx);
+    inline unsigned flush(byte* outSysEx);
+
+public:
+    static inline unsigned getEncodedLength(unsigned inLength);
+
+private:
+    byte mPending[7];
+    byte mPendingCount;
+};
+
+/*! \brief Incremental SysEx decoder, for SysEx that comes in chunks.
+
+ Data bytes are output as soon as their SysEx byte is decoded, only the MSBs
+ of the current group are kept between calls. Concatenated, the outputs are
+ the same as decodeSysEx on the whole SysEx.
+ */
+class SysExDecoder
+{
+public:
+    inline SysExDecoder();
+
+public:
+    inline void reset();
+    inline unsigned decode(const byte* inSysEx, unsigned inLength, byte* outData);
+
+public:
+    static inline unsigned getDecodedLength(unsigned inLength);
+
+private:
+    byte mMsbs;
+    byte mPosition;     ///< Position in the current group of 8 bytes.
+};
+
+// -----------------------------------------------------------------------------
+
+inline SysExEncoder::SysExEncoder()
+    : mPendingCount(0)
+{
+}
+
+/*! \brief Drop the pending data, to start encoding another message.
+ */
+inline void SysExEncoder::reset()
+{
+    mPendingCount = 0;
+}
+
+/*! \brief Encode a chunk of data.
+ \param inData The data to encode.
+ \param inLength The length of the data.
+ \param outSysEx The output buffer. It must hold 8 bytes per group of 7 data
+ bytes, counting the pending ones: getEncodedLength(inLength + 6) is enough.
+ \return The number of SysEx bytes written.
+ */
+inline unsigned SysExEncoder::encode(const byte* inData,
+                                     unsigned inLength,
+                                     byte* outSysEx)
+{
+    unsigned outLength = 0;
+
+    if (mPendingCount != 0)
+    {
+        while (mPendingCount < 7 && inLength != 0)
+        {
+            mPending[mPendingCount++] = *inData++;
+            inLength--;
+        }
+        if (mPendingCount < 7)
+        {
+            return 0;
+        }
+        encodeSysExBlock(mPending, outSysEx);
+        outLength = 8;
+        mPendingCount = 0;
+    }
+
+    for (; inLength >= 7; inLength -= 7)
+    {
+        encodeSysExBlock(inData, outSysEx + outLength);
+        inData    += 7;
+        outLength += 8;
+    }
+
+    for (byte i = 0; i < inLength; ++i)
+    {
+        mPending[i] = inData[i];
+    }
+    mPendingCount = inLength;
+    return outLength;
+}
+
+/*! \brief Output the last incomplete group, if any.
+ \param outSysEx The output buffer, 8 bytes at most are written.
+ \return The number of SysEx bytes written.
+ */
+inline unsigned SysExEncoder::flush(byte* outSysEx)
+{
+    if (mPendingCount == 0)
+    {
+        return 0;
+    }
+
+    // The missing bytes must not add their MSBs.
+    for (byte i = mPendingCount; i < 7; ++i)
+    {
+        mPending[i] = 0;
+    }
+
+    byte group[8];
+    encodeSysExBlock(mPending, group);
+
+    const byte length = mPendingCount + 1;
+    for (byte i = 0; i < length; ++i)
+    {
+        outSysEx[i] = group[i];
+    }
+    mPendingCount = 0;
+    return length;
+}
+
+/*! \brief Get the length of the SysEx encoding inLength data bytes.
+ */
+inline unsigned SysExEncoder::getEncodedLength(unsigned inLength)
+{
+    const unsigned remainder = inLength % 7;
+    return inLength / 7 * 8 + (remainder != 0 ? remainder + 1 : 0);
+}
+
+// -----------------------------------------------------------------------------
+
+inline SysExDecoder::SysExDecoder()
+    : mMsbs(0)
+    , mPosition(0)
+{
+}
+
+/*! \brief Restart at the beginning of a group, to decode another message.
+ */
+inline void SysExDecoder::reset()
+{
+    mMsbs = 0;
+    mPosition = 0;
+}
+
+/*! \brief Decode a chunk of SysEx.
+ \param inSysEx The SysEx bytes, without the 0xf0 and 0xf7 bytes.
+ \param inLength The number of SysEx bytes.
+ \param outData The output buffer, getDecodedLength(inLength) is enough.
+ \return The number of data bytes written.
+ */
+inline unsigned SysExDecoder::decode(const byte* inSysEx,
+                                     unsigned inLength,
+                                     byte* outData)
+{
+    unsigned outLength = 0;
+
+    // Finish the current group, byte per byte.
+    while (mPosition != 0 && inLength != 0)
+    {
+        outData[outLength++] = *inSysEx++ | ((mMsbs & 1) << 7);
+        mMsbs >>= 1;
+        mPosition = (mPosition + 1) & 7;
+        inLength--;
+    }
+
+    for (; inLength >= 8; inLength -= 8)
+    {
+        decodeSysExBlock(inSysEx, outData + outLength);
+        inSysEx   += 8;
+        outLength += 7;
+    }
+
+    // Start the next group.
+    if (inLength != 0)
+    {
+        mMsbs = *inSysEx++;
+        mPosition = 1;
+        inLength--;
+
+        while (inLength != 0)
+        {
+            outData[outLength++] = *inSysEx++ | ((mMsbs & 1) << 7);
+            mMsbs >>= 1;
+            mPosition++;
+            inLength--;
+        }
+    }
+    return outLength;
+}
+
+/*! \brief Get the number of data bytes decoded from a whole SysEx of
+ inLength bytes. A chunk never decodes to more than its own length.
+ */
+inline unsigned SysExDecoder::getDecodedLength(unsigned inLength)
+{
+    return inLength - (inLength + 7) / 8;
+}
+
+END_MIDI_NAMESPACE
@@ -0,0 +1,312 @@
+/*!
+ *  @file       midi_Uart.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Interrupt driven hardware serial port
+ *  @version    4.2
+ *  @author     Francois Best
+ *  @date       24/02/11
+ *  @license    GPL v3.0 - Copyright Forty Seven Effects 2014
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "midi_Defs.h"
+#include "midi_RingBuffer.h"
+
+#if defined(__AVR__)
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+// The MIDI port is on USART1 when there is one (Leonardo, Mega),
+// as USART0 is then wired to USB, else on USART0 (Uno).
+#if defined(UDR1)
+    #define MIDI_UART_UDR       UDR1
+    #define MIDI_UART_UCSRA     UCSR1A
+    #define MIDI_UART_UCSRB     UCSR1B
+    #define MIDI_UART_UCSRC     UCSR1C
+    #define MIDI_UART_UBRR      UBRR1
+    #define MIDI_UART_RX_vect   USART1_RX_vect
+    #define MIDI_UART_UDRE_vect USART1_UDRE_vect
+#elif defined(UDR0)
+    #define MIDI_UART_UDR       UDR0
+    #define MIDI_UART_UCSRA     UCSR0A
+    #define MIDI_UART_UCSRB     UCSR0B
+    #define MIDI_UART_UCSRC     UCSR0C
+    #define MIDI_UART_UBRR      UBRR0
+    #if defined(USART_RX_vect)
+        #define MIDI_UART_RX_vect   USART_RX_vect
+        #define MIDI_UART_UDRE_vect USART_UDRE_vect
+    #else
+        #define MIDI_UART_RX_vect   USART0_RX_vect
+        #define MIDI_UART_UDRE_vect USART0_UDRE_vect
+    #endif
+#endif
+
+// UCSRA and UCSRB bits are at the same place on every USART.
+#define MIDI_UART_U2X       1
+#define MIDI_UART_DOR       3
+#define MIDI_UART_FE        4
+#define MIDI_UART_UDRE      5
+#define MIDI_UART_UDRIE     5
+#define MIDI_UART_TXEN      3
+#define MIDI_UART_RXEN      4
+#define MIDI_UART_RXCIE     7
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief A serial port for MidiInterface, on the AVR hardware USART.
+
+ It replaces HardwareSerial (and its 64 bytes buffers and virtual calls)
+ with ring buffers of RxSize and TxSize bytes, powers of two up to 128.
+ The interrupt routines only move one byte between the USART and a ring,
+ so that back-to-back bytes (one every 320 microsecs at 31250 bauds) are
+ never lost, however long loop() takes, as long as the rings don't fill up.
+
+ With Timestamps, the receive interrupt also records the arrival time
+ (micros()) of each byte, see getTimestamp. This costs 4 bytes of RAM per
+ byte of RxSize.
+
+ The interrupt routines must be defined once in the sketch, with
+ MIDI_UART_ISR, and Serial1 (or Serial on boards without USB) can't be
+ used at the same time:
+ \code
+ typedef midi::Uart<64, 32> MidiUart;
+ MidiUart midiUart;
+ MIDI_UART_ISR(midiUart);
+ MIDI_CREATE_INSTANCE(MidiUart, midiUart, MIDI);
+ \endcode
+ */
+template<byte RxSize = 64, byte TxSize = 64, bool Timestamps = false>
+class Uart
+{
+public:
+    inline Uart();
+
+public:
+    inline void begin(long inBaudrate = 31250);
+    inline void end();
+
+    inline int available() const;
+    inline int read();
+    inline size_t write(byte inByte);
+    inline void flush();
+
+public:
+    inline unsigned long getTimestamp() const;
+    inline byte getOverflowCount() const;
+
+public:
+    // Called by the interrupt routines
+    inline void handleReceive();
+    inline void handleTransmit();
+
+private:
+    typedef char RxSizeMustBeAPowerOfTwoUpTo128[((RxSize & (RxSize - 1)) == 0 && RxSize != 0 && RxSize <= 128) ? 1 : -1];
+    typedef char TxSizeMustNotBeZero[TxSize != 0 ? 1 : -1];
+    static const byte sRxMask = RxSize - 1;
+
+private:
+    volatile byte mRxBuffer[RxSize];
+    volatile unsigned long mRxTimes[Timestamps ? RxSize : 1];
+    volatile byte mRxHead;          ///< Next slot to write, interrupt only.
+    volatile byte mRxTail;          ///< Next slot to read, main code only.
+    volatile byte mOverflowCount;
+    unsigned long mTimestamp;
+    RingBuffer<TxSize> mTxBuffer;
+};
+
+/*! \brief Define the interrupt routines of a Uart instance.
+ Use it once, at global scope, after the instance.
+ */
+#define MIDI_UART_ISR(Name)                                                     \
+    ISR(MIDI_UART_RX_vect)      { Name.handleReceive();  }                     \
+    ISR(MIDI_UART_UDRE_vect)    { Name.handleTransmit(); }
+
+// -----------------------------------------------------------------------------
+
+template<byte RxSize, byte TxSize, bool Timestamps>
+inline Uart<RxSize, TxSize, Timestamps>::Uart()
+    : mRxHead(0)
+    , mRxTail(0)
+    , mOverflowCount(0)
+    , mTimestamp(0)
+{
+}
+
+/*! \brief Setup the USART, 8N1, and enable its interrupts.
+ */
+template<byte RxSize, byte TxSize, bool Timestamps>
+inline void Uart<RxSize, TxSize, Timestamps>::begin(long inBaudrate)
+{
+    // Double speed: 31250 bauds is then exact at 8, 16 and 20 MHz.
+    MIDI_UART_UBRR  = (F_CPU / 8 + inBaudrate / 2) / inBaudrate - 1;
+    MIDI_UART_UCSRA = _BV(MIDI_UART_U2X);
+    MIDI_UART_UCSRC = 0x06;     // 8 data bits, no parity, 1 stop bit
+    MIDI_UART_UCSRB = _BV(MIDI_UART_RXEN) | _BV(MIDI_UART_TXEN) | _BV(MIDI_UART_RXCIE);
+}
+
+/*! \brief Wait for pending bytes to be sent, then disable the USART.
+ The pins can then be used as plain I/Os.
+ */
+template<byte RxSize, byte TxSize, bool Timestamps>
+inline void Uart<RxSize, TxSize, Timestamps>::end()
+{
+    flush();
+    MIDI_UART_UCSRB = 0;
+    mRxTail = mRxHead;
+}
+
+// -----------------------------------------------------------------------------
+
+template<byte RxSize, byte TxSize, bool Timestamps>
+inline int Uart<RxSize, TxSize, Timestamps>::available() const
+{
+    return byte(mRxHead - mRxTail);
+}
+
+/*! \brief Take the oldest received byte, -1 if there is none.
+ With Timestamps, getTimestamp then gives its arrival time.
+ */
+template<byte RxSize, byte TxSize, bool Timestamps>
+inline int Uart<RxSize, TxSize, Timestamps>::read()
+{
+    const byte tail = mRxTail;
+    if (tail == mRxHead)
+        return -1;
+
+    const byte value = mRxBuffer[tail & sRxMask];
+    if (Timestamps)
+    {
+        mTimestamp = mRxTimes[tail & sRxMask];
+    }
+    mRxTail = tail + 1;
+    return value;
+}
+
+/*! \brief Send a byte, or queue it if the USART is busy.
+ If the output ring is full, this waits for a byte to go out.
+ */
+template<byte RxSize, byte TxSize, bool Timestamps>
+inline size_t Uart<RxSize, TxSize, Timestamps>::write(byte inByte)
+{
+    // Nothing queued and the USART is free: skip the ring.
+    if (mTxBuffer.isEmpty() && bit_is_set(MIDI_UART_UCSRA, MIDI_UART_UDRE))
+    {
+        MIDI_UART_UDR = inByte;
+        return 1;
+    }
+
+    while (!mTxBuffer.push(inByte))
+    {
+        // With interrupts off, the ring would never drain: do it here.
+        if (bit_is_clear(SREG, SREG_I) && bit_is_set(MIDI_UART_UCSRA, MIDI_UART_UDRE))
+        {
+            handleTransmit();
+        }
+    }
+
+    MIDI_UART_UCSRB |= _BV(MIDI_UART_UDRIE);
+    return 1;
+}
+
+/*! \brief Wait for all queued bytes to be handed over to the USART.
+ */
+template<byte RxSize, byte TxSize, bool Timestamps>
+inline void Uart<RxSize, TxSize, Timestamps>::flush()
+{
+    while (!mTxBuffer.isEmpty())
+    {
+        if (bit_is_clear(SREG, SREG_I) && bit_is_set(MIDI_UART_UCSRA, MIDI_UART_UDRE))
+        {
+            handleTransmit();
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Arrival time, in micros(), of the byte returned by the last read().
+ Always 0 without Timestamps.
+ */
+template<byte RxSize, byte TxSize, bool Timestamps>
+inline unsigned long Uart<RxSize, TxSize, Timestamps>::getTimestamp() const
+{
+    return mTimestamp;
+}
+
+/*! \brief Number of bytes lost since begin: received while the input ring
+ was full, or overwritten in the USART before the interrupt could run.
+ Wraps around after 255.
+ */
+template<byte RxSize, byte TxSize, bool Timestamps>
+inline byte Uart<RxSize, TxSize, Timestamps>::getOverflowCount() const
+{
+    return mOverflowCount;
+}
+
+// -----------------------------------------------------------------------------
+
+template<byte RxSize, byte TxSize, bool Timestamps>
+inline void Uart<RxSize, TxSize, Timestamps>::handleReceive()
+{
+    // Status first, reading UDR clears it.
+    const byte status = MIDI_UART_UCSRA;
+    const byte value  = MIDI_UART_UDR;
+
+    if (bit_is_set(status, MIDI_UART_DOR))
+    {
+        mOverflowCount++;
+    }
+    if (bit_is_set(status, MIDI_UART_FE))
+    {
+        return;     // Framing error: noise or a wrong baudrate.
+    }
+
+    const byte head = mRxHead;
+    if (byte(head - mRxTail) >= RxSize)
+    {
+        mOverflowCount++;
+        return;
+    }
+
+    mRxBuffer[head & sRxMask] = value;
+    if (Timestamps)
+    {
+        mRxTimes[head & sRxMask] = micros();
+    }
+    mRxHead = head + 1;
+}
+
+template<byte RxSize, byte TxSize, bool Timestamps>
+inline void Uart<RxSize, TxSize, Timestamps>::handleTransmit()
+{
+    if (mTxBuffer.isEmpty())
+    {
+        MIDI_UART_UCSRB &= ~_BV(MIDI_UART_UDRIE);
+        return;
+    }
+
+    MIDI_UART_UDR = mTxBuffer.pop();
+    if (mTxBuffer.isEmpty())
+    {
+        MIDI_UART_UCSRB &= ~_BV(MIDI_UART_UDRIE);
+    }
+}
+
+END_MIDI_NAMESPACE
+
+#endif // __AVR__
@@ -0,0 +1,391 @@
+/*!
+ *  @file       midi_Watchdog.h
+ *  Project     Arduino MIDI Library
+ *  @brief      MIDI Library for the Arduino - Active Sensing watchdog and held notes
+ *  @version    4.2
+ *  @author     Francois Best
+ *  @date       24/02/11
+ *  @license    GPL v3.0 - Copyright Forty Seven Effects 2014
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "midi_Defs.h"
+
+BEGIN_MIDI_NAMESPACE
+
+/*! \brief Detects inputs that went silent, using Active Sensing.
+
+ A device that sends Active Sensing sends at least one message every 300ms,
+ an Active Sensing when it has nothing else to send. When a connection is lost
+ (cable unplugged, device turned off), the notes it left on never get their
+ NoteOff: the receiver should then turn them off itself.
+
+ Call receive for each message received from an input, whatever its channel,
+ and update from loop(). Inputs are only watched once they sent an Active
+ Sensing: devices that don't send it are never timed out. A timed out input
+ is watched again from its next Active Sensing.
+
+ \code{.cpp}
+ midi::ActiveSensingWatchdog<1> watchdog;
+
+ void loop()
+ {
+     if (MIDI.read())
+         watchdog.receive(0, MIDI.getType(), micros());
+     if (watchdog.update(micros()))
+         heldNotes.releaseAll(MIDI);
+ }
+ \endcode
+ */
+template<byte InputCount = 1>
+class ActiveSensingWatchdog
+{
+public:
+    /*! Silence allowed between two messages, in microseconds (300ms in the
+     MIDI spec, plus some margin for the sender's own jitter).
+     */
+    static const unsigned long sTimeout = 330000;
+
+public:
+    inline ActiveSensingWatchdog();
+
+public:
+    inline void receive(byte inInput, MidiType inType, unsigned long inTime);
+    inline byte update(unsigned long inTime);
+
+public:
+    inline bool isWatched(byte inInput) const;
+    inline unsigned long getLastTime(byte inInput) const;
+
+private:
+    typedef char InputCountMustBeBetween1And8[(InputCount > 0 && InputCount <= 8) ? 1 : -1];
+
+private:
+    unsigned long mLastTimes[InputCount];
+    byte mWatched;                  ///< Bit i set when input i sent Active Sensing.
+};
+
+// -----------------------------------------------------------------------------
+
+/*! \brief Tracks the notes held on all 16 channels, to release them at once.
+
+ Each channel has a 128 bit map of its held notes, and the channels holding
+ notes have their bit set in a 16 bit mask. releaseAll only sends a NoteOff
+ for the notes that are held: it skips the channels without notes, and the
+ empty bytes of the map, 8 notes at a time. NoteOffs are sent channel by
+ channel, so that they take 2 bytes each on the wire, the status byte only
+ being sent once per channel (3 bytes each if Settings::UseRunningStatus is
+ turned off). That is a short burst rather than the 2048 NoteOffs (or 16
+ All Notes Off, which not all devices honour) a panic would send.
+
+ Feed it with the messages sent to the device whose notes are tracked (or
+ received, on a Thru). 256 bytes of RAM.
+ */
+class HeldNotes
+{
+public:
+    inline HeldNotes();
+
+public:
+    inline void noteOn(Channel inChannel, DataByte inNote);
+    inline void noteOff(Channel inChannel, DataByte inNote);
+    inline void update(MidiType inType, Channel inChannel,
+                       DataByte inData1, DataByte inData2);
+    template<class Midi> inline void update(const Midi& inMidi);
+
+public:
+    inline void clear();
+    inline void clear(Channel inChannel);
+    template<class Midi> inline unsigned release(Midi& inMidi, Channel inChannel);
+    template<class Midi> inline unsigned releaseAll(Midi& inMidi);
+
+public:
+    inline bool isHeld(Channel inChannel, DataByte inNote) const;
+    inline bool isEmpty() const;
+    inline bool isEmpty(Channel inChannel) const;
+
+private:
+    static const byte sBytesPerChannel = 128 / 8;
+
+private:
+    byte mNotes[16][sBytesPerChannel];  ///< Bit (note & 7) of byte (note >> 3).
+    uint16_t mChannels;                 ///< Bit (channel - 1) set when it may hold notes.
+};
+
+// -----------------------------------------------------------------------------
+
+template<byte InputCount>
+inline ActiveSensingWatchdog<InputCount>::ActiveSensingWatchdog()
+    : mWatched(0)
+{
+    for (byte i = 0; i < InputCount; ++i)
+    {
+        mLastTimes[i] = 0;
+    }
+}
+
+/*! \brief To call when a message is received from an input.
+ \param inInput The index of the input, from 0 to InputCount - 1.
+ \param inType The type of the message, an Active Sensing starts watching the
+ input.
+ \param inTime The reception time, in microseconds (from micros()).
+ */
+template<byte InputCount>
+inline void ActiveSensingWatchdog<InputCount>::receive(byte inInput,
+                                                       MidiType inType,
+                                                       unsigned long inTime)
+{
+    if (inInput >= InputCount)
+        return;
+
+    mLastTimes[inInput] = inTime;
+
+    if (inType == ActiveSensing)
+    {
+        mWatched |= 1 << inInput;
+    }
+}
+
+/*! \brief Check for inputs that timed out.
+ \param inTime The current time, in microseconds (from micros()).
+ \return A mask of the inputs that timed out since the last call (bit i for
+ input i), 0 when all watched inputs are alive. These inputs are no longer
+ watched until they send Active Sensing again.
+ */
+template<byte InputCount>
+inline byte ActiveSensingWatchdog<InputCount>::update(unsigned long inTime)
+{
+    byte timedOut = 0;
+
+    for (byte i = 0; i < InputCount; ++i)
+    {
+        if ((mWatched & (1 << i)) && inTime - mLastTimes[i] > sTimeout)
+        {
+            timedOut |= 1 << i;
+        }
+    }
+
+    mWatched &= ~timedOut;
+    return timedOut;
+}
+
+template<byte InputCount>
+inline bool ActiveSensingWatchdog<InputCount>::isWatched(byte inInput) const
+{
+    return inInput < InputCount && (mWatched & (1 << inInput));
+}
+
+/*! \brief The time the last message was received from an input, in
+ microseconds, 0 until one was received.
+ */
+template<byte InputCount>
+inline unsigned long ActiveSensingWatchdog<InputCount>::getLastTime(byte inInput) const
+{
+    return inInput < InputCount ? mLastTimes[inInput] : 0;
+}
+
+// -----------------------------------------------------------------------------
+
+inline HeldNotes::HeldNotes()
+{
+    for (byte c = 0; c < 16; ++c)
+    {
+        for (byte i = 0; i < sBytesPerChannel; ++i)
+        {
+            mNotes[c][i] = 0;
+        }
+    }
+    mChannels = 0;
+}
+
+/*! \brief Channels go from 1 to 16, others are ignored.
+ */
+inline void HeldNotes::noteOn(Channel inChannel, DataByte inNote)
+{
+    if (inChannel < 1 || inChannel > 16 || inNote > 127)
+        return;
+
+    mNotes[inChannel - 1][inNote >> 3] |= 1 << (inNote & 7);
+    mChannels |= 1U << (inChannel - 1);
+}
+
+inline void HeldNotes::noteOff(Channel inChannel, DataByte inNote)
+{
+    if (inChannel < 1 || inChannel > 16 || inNote > 127)
+        return;
+
+    mNotes[inChannel - 1][inNote >> 3] &= ~(1 << (inNote & 7));
+}
+
+/*! \brief Follow a message: NoteOn and NoteOff (or NoteOn with a null
+ velocity) hold and release notes, All Sound Off and All Notes Off release
+ their channel, System Reset releases everything. Other messages are ignored.
+ */
+inline void HeldNotes::update(MidiType inType, Channel inChannel,
+                              DataByte inData1, DataByte inData2)
+{
+    switch (inType)
+    {
+        case NoteOn:
+            if (inData2 != 0)
+            {
+                noteOn(inChannel, inData1);
+            }
+            else
+            {
+                noteOff(inChannel, inData1);
+            }
+            break;
+
+        case NoteOff:
+            noteOff(inChannel, inData1);
+            break;
+
+        case ControlChange:
+            if (inData1 == AllSoundOff || inData1 == AllNotesOff)
+            {
+                clear(inChannel);
+            }
+            break;
+
+        case SystemReset:
+            clear();
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*! \brief Follow the last message read by a MidiInterface.
+ */
+template<class Midi>
+inline void HeldNotes::update(const Midi& inMidi)
+{
+    update(inMidi.getType(), inMidi.getChannel(),
+           inMidi.getData1(), inMidi.getData2());
+}
+
+/*! \brief Forget all notes, without sending anything.
+ */
+inline void HeldNotes::clear()
+{
+    for (byte c = 0; c < 16; ++c)
+    {
+        if (mChannels & (1U << c))
+        {
+            clear(c + 1);
+        }
+    }
+    mChannels = 0;
+}
+
+inline void HeldNotes::clear(Channel inChannel)
+{
+    if (inChannel < 1 || inChannel > 16)
+        return;
+
+    byte* notes = mNotes[inChannel - 1];
+    for (byte i = 0; i < sBytesPerChannel; ++i)
+    {
+        notes[i] = 0;
+    }
+    mChannels &= ~(1U << (inChannel - 1));
+}
+
+/*! \brief Send a NoteOff for each note held on a channel, and forget them.
+ \return The number of NoteOffs sent.
+ */
+template<class Midi>
+inline unsigned HeldNotes::release(Midi& inMidi, Channel inChannel)
+{
+    if (inChannel < 1 || inChannel > 16 || !(mChannels & (1U << (inChannel - 1))))
+        return 0;
+
+    unsigned count = 0;
+    byte* notes = mNotes[inChannel - 1];
+
+    for (byte i = 0; i < sBytesPerChannel; ++i)
+    {
+        byte bits = notes[i];
+        for (DataByte note = i << 3; bits != 0; ++note, bits >>= 1)
+        {
+            if (bits & 1)
+            {
+                inMidi.sendNoteOff(note, 0, inChannel);
+                count++;
+            }
+        }
+        notes[i] = 0;
+    }
+
+    mChannels &= ~(1U << (inChannel - 1));
+    return count;
+}
+
+/*! \brief Send a NoteOff for each held note, channel by channel, and forget
+ them all. To call when the device that played them was lost.
+ \return The number of NoteOffs sent.
+ */
+template<class Midi>
+inline unsigned HeldNotes::releaseAll(Midi& inMidi)
+{
+    unsigned count = 0;
+
+    for (Channel channel = 1; mChannels != 0 && channel <= 16; ++channel)
+    {
+        count += release(inMidi, channel);
+    }
+    return count;
+}
+
+/*! \brief Channels go from 1 to 16.
+ */
+inline bool HeldNotes::isHeld(Channel inChannel, DataByte inNote) const
+{
+    if (inChannel < 1 || inChannel > 16 || inNote > 127)
+        return false;
+
+    return mNotes[inChannel - 1][inNote >> 3] & (1 << (inNote & 7));
+}
+
+inline bool HeldNotes::isEmpty() const
+{
+    for (Channel channel = 1; channel <= 16; ++channel)
+    {
+        if (!isEmpty(channel))
+            return false;
+    }
+    return true;
+}
+
+inline bool HeldNotes::isEmpty(Channel inChannel) const
+{
+    if (inChannel < 1 || inChannel > 16 || !(mChannels & (1U << (inChannel - 1))))
+        return true;
+
+    const byte* notes = mNotes[inChannel - 1];
+    for (byte i = 0; i < sBytesPerChannel; ++i)
+    {
+        if (notes[i] != 0)
+            return false;
+    }
+    return true;
+}
+
+END_MIDI_NAMESPACE
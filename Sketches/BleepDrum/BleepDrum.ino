@@ -1,10 +1,33 @@
 #include <Util\Util.h>
 ADD_PRINTF_SUPPORT
 
+// generate a MIDI clock from the sync pulses instead of following a received one
+//#define MIDI_CLOCK_GENERATOR
+
 #include <MIDI\MIDI.h>
+#include <MIDI\midi_ClockFollower.h>
+#include <MIDI\midi_Uart.h>
 #include "Pins.h"
 
-MIDI_CREATE_DEFAULT_INSTANCE();
+#ifndef MIDI_CLOCK_GENERATOR
+// no SysEx is expected, so don't spend RAM on a buffer for it
+// clocks are timestamped as they arrive, so that a busy loop() doesn't delay them
+struct MidiSettings : public midi::DefaultSettings
+{
+	static const unsigned SysExMaxSize = 0;
+	static const bool UseReceiveTimestamps = true;
+};
+
+typedef midi::Uart<32, 16, true> MidiUart;
+MidiUart midiUart;
+MIDI_UART_ISR(midiUart);
+MIDI_CREATE_CUSTOM_INSTANCE(MidiUart, midiUart, MIDI, MidiSettings);
+
+// the received MIDI clock, followed at 96 ticks per quarter note
+midi::ClockFollower<96> clockFollower;
+// a MIDI step advances the sequence by a 32nd note
+static const byte TicksPerStep = 96 / 8;
+#endif
 
 namespace Bleep 
 {
@@ -45,38 +68,205 @@ namespace Bleep
 //
 //G3  MIDI step (This is used to advance the sequence one 32 note. While midi clock is not supported, this can be used to sync with the rate of another device)
 
+#ifdef MIDI_CLOCK_GENERATOR
+// the SQ-1 sends a sync pulse on each step, a 16th note
+static const byte ClocksPerPulse = 24 / 4;
+// a MIDI step advances the sequence by a 32nd note
+static const byte ClocksPerStep = 24 / 8;
+// without pulses for that long (a 16th note at 15 bpm), the sequencer is stopped
+static const unsigned long StopTimeout = 1000000;
+// a pulse further than that from the tempo is discarded, unless the next one agrees with it
+static const unsigned long MaximumDrift = 5000;
+// timer 1 counts 4 microsecs per tick, so that a clock period fits in its 16 bits
+static const byte TimerTickMicros = 4;
+
 int lastPulse;
 unsigned long pulseStart;
-unsigned long lastPulseLength;
+unsigned long pulseLength;
+bool driftDiscarded;
+bool playing;
+
+// output bytes, queued by the timer and sent by the UART data register empty interrupt
+midi::RingBuffer<32> txQueue;
+// clocks of the current pulse left for the timer to send
+volatile byte clocksLeft;
+byte clockCount;
+
+// only call with interrupts disabled, there are several producers
+void queueByte(byte value)
+{
+	txQueue.push(value);
+	UCSR1B |= _BV(UDRIE1);
+}
+
+void sendClock()
+{
+	queueByte(midi::Clock);
+	if (clockCount % ClocksPerStep == 0)
+	{
+		// the note off is a null velocity note on, using running status
+		queueByte(midi::NoteOn);
+		queueByte(Bleep::MidiStep);
+		queueByte(127);
+		queueByte(Bleep::MidiStep);
+		queueByte(0);
+	}
+	clockCount = (clockCount + 1) % ClocksPerStep;
+}
+
+ISR(TIMER1_COMPA_vect)
+{
+	sendClock();
+	if (--clocksLeft == 0)
+		TIMSK1 &= ~_BV(OCIE1A);
+}
+
+ISR(USART1_UDRE_vect)
+{
+	if (txQueue.isEmpty())
+		UCSR1B &= ~_BV(UDRIE1);
+	else
+		UDR1 = txQueue.pop();
+}
+
+void onPulse(ulong time)
+{
+	ulong period = time - pulseStart;
+	pulseStart = time;
+
+	// follow the tempo like MultiSync does, a single pulse off the tempo is ignored
+	if (period < StopTimeout)
+	{
+		ulong drift = period > pulseLength ? period - pulseLength : pulseLength - period;
+		if (pulseLength == 0 || drift <= MaximumDrift || driftDiscarded)
+		{
+			pulseLength = period;
+			driftDiscarded = false;
+		}
+		else
+			driftDiscarded = true;
+	}
+
+	noInterrupts();
+	if (!playing)
+	{
+		playing = true;
+		clockCount = 0;
+		queueByte(midi::Start);
+	}
+
+	// the tempo is unknown until the second pulse, which sends the other clocks of this one right away
+	if (pulseLength == 0)
+	{
+		sendClock();
+		clocksLeft = ClocksPerPulse - 1;
+		interrupts();
+		return;
+	}
+
+	// the last pulse came short, send its missing clocks right away so that none is lost
+	while (clocksLeft > 0)
+	{
+		sendClock();
+		clocksLeft--;
+	}
+
+	// the first clock of the pulse is due now, the timer spreads the others evenly until the next one
+	sendClock();
+	clocksLeft = ClocksPerPulse - 1;
+	OCR1A = pulseLength / ClocksPerPulse / TimerTickMicros - 1;
+	TCNT1 = 0;
+	TIFR1 = _BV(OCF1A);
+	TIMSK1 |= _BV(OCIE1A);
+	interrupts();
+}
+#else
+void handleClock()
+{
+	clockFollower.clock(MIDI.getTimestamp());
+}
+
+void handleStart()
+{
+	clockFollower.start();
+}
+
+void handleContinue()
+{
+	clockFollower.resume();
+}
+
+void handleStop()
+{
+	clockFollower.stop();
+}
+
+void handleSongPosition(unsigned beats)
+{
+	clockFollower.setSongPosition(beats);
+}
+#endif
 
 void setup()
 {
 	printf_setup();
+
+#ifdef MIDI_CLOCK_GENERATOR
+	pulseStart = micros() - StopTimeout;
+
+	// the UART only transmits at 31250 bauds, the sync pulses come in on its RX pin
+	UBRR1 = F_CPU / 16 / 31250 - 1;
+	UCSR1A = 0;
+	UCSR1C = _BV(UCSZ11) | _BV(UCSZ10);
+	UCSR1B = _BV(TXEN1);
+
+	// timer 1 in CTC mode, prescaled by 64, its interrupt is enabled on each pulse
+	TCCR1A = 0;
+	TCCR1B = _BV(WGM12) | _BV(CS11) | _BV(CS10);
+	TIMSK1 = 0;
+#else
+	MIDI.setHandleClock(handleClock);
+	MIDI.setHandleStart(handleStart);
+	MIDI.setHandleContinue(handleContinue);
+	MIDI.setHandleStop(handleStop);
+	MIDI.setHandleSongPosition(handleSongPosition);
 	MIDI.begin();
+	// only MIDI steps go out to the bleep drum
+	MIDI.turnThruOff();
+#endif
 }
 
 void loop()
 {
-	unsigned long time = millis();
-
-	MIDI.read();
-
-	if (MIDI.check())
-		printf("c : %u, d1 : %u, d2 : %u, s : %u", MIDI.getChannel(), MIDI.getData1(), MIDI.getData2());
-
-	/*int pulse = digitalRead(In::Digital::Pulse);
+#ifdef MIDI_CLOCK_GENERATOR
+	ulong time = micros();
 
+	int pulse = digitalRead(In::Digital::Pulse);
 	if (lastPulse == 0 && pulse != 0)
-	{
-		// rising
-		pulseStart = time;
+		onPulse(time);
+	lastPulse = pulse;
 
-		MIDI.sendNoteOn(Bleep::RedTick, 127, 1);
+	if (playing && time - pulseStart > StopTimeout)
+	{
+		playing = false;
+		noInterrupts();
+		// clocks still due for the last pulse would go out after the next Start
+		clocksLeft = 0;
+		TIMSK1 &= ~_BV(OCIE1A);
+		queueByte(midi::Stop);
+		interrupts();
 	}
-	else if (lastPulse != 0 && pulse == 0)
+#else
+	MIDI.read();
+
+	// step the sequence on each 32nd note of the clock
+	while (clockFollower.update(micros()))
 	{
-		// descending
-		lastPulseLength = (time - pulseStart) * 2;
+		if (clockFollower.getTick() % TicksPerStep == 0)
+		{
+			MIDI.sendNoteOn(Bleep::MidiStep, 127, 1);
+			MIDI.sendNoteOff(Bleep::MidiStep, 0, 1);
+		}
 	}
-	lastPulse = pulse;*/
+#endif
 }
@@ -11,6 +11,9 @@ int BLINK_LEN_COUNT = 40;
 int BLINK_DIM_START = 10;
 int BLINK_LEN_INCR = 5;
 
+// uncomment to measure, in setup(), what waking coroutines up with a signal costs as their number grows
+//#define BENCHMARK_SIGNALS
+
 void testLocals(COROUTINE_CONTEXT(coroutine))
 {
     COROUTINE_LOCAL(int, i);
@@ -36,10 +39,110 @@ void testLocals(COROUTINE_CONTEXT(coroutine))
     END_COROUTINE;
 }
 
+#ifdef BENCHMARK_SIGNALS
+unsigned benchmarkWoken;
+volatile byte benchmarkSink;
+
+// stands for what a track does on a pulse
+void benchmarkWork()
+{
+	for (byte i = 0; i < 50; i++)
+		benchmarkSink += i;
+}
+
+void waitForPulse(COROUTINE_CONTEXT(coroutine))
+{
+	BEGIN_COROUTINE;
+
+	coroutine.waitForSignal(coroutines.getSignalCount() + 1);
+	COROUTINE_YIELD;
+
+	benchmarkWork();
+	benchmarkWoken++;
+	coroutine.loop();
+
+	END_COROUTINE;
+}
+
+// a pulse runs every coroutine, so what it costs beyond their own work, divided by their number,
+// must stay what it is with a single coroutine
+void benchmarkSignals()
+{
+	const int Pulses = 100;
+	unsigned long firstOverhead = 0;
+
+	// what timing itself adds to the pulse time, which would otherwise weigh most with a single coroutine
+	unsigned long timerTime = 0;
+	for (int i = 0; i < Pulses; i++)
+	{
+		unsigned long t = micros();
+		timerTime += micros() - t;
+	}
+	bool flat = true, allWoken = true;
+
+	for (byte count = 1; count <= 8; count++)
+	{
+		Coroutine* started[8];
+		for (byte i = 0; i < count; i++)
+			started[i] = &coroutines.start(waitForPulse);
+		// let them reach their first wait
+		coroutines.update();
+
+		unsigned long idleTime = 0, pulseTime = 0;
+		benchmarkWoken = 0;
+		for (int i = 0; i < Pulses; i++)
+		{
+			unsigned long t = micros();
+			coroutines.update();
+			idleTime += micros() - t;
+
+			t = micros();
+			coroutines.signal();
+			coroutines.update();
+			pulseTime += micros() - t;
+		}
+		unsigned woken = benchmarkWoken;
+
+		// the same work, without the scheduler, timed as a batch since it is close to the micros() resolution
+		unsigned long workTime = micros();
+		for (int i = 0; i < Pulses; i++)
+			for (byte j = 0; j < count; j++)
+				benchmarkWork();
+		workTime = micros() - workTime;
+
+		// scheduler time per coroutine, over all pulses
+		unsigned long spent = workTime + timerTime;
+		unsigned long overhead = (pulseTime > spent ? pulseTime - spent : 0) / count;
+		if (count == 1)
+			firstOverhead = overhead;
+		// within half of the overhead with a single coroutine, give or take 2 micros() ticks
+		if (overhead > firstOverhead + firstOverhead / 2 + 8)
+			flat = false;
+		if (woken != (unsigned) count * Pulses)
+			allWoken = false;
+
+		printf("%hhu coroutines (%u woken/pulse) : idle update %lu us, pulse %lu us, work %lu us, scheduler %lu us per coroutine per 100 pulses\n",
+			count, woken / Pulses, idleTime / Pulses, pulseTime / Pulses, workTime / Pulses, overhead * 100 / Pulses);
+
+		for (byte i = 0; i < count; i++)
+			started[i]->terminate();
+		coroutines.update();
+	}
+
+	printf("every coroutine woken on each pulse: %s\n", allWoken ? "yes" : "NO");
+	printf("pulse cost per coroutine flat as coroutines are added: %s\n", flat ? "yes" : "NO");
+}
+#endif
+
 void setup() 
 {
 	printf_setup();
 	Serial.begin(115200);
+
+#ifdef BENCHMARK_SIGNALS
+	while (!Serial);
+	benchmarkSignals();
+#endif
 }
 
 void loop()
@@ -0,0 +1,190 @@
+#include "Arduino.h"
+#include <EEPROM\EEPROM.h>
+
+#ifndef KEYDECODER_H
+#define KEYDECODER_H
+
+// Turns single analog samples of the littleBits keyboard into discrete key indices.
+//
+// Each key has a calibrated ADC value (its "center"). The range owned by a key
+// starts halfway between its center and the one of the key below it, so a
+// binary search over these lower bounds finds the key for any sample.
+// A new key must be seen for DebounceSamples consecutive samples before it is
+// reported, and a held key sticks until samples stray further than Hysteresis
+// past its range, so noise on a single read can't make the pitch drift.
+//
+// The calibration table lives in EEPROM, see KeyDecoder::load and KeyDecoder::save.
+class KeyDecoder
+{
+public:
+	static const byte KeyCount = 13;
+	// returned when no key is pressed
+	static const byte NoKey = 0xff;
+
+	// samples below this value are considered as "no key pressed"
+	static const int ReleaseThreshold = 8;
+	// how far past the held key's range (in ADC units) a sample must be to change keys
+	static const int Hysteresis = 6;
+	// how many consecutive samples must agree before a key change is reported
+	static const byte DebounceSamples = 8;
+
+	// EEPROM layout : magic byte followed by KeyCount little-endian centers
+	static const int EepromAddress = 0;
+	static const int EepromSize = 1 + KeyCount * 2;
+	static const byte EepromMagic = 0x4b;
+
+	KeyDecoder();
+
+	// loads the calibration table from EEPROM, returns false (and keeps the default table) if none was saved
+	bool load();
+	// saves the calibration table to EEPROM, only writing bytes that changed
+	void save() const;
+	// sets the ADC value measured for a key
+	void calibrate(byte key, int value);
+
+	// feeds a single ADC sample and returns the debounced key (or NoKey)
+	byte update(int sample);
+	// finds the key owning a sample, without debouncing or hysteresis
+	byte lookup(int sample) const;
+
+	// the key reported by the last update
+	byte getKey() const;
+	// the calibrated ADC value of a key, which is what gets played back for it
+	int getKeyValue(byte key) const;
+
+private:
+	int centers[KeyCount];
+	// lower bound of each key's range
+	int thresholds[KeyCount];
+
+	byte key;
+	byte candidate;
+	byte candidateCount;
+
+	void rebuildThresholds();
+};
+
+KeyDecoder::KeyDecoder() :
+	key(NoKey),
+	candidate(NoKey),
+	candidateCount(0)
+{
+	// evenly spread default table, used until the keyboard is calibrated
+	for (byte i = 0; i < KeyCount; i++)
+		centers[i] = (int) ((i + 1) * 1023L / KeyCount);
+	rebuildThresholds();
+}
+
+bool KeyDecoder::load()
+{
+	if (EEPROM.read(EepromAddress) != EepromMagic)
+		return false;
+
+	for (byte i = 0; i < KeyCount; i++)
+	{
+		int address = EepromAddress + 1 + i * 2;
+		centers[i] = EEPROM.read(address) | (EEPROM.read(address + 1) << 8);
+	}
+	rebuildThresholds();
+
+	return true;
+}
+
+void KeyDecoder::save() const
+{
+	byte bytes[EepromSize];
+	bytes[0] = EepromMagic;
+	for (byte i = 0; i < KeyCount; i++)
+	{
+		bytes[1 + i * 2] = lowByte(centers[i]);
+		bytes[2 + i * 2] = highByte(centers[i]);
+	}
+
+	// EEPROM cells have a limited number of write cycles, leave the unchanged ones alone
+	for (int i = 0; i < EepromSize; i++)
+		if (EEPROM.read(EepromAddress + i) != bytes[i])
+			EEPROM.write(EepromAddress + i, bytes[i]);
+}
+
+void KeyDecoder::calibrate(byte key, int value)
+{
+	if (key >= KeyCount)
+		return;
+
+	centers[key] = value;
+	rebuildThresholds();
+}
+
+byte KeyDecoder::update(int sample)
+{
+	byte sampled = lookup(sample);
+
+	// hysteresis : stay on the held key while the sample is close enough to its range
+	if (key != NoKey && sampled != key && sample >= ReleaseThreshold)
+	{
+		int low = thresholds[key] - Hysteresis;
+		int high = key == KeyCount - 1 ? 1023 : thresholds[key + 1] - 1 + Hysteresis;
+		if (sample >= low && sample <= high)
+			sampled = key;
+	}
+
+	// debounce : only accept a new key once it's been stable for a few samples
+	if (sampled == key)
+		candidateCount = 0;
+	else if (sampled == candidate)
+	{
+		if (++candidateCount >= DebounceSamples)
+		{
+			key = sampled;
+			candidateCount = 0;
+		}
+	}
+	else
+	{
+		candidate = sampled;
+		candidateCount = 1;
+		if (DebounceSamples <= 1)
+			key = sampled;
+	}
+
+	return key;
+}
+
+byte KeyDecoder::lookup(int sample) const
+{
+	if (sample < ReleaseThreshold || sample < thresholds[0])
+		return NoKey;
+
+	// find the last key whose lower bound is under the sample
+	byte low = 0, high = KeyCount - 1;
+	while (low < high)
+	{
+		byte middle = (low + high + 1) / 2;
+		if (thresholds[middle] <= sample)
+			low = middle;
+		else
+			high = middle - 1;
+	}
+
+	return low;
+}
+
+byte KeyDecoder::getKey() const
+{
+	return key;
+}
+
+int KeyDecoder::getKeyValue(byte key) const
+{
+	return key < KeyCount ? centers[key] : 0;
+}
+
+void KeyDecoder::rebuildThresholds()
+{
+	// the first key extends down to halfway from the release threshold
+	thresholds[0] = (centers[0] + ReleaseThreshold) / 2;
+	for (byte i = 1; i < KeyCount; i++)
+		thresholds[i] = (centers[i - 1] + centers[i]) / 2;
+}
+
+#endif
@@ -3,6 +3,12 @@
 #include <Coroutines.h>
 
 #include "Pins.h"
+#include "KeyDecoder.h"
+#include "PatternStore.h"
+#include "Step.h"
+
+// uncomment to walk through the keys in setup() and save their calibration to EEPROM
+//#define CALIBRATE_KEYBOARD
 
 enum Mode {
 	None,
@@ -10,49 +16,183 @@ enum Mode {
 	Record
 };
 
-const byte MaxRecordedNotes = 32;
-int notes[MaxRecordedNotes];
-byte recordedNotes;
+// each track loops over its own steps, so tracks of different lengths make polyrhythms
+const byte TrackCount = 3;
+const byte MaxTrackSteps = 85;
+// how many pulses each step of a track lasts
+const byte TrackDivisions[TrackCount] = { 1, 2, 3 };
+
+// tracks are mixed to these outputs; when tracks share one, the lowest track playing a note wins
+const byte Outputs[] = { Out::Analog::Oscillator, Out::Analog::SecondOscillator };
+const byte OutputCount = sizeof(Outputs) / sizeof(Outputs[0]);
+const byte TrackOutputs[TrackCount] = { 0, 1, 1 };
+
+// one byte per step, see Step.h for the format
+struct Pattern
+{
+	byte lengths[TrackCount];
+	byte steps[TrackCount][MaxTrackSteps];
+};
+Pattern pattern;
+
+// the track that gets recorded into
+byte recordTrack = 0;
+// the step being recorded while its key is held, -1 if none
+int heldStep = -1;
+
+// recorded steps survive power-offs, rotating through 3 EEPROM slots (that's all that fits)
+PatternStore<sizeof(Pattern), 3> patternStore;
+
+// step length used when no pulses come in, and to quantize recorded timing when none came recently
+const unsigned long InternalStepLength = 250;
+// playback falls back to the internal clock when no pulse was seen for this long
+const unsigned long ExternalClockTimeout = 2000;
+// silences longer than this many steps are not recorded as rests
+const byte MaxRecordedRests = 4;
 
 Mode mode = None;
 
-int keyLastPressed;
+KeyDecoder keyboard;
+byte keyLastPressed = KeyDecoder::NoKey;
 unsigned long keyLastPressedAt = 0;
+unsigned long keyLastReleasedAt = 0;
 bool keyReleased;
 bool lastPulse;
+unsigned long lastPulseAt = 0;
+unsigned long pulseLength = InternalStepLength;
 bool needsReset;
+byte previewedKey;
+
+// what each track is currently playing, and what each output was last set to
+int trackValues[TrackCount];
+int outputValues[OutputCount];
 
 Coroutine* previewCoroutine = NULL;
-Coroutine* playCoroutine = NULL;
-Coroutines<3> coroutines;
+Coroutine* trackCoroutines[TrackCount];
+Coroutines<TrackCount + 2> coroutines;
 
 #if _DEBUG
 ADD_PRINTF_SUPPORT;
 #endif
 
+#ifdef CALIBRATE_KEYBOARD
+// press each key once from lowest to highest, each one is acknowledged by a short bleep
+void calibrateKeyboard()
+{
+	for (byte key = 0; key < KeyDecoder::KeyCount; key++)
+	{
+		trace(P("Press key %hhu"), key);
+
+		// the median read returns 0 until the reading is both pressed and stable
+		int value;
+		while ((value = smartMedianAnalogRead(In::Analog::Keyboard)) < KeyDecoder::ReleaseThreshold);
+		keyboard.calibrate(key, value);
+		trace(P("Key %hhu : %i"), key, value);
+
+		analogWrite(Out::Analog::Oscillator, value);
+		while (analogRead(In::Analog::Keyboard) >= KeyDecoder::ReleaseThreshold);
+		analogWrite(Out::Analog::Oscillator, 0);
+		delay(100);
+	}
+
+	keyboard.save();
+}
+#endif
+
 void setup()
 {
 #if _DEBUG
 	printf_setup();
 #endif
 	Serial.begin(115200);
-	analogWrite(Out::Analog::Oscillator, 0);
+	for (byte i = 0; i < OutputCount; i++)
+		analogWrite(Outputs[i], 0);
+
+#ifdef CALIBRATE_KEYBOARD
+	calibrateKeyboard();
+#endif
+
+	if (!keyboard.load())
+		trace(P("No keyboard calibration found, using defaults"));
+
+	// anything else than a full pattern was saved in an older format
+	if (patternStore.load((byte*) &pattern) != sizeof(Pattern))
+		memset(&pattern, 0, sizeof(Pattern));
+	for (byte i = 0; i < TrackCount; i++)
+		trace(P("Track %hhu : %hhu recorded steps"), i, pattern.lengths[i]);
+}
+
+bool hasExternalClock()
+{
+	return lastPulseAt != 0 && millis() - lastPulseAt < ExternalClockTimeout;
+}
+
+unsigned long getPulseLength()
+{
+	return hasExternalClock() ? pulseLength : InternalStepLength;
+}
+
+// converts a duration to the closest number of step quarters
+byte toGateQuarters(unsigned long duration)
+{
+	unsigned long quarters = (duration * Step::GateQuarters + getPulseLength() / 2) / getPulseLength();
+	return (byte) constrain(quarters, 1, Step::GateQuarters);
+}
+
+void recordStep(byte step)
+{
+	byte& length = pattern.lengths[recordTrack];
+	if (length == MaxTrackSteps)
+		length = 0;
+
+	pattern.steps[recordTrack][length++] = step;
+}
+
+void savePattern()
+{
+	patternStore.save((byte*) &pattern, sizeof(Pattern));
+}
+
+byte getRecordOutput()
+{
+	return Outputs[TrackOutputs[recordTrack]];
+}
+
+// sets what a track is playing, and refreshes the output it's mixed to
+void setTrackValue(byte track, int value)
+{
+	trackValues[track] = value;
+
+	byte output = TrackOutputs[track];
+	int mixed = 0;
+	for (byte i = 0; i < TrackCount; i++)
+		if (TrackOutputs[i] == output && trackValues[i] != 0)
+		{
+			mixed = trackValues[i];
+			break;
+		}
+
+	if (mixed != outputValues[output])
+	{
+		outputValues[output] = mixed;
+		analogWrite(Outputs[output], mixed);
+	}
 }
 
 // this avoids the (false postive) warning for coroutine locals
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
 
-// plays a short bleep when the note buffer is cleared by a long press
+// plays a short bleep when the note buffer is cleared, or the recorded track changes, by a long press
 void notifyClear(COROUTINE_CONTEXT(coroutine))
 {
 	BEGIN_COROUTINE;
 
-	analogWrite(Out::Analog::Oscillator, keyLastPressed);
+	analogWrite(getRecordOutput(), keyboard.getKeyValue(keyLastPressed));
 	coroutine.wait(100);
 	COROUTINE_YIELD;
 
-	analogWrite(Out::Analog::Oscillator, 0);
+	analogWrite(getRecordOutput(), 0);
 
 	END_COROUTINE;
 }
@@ -66,12 +206,12 @@ void preview(COROUTINE_CONTEXT(c))
 	{
 		// buffer with silence to reset envelopes
 		needsReset = false;
-		analogWrite(Out::Analog::Oscillator, 0);
+		analogWrite(getRecordOutput(), 0);
 		c.wait(50);
 		COROUTINE_YIELD;
 	}
 
-	analogWrite(Out::Analog::Oscillator, notes[recordedNotes - 1]);
+	analogWrite(getRecordOutput(), keyboard.getKeyValue(previewedKey));
 
 	c.wait(500);
 	COROUTINE_YIELD;
@@ -82,42 +222,81 @@ void preview(COROUTINE_CONTEXT(c))
 	COROUTINE_FINALLY
 	{			
 		// ensure that the oscillator plays nothing as the coroutine exits OR gets terminated
-		analogWrite(Out::Analog::Oscillator, 0);
+		analogWrite(getRecordOutput(), 0);
 	}
 
 	END_COROUTINE;
 }
 
+// plays the steps of a track, one step every TrackDivisions[Track] pulses
+// pulses are coroutine signals, so all tracks are woken up by a single signal() call
+// without pulses, each track times its steps from the internal clock
+template <byte Track>
 void play(COROUTINE_CONTEXT(coroutine))
 {
 	// used for local iteration, saved & recovered when yielding
-	COROUTINE_LOCAL(byte, i);
+	COROUTINE_LOCAL(int, i);
+	COROUTINE_LOCAL(unsigned long, nextSignal);
+	COROUTINE_LOCAL(unsigned long, stepStartedAt);
 
 	BEGIN_COROUTINE;
 
-	for (i = 0; i < recordedNotes; i++)
+	// the first step plays right away
+	nextSignal = coroutines.getSignalCount();
+	stepStartedAt = millis();
+
+	while (true)
 	{
-		// alternate between plays and rests
-		trace(P("Playing note %hhu"), i);
-		analogWrite(Out::Analog::Oscillator, notes[i]);
+		// empty tracks still go through one step per pulse, so that this loop always yields
+		for (i = 0; i < max(pattern.lengths[Track], 1); i++)
+		{
+			// never waits for good : when the pulses stop, all tracks move to the internal clock together
+			if (hasExternalClock())
+				coroutine.waitForSignal(nextSignal, lastPulseAt + ExternalClockTimeout - millis());
+			else
+			{
+				unsigned long elapsed = millis() - stepStartedAt;
+				unsigned long length = InternalStepLength * TrackDivisions[Track];
+				coroutine.waitForSignal(nextSignal, elapsed < length ? length - elapsed : 0);
+			}
+			COROUTINE_YIELD;
 
-		coroutine.suspend();
-		COROUTINE_YIELD;
+			if ((long) (coroutines.getSignalCount() - nextSignal) >= 0)
+			{
+				nextSignal += TrackDivisions[Track];
+				stepStartedAt = millis();
+			}
+			else
+			{
+				// timed out, pulses are counted again from here if they come back
+				nextSignal = coroutines.getSignalCount() + TrackDivisions[Track];
+				// internal steps follow each other without drifting, so that tracks stay together
+				unsigned long length = InternalStepLength * TrackDivisions[Track];
+				stepStartedAt = millis() - stepStartedAt < 2 * length ? stepStartedAt + length : millis();
+			}
 
-		trace(P("Resting"));
-		analogWrite(Out::Analog::Oscillator, 0);
+			if (i >= pattern.lengths[Track] || Step::isRest(pattern.steps[Track][i]))
+			{
+				setTrackValue(Track, 0);
+				continue;
+			}
 
-		coroutine.suspend();
-		COROUTINE_YIELD;
-	}
+			trace(P("Track %hhu playing step %i"), Track, i);
+			setTrackValue(Track, keyboard.getKeyValue(Step::getKey(pattern.steps[Track][i])));
+
+			coroutine.wait(getPulseLength() * TrackDivisions[Track] * Step::getGateQuarters(pattern.steps[Track][i]) / Step::GateQuarters);
+			COROUTINE_YIELD;
 
-	// makes the coroutine loop instead of exiting
-	coroutine.loop();
+			// tied notes keep playing until the next step replaces them
+			if (!Step::isTied(pattern.steps[Track][i]))
+				setTrackValue(Track, 0);
+		}
+	}
 
 	COROUTINE_FINALLY;
 	{
-		// since this coroutine loops, this only gets called on termination
-		analogWrite(Out::Analog::Oscillator, 0);
+		// since this coroutine never ends, this only gets called on termination
+		setTrackValue(Track, 0);
 	}
 
 	END_COROUTINE;
@@ -125,11 +304,21 @@ void play(COROUTINE_CONTEXT(coroutine))
 
 #pragma GCC diagnostic pop
 
+void startPlayback()
+{
+	trackCoroutines[0] = &coroutines.start(play<0>);
+	trackCoroutines[1] = &coroutines.start(play<1>);
+	trackCoroutines[2] = &coroutines.start(play<2>);
+}
+
 void loop() 
 {
 	unsigned long time = millis();
 	coroutines.update(time);
 
+	// writes pending recorded steps to EEPROM, one byte at a time
+	patternStore.update();
+
 	Mode lastMode = mode;
 	mode = boolAnalogRead(In::Analog::ModeSwitch) ? Playback : Record;
 
@@ -139,11 +328,15 @@ void loop()
 		trace(mode == Playback ? P("\n** Playback mode **\n") : P("\n** Record mode **\n"));
 		lastMode = mode;
 
-		if (mode == Record && playCoroutine != NULL && !playCoroutine->isTerminated())
+		if (mode == Record)
 		{
-			// terminate playback coroutine when switching to recording mode
-			playCoroutine->terminate();
-			playCoroutine = NULL;
+			// terminate track coroutines when switching to recording mode
+			for (byte i = 0; i < TrackCount; i++)
+				if (trackCoroutines[i] != NULL && !trackCoroutines[i]->isTerminated())
+				{
+					trackCoroutines[i]->terminate();
+					trackCoroutines[i] = NULL;
+				}
 		}
 
 		if (mode == Playback)
@@ -155,37 +348,76 @@ void loop()
 				previewCoroutine = NULL;
 			}
 
-			// start playback coroutine
-			playCoroutine = &coroutines.start(play);
+			// start a coroutine per track
+			startPlayback();
 		}
 	}
 
+	// pulses are tracked in both modes, so that recording can quantize to their tempo
+	bool thisPulse = digitalRead(In::Digital::Pulse) == HIGH;
+	bool pulseRising = thisPulse && !lastPulse;
+	lastPulse = thisPulse;
+	if (pulseRising)
+	{
+		if (lastPulseAt != 0)
+			pulseLength = time - lastPulseAt;
+		lastPulseAt = time;
+	}
+
 	// mode logic
 	if (mode == Record)
 	{
-		int keyboardValue = smartMedianAnalogRead(In::Analog::Keyboard);
+		// a single sample per loop, the decoder takes care of filtering out the noise
+		byte key = keyboard.update(analogRead(In::Analog::Keyboard));
 
-		if (keyboardValue > 0)
+		if (key != KeyDecoder::NoKey)
 		{
-			if (keyLastPressed == 0)
+			if (keyLastPressed == KeyDecoder::NoKey)
 				keyLastPressedAt = time;
 
-			if (time - keyLastPressedAt > 1000 && recordedNotes > 0)
+			if (time - keyLastPressedAt > 1000)
 			{
-				trace(P("Clearing recorded notes, held %lu ms"), time - keyLastPressedAt);
+				if (pattern.lengths[recordTrack] > 0)
+				{
+					trace(P("Clearing track %hhu, held %lu ms"), recordTrack, time - keyLastPressedAt);
+					pattern.lengths[recordTrack] = 0;
+					savePattern();
+				}
+				else
+				{
+					// long presses on an empty track move on to the next one
+					recordTrack = (recordTrack + 1) % TrackCount;
+					trace(P("Recording track %hhu"), recordTrack);
+				}
 
 				coroutines.start(notifyClear);
-				recordedNotes = 0;
+				heldStep = -1;
 				keyLastPressedAt = time;
 			}
 
-			if (keyReleased)
+			// sliding to another key without releasing ties the previous one into it
+			bool slid = !keyReleased && keyLastPressed != KeyDecoder::NoKey && key != keyLastPressed;
+			if (slid && heldStep >= 0)
 			{
-				if (recordedNotes == MaxRecordedNotes)
-					recordedNotes = 0;
+				byte& step = pattern.steps[recordTrack][heldStep];
+				step = Step::make(Step::getKey(step), toGateQuarters(time - keyLastPressedAt), true);
+				keyLastPressedAt = time;
+			}
 
-				trace(P("Recorded note %hhu : %i"), recordedNotes, keyboardValue);
-				notes[recordedNotes++] = keyboardValue;
+			if (keyReleased || slid)
+			{
+				// silences between notes become rests
+				if (keyReleased && pattern.lengths[recordTrack] > 0)
+				{
+					unsigned long rests = (time - keyLastReleasedAt) / getPulseLength();
+					for (byte i = 0; i < min(rests, (unsigned long) MaxRecordedRests); i++)
+						recordStep(Step::makeRest());
+				}
+
+				trace(P("Recorded step %hhu on track %hhu : key %hhu"), pattern.lengths[recordTrack], recordTrack, key);
+				recordStep(Step::make(key));
+				heldStep = pattern.lengths[recordTrack] - 1;
+				previewedKey = key;
 
 				if (previewCoroutine != NULL && !previewCoroutine->isTerminated())
 				{
@@ -198,21 +430,29 @@ void loop()
 				keyReleased = false;
 			}
 
-			keyLastPressed = keyboardValue;
+			keyLastPressed = key;
 		}
 		else
 		{
+			if (!keyReleased && heldStep >= 0)
+			{
+				// the gate length is how long the key was held, and it's now known
+				byte& step = pattern.steps[recordTrack][heldStep];
+				step = Step::setGateQuarters(step, toGateQuarters(time - keyLastPressedAt));
+				savePattern();
+			}
+
+			if (!keyReleased)
+				keyLastReleasedAt = time;
 			keyReleased = true;
-			keyLastPressed = 0;
+			keyLastPressed = KeyDecoder::NoKey;
 		}
 	}
 	else // if (mode == Playback)
 	{
-		// for each value change, wake up the playback coroutine
-		bool thisPulse = digitalRead(In::Digital::Pulse) == HIGH;
-		if ((thisPulse != lastPulse) && playCoroutine->isSuspended())
-			playCoroutine->resume();
-		lastPulse = thisPulse;
+		// each pulse is a single signal, whatever the number of tracks
+		if (pulseRising)
+			coroutines.signal();
 	}
 }
 
@@ -0,0 +1,220 @@
+#include "Arduino.h"
+#include <EEPROM\EEPROM.h>
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+
+#include "KeyDecoder.h"
+
+#ifndef PATTERNSTORE_H
+#define PATTERNSTORE_H
+
+// Persists a recorded pattern to EEPROM without blocking the sketch.
+//
+// EEPROM cells only survive about 100k writes, so saves rotate through SlotCount
+// slots instead of always hitting the same bytes. Each slot is laid out as :
+//
+//   [sequence] [length LSB] [length MSB] [data x Size] [CRC LSB] [CRC MSB]
+//
+// The sequence number grows with each save, and on load the valid slot (per its
+// CRC) with the most recent sequence wins, so a save interrupted by a power-off
+// simply falls back to the previous one.
+//
+// A byte write takes 3.3ms, so save() only schedules the work, and update() must
+// be called from loop() to drain it. update() never waits on the EEPROM : it
+// returns right away if the previous write is still in progress, and issues at
+// most one write per call. Bytes that already hold the right value are skipped,
+// so re-saving a pattern that only grew by a note rewrites a handful of bytes.
+template <int Size, byte SlotCount>
+class PatternStore
+{
+public:
+	// right after the keyboard calibration table
+	static const int EepromAddress = KeyDecoder::EepromAddress + KeyDecoder::EepromSize;
+	static const int SlotSize = 3 + Size + 2;
+	static const int EepromSize = SlotCount * SlotSize;
+
+	PatternStore();
+
+	// reads the most recent valid slot into data, returns its length (0 if nothing was saved)
+	int load(byte* data);
+	// schedules a save of the first "length" bytes of data, which must stay alive until the save is done
+	// if a save is already in progress, it will be restarted once done to pick up the changes
+	void save(const byte* data, int length);
+	// writes at most one pending byte, call from loop()
+	void update();
+
+	// returns true while a save is being written
+	bool isBusy() const;
+
+private:
+	const byte* source;
+	int sourceLength;
+
+	// the last slot written to (or loaded from), and its sequence number
+	byte slot;
+	byte sequence;
+
+	// progress of the save in the current slot, -1 when idle
+	int position;
+	int length;
+	unsigned int crc;
+	bool dirty;
+
+	int getSlotAddress(byte slot) const;
+	// the value of the byte at a given position of the slot being written
+	byte getPendingByte(int position);
+	// reads a slot and checks its CRC, returns its length or -1 if it's invalid
+	int readSlot(byte slot, byte* data) const;
+};
+
+template <int Size, byte SlotCount>
+PatternStore<Size, SlotCount>::PatternStore() :
+	source(NULL),
+	sourceLength(0),
+	slot(SlotCount - 1),
+	sequence(0),
+	position(-1),
+	length(0),
+	crc(0),
+	dirty(false)
+{
+}
+
+template <int Size, byte SlotCount>
+int PatternStore<Size, SlotCount>::load(byte* data)
+{
+	int loadedLength = 0;
+	bool found = false;
+
+	for (byte i = 0; i < SlotCount; i++)
+	{
+		int slotLength = readSlot(i, NULL);
+		if (slotLength < 0)
+			continue;
+
+		// sequence numbers wrap around, so compare their difference
+		byte slotSequence = EEPROM.read(getSlotAddress(i));
+		if (!found || (signed char) (slotSequence - sequence) > 0)
+		{
+			found = true;
+			slot = i;
+			sequence = slotSequence;
+			loadedLength = slotLength;
+		}
+	}
+
+	if (found)
+		readSlot(slot, data);
+
+	return loadedLength;
+}
+
+template <int Size, byte SlotCount>
+void PatternStore<Size, SlotCount>::save(const byte* data, int length)
+{
+	source = data;
+	sourceLength = min(length, Size);
+
+	if (position >= 0)
+	{
+		dirty = true;
+		return;
+	}
+
+	slot = (slot + 1) % SlotCount;
+	sequence++;
+	this->length = sourceLength;
+	position = 0;
+	crc = 0xffff;
+	dirty = false;
+}
+
+template <int Size, byte SlotCount>
+void PatternStore<Size, SlotCount>::update()
+{
+	if (position < 0 || !eeprom_is_ready())
+		return;
+
+	int address = getSlotAddress(slot);
+	int slotLength = 3 + length + 2;
+
+	// skip over bytes that are already up to date, and stop after the first actual write
+	while (position < slotLength)
+	{
+		byte value = getPendingByte(position);
+		if (position < slotLength - 2)
+			crc = _crc_ccitt_update(crc, value);
+
+		int cell = address + position++;
+		if (EEPROM.read(cell) != value)
+		{
+			EEPROM.write(cell, value);
+			break;
+		}
+	}
+
+	if (position == slotLength)
+	{
+		trace(P("Saved %i bytes to slot %hhu"), length, slot);
+		position = -1;
+
+		// the data changed while it was being written, write it again in the next slot
+		if (dirty)
+			save(source, sourceLength);
+	}
+}
+
+template <int Size, byte SlotCount>
+bool PatternStore<Size, SlotCount>::isBusy() const
+{
+	return position >= 0;
+}
+
+template <int Size, byte SlotCount>
+int PatternStore<Size, SlotCount>::getSlotAddress(byte slot) const
+{
+	return EepromAddress + slot * SlotSize;
+}
+
+template <int Size, byte SlotCount>
+byte PatternStore<Size, SlotCount>::getPendingByte(int position)
+{
+	if (position == 0)
+		return sequence;
+	if (position == 1)
+		return lowByte(length);
+	if (position == 2)
+		return highByte(length);
+	if (position < 3 + length)
+		return source[position - 3];
+	if (position == 3 + length)
+		return lowByte(crc);
+	return highByte(crc);
+}
+
+template <int Size, byte SlotCount>
+int PatternStore<Size, SlotCount>::readSlot(byte slot, byte* data) const
+{
+	int address = getSlotAddress(slot);
+
+	unsigned int slotCrc = 0xffff;
+	for (byte i = 0; i < 3; i++)
+		slotCrc = _crc_ccitt_update(slotCrc, EEPROM.read(address + i));
+
+	int slotLength = EEPROM.read(address + 1) | (EEPROM.read(address + 2) << 8);
+	if (slotLength < 0 || slotLength > Size)
+		return -1;
+
+	for (int i = 0; i < slotLength; i++)
+	{
+		byte value = EEPROM.read(address + 3 + i);
+		slotCrc = _crc_ccitt_update(slotCrc, value);
+		if (data != NULL)
+			data[i] = value;
+	}
+
+	unsigned int storedCrc = EEPROM.read(address + 3 + slotLength) | (EEPROM.read(address + 4 + slotLength) << 8);
+	return storedCrc == slotCrc ? slotLength : -1;
+}
+
+#endif
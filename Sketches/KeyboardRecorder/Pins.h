@@ -31,7 +31,7 @@ class Out
     {
     public:
         static const byte Oscillator = 5;
-        static const byte Unused = 9;        
+        static const byte SecondOscillator = 9;
     };  
 };
 
@@ -0,0 +1,57 @@
+#include "Arduino.h"
+
+#ifndef STEP_H
+#define STEP_H
+
+// A recorded sequence step, packed in a single byte :
+//
+//   bits 0-3 : key index (see KeyDecoder, whose 13 keys fit in 4 bits)
+//   bits 4-5 : gate length, in quarters of a step, minus one
+//   bit 6    : tie, the note keeps playing into the next step instead of being released
+//   bit 7    : rest, nothing plays during this step
+//
+// Steps are stored back to back, so looking up step i is a plain array index.
+class Step
+{
+public:
+	static const byte KeyMask = 0x0f;
+	static const byte GateShift = 4;
+	static const byte GateMask = 0x30;
+	static const byte Tie = 0x40;
+	static const byte Rest = 0x80;
+
+	// gates go from 1/4 to 4/4 of a step
+	static const byte GateQuarters = 4;
+
+	static byte make(byte key, byte gateQuarters = GateQuarters, bool tie = false)
+	{
+		return (key & KeyMask) | (((gateQuarters - 1) << GateShift) & GateMask) | (tie ? Tie : 0);
+	}
+	static byte makeRest()
+	{
+		return Rest;
+	}
+
+	static byte getKey(byte step)
+	{
+		return step & KeyMask;
+	}
+	static byte getGateQuarters(byte step)
+	{
+		return ((step & GateMask) >> GateShift) + 1;
+	}
+	static byte setGateQuarters(byte step, byte gateQuarters)
+	{
+		return (step & ~GateMask) | (((gateQuarters - 1) << GateShift) & GateMask);
+	}
+	static bool isTied(byte step)
+	{
+		return (step & Tie) != 0;
+	}
+	static bool isRest(byte step)
+	{
+		return (step & Rest) != 0;
+	}
+};
+
+#endif
@@ -1,4 +1,6 @@
 //#define SERIAL_DEBUG
+// follow a MIDI clock received on the sync input instead of the SQ-1's sync pulses
+//#define MIDI_CLOCK_SYNC
 
 #define SEQUENCER_COUNT 3
 #define MULTIPLIER_COUNT 6
@@ -6,6 +8,12 @@
 
 #define MAXIMUM_DRIFT_MS 5
 
+#define PRIMING_PULSES 3
+#define PRIMING_TOGGLE_MS 15
+
+// resolution of the followed MIDI clock, in ticks per quarter note
+#define CLOCK_PPQN 96
+
 #include <Util\Util.h>
 
 #ifdef SERIAL_DEBUG
@@ -15,6 +23,28 @@ ADD_PRINTF_SUPPORT
 
 #include "Pins.h"
 
+#ifdef MIDI_CLOCK_SYNC
+#include <MIDI\MIDI.h>
+#include <MIDI\midi_ClockFollower.h>
+#include <MIDI\midi_Uart.h>
+
+// only clock messages matter here, don't spend any RAM on SysEx
+// clocks are timestamped as they arrive, so that a busy loop() doesn't delay them
+struct MidiSettings : public midi::DefaultSettings
+{
+	static const unsigned SysExMaxSize = 0;
+	static const bool UseReceiveTimestamps = true;
+};
+
+// the sync input is on pin 0, which is also the RX pin of Serial1
+// nothing is sent, so the output ring is as small as it gets
+typedef midi::Uart<32, 1, true> MidiUart;
+MidiUart midiUart;
+MIDI_UART_ISR(midiUart);
+MIDI_CREATE_CUSTOM_INSTANCE(MidiUart, midiUart, MIDI, MidiSettings);
+midi::ClockFollower<CLOCK_PPQN> clockFollower;
+#endif
+
 static const int Multipliers[MULTIPLIER_COUNT] = { 1, 2, 3, 4, 6, 8 };
 
 enum PinState 
@@ -31,6 +61,12 @@ struct SequencerState
 	PinState state;
 	byte pin;
 	float multiplier;
+	// still playing the startup priming sequence, until it follows the sync
+	bool priming;
+#ifdef MIDI_CLOCK_SYNC
+	// outputs toggle every CLOCK_PPQN / (2 * multiplier) ticks, worked out when the multiplier changes
+	ulong ticksPerToggle;
+#endif
 };
 SequencerState sequencers[SEQUENCER_COUNT];
 
@@ -48,10 +84,57 @@ enum DutyCycleType
 };
 DutyCycleType lastDutyCycleType;
 
+// on/off toggles left in the startup priming sequence, and when the next one is due
+byte primingToggles;
+ulong nextPrimingToggle;
+
 #ifdef SERIAL_DEBUG
+#define SERIAL_READY_MS 500
 bool ready = false;
 #endif
 
+#ifdef MIDI_CLOCK_SYNC
+void handleClock()
+{
+	clockFollower.clock(MIDI.getTimestamp());
+}
+
+void handleStart()
+{
+	clockFollower.start();
+
+	// the first tick turns all outputs on, priming can't go on
+	primingToggles = 0;
+	for (byte i = 0; i < SEQUENCER_COUNT; ++i)
+	{
+		sequencers[i].priming = false;
+		sequencers[i].state = Off;
+		analogWrite(sequencers[i].pin, 0);
+	}
+}
+
+void handleContinue()
+{
+	clockFollower.resume();
+}
+
+void handleStop()
+{
+	clockFollower.stop();
+}
+
+void handleSongPosition(unsigned beats)
+{
+	clockFollower.setSongPosition(beats);
+}
+
+// a whole number for all multipliers, so this is exact, and only done when a multiplier changes
+void updateTicksPerToggle(SequencerState& sequencer)
+{
+	sequencer.ticksPerToggle = (ulong) (CLOCK_PPQN / (2 * sequencer.multiplier));
+}
+#endif
+
 void setup()
 {
 	lastPulse = millis() - 1;
@@ -70,23 +153,66 @@ void setup()
 	sequencers[1].pin = Out::Digital::Sequencer2;
 	sequencers[2].pin = Out::Digital::Sequencer3;
 
-	// pulse sequencer 3x to prepare for first beat
-	for (byte j = 0; j < 3; ++j)
-	{
-		for (byte i = 0; i < SEQUENCER_COUNT; ++i)
-			analogWrite(sequencers[i].pin, 255);
-		delay(15);
-		for (byte i = 0; i < SEQUENCER_COUNT; ++i)
-			analogWrite(sequencers[i].pin, 0);
-		delay(15);
+	for (byte i = 0; i < SEQUENCER_COUNT; ++i)
+	{
+		sequencers[i].priming = true;
+#ifdef MIDI_CLOCK_SYNC
+		updateTicksPerToggle(sequencers[i]);
+#endif
 	}
 
+	// pulse sequencer 3x to prepare for first beat
+	// this is played from loop() so that sync pulses are listened to in the meantime
+	primingToggles = PRIMING_PULSES * 2;
+	nextPrimingToggle = millis();
+
+#ifdef MIDI_CLOCK_SYNC
+	MIDI.setHandleClock(handleClock);
+	MIDI.setHandleStart(handleStart);
+	MIDI.setHandleContinue(handleContinue);
+	MIDI.setHandleStop(handleStop);
+	MIDI.setHandleSongPosition(handleSongPosition);
+	MIDI.begin(MIDI_CHANNEL_OMNI);
+	MIDI.turnThruOff();
+	// nothing is sent, so give the TX pin back to the first sequencer output
+	UCSR1B &= ~_BV(TXEN1);
+#endif
+
 #ifdef SERIAL_DEBUG
 	printf_setup();
 	Serial.begin(115200);
+	Serial.println("gimme a sec here");
 #endif
 }
 
+// hands an output over from priming to the sync, low so that its first beat is a rising edge
+void endPriming(SequencerState& sequencer)
+{
+	if (!sequencer.priming)
+		return;
+
+	sequencer.priming = false;
+	analogWrite(sequencer.pin, 0);
+}
+
+void updatePriming(ulong currentTime)
+{
+	if (primingToggles == 0 || currentTime < nextPrimingToggle)
+		return;
+
+	// even toggles turn outputs on, odd ones turn them off
+	byte value = primingToggles % 2 == 0 ? 255 : 0;
+	for (byte i = 0; i < SEQUENCER_COUNT; ++i)
+	{
+		// a sequencer that already follows the sync owns its output
+		if (sequencers[i].priming)
+			analogWrite(sequencers[i].pin, value);
+	}
+
+	primingToggles--;
+	nextPrimingToggle = currentTime + PRIMING_TOGGLE_MS;
+}
+
 /*
 //int highest;
 ulong wentOff;
@@ -142,19 +268,67 @@ void clearQueues()
 	}
 }
 
+// toggles a sequencer output, nextTriggerTime being when the following toggle is due
+void trigger(SequencerState& sequencer, ulong nextTriggerTime, DutyCycleType cycleType)
+{
+	if (sequencer.state == On)
+	{
+		if (cycleType == Full)
+		{
+			sequencer.scheduledOffTime = nextTriggerTime - DutyCycleOffset;
+			sequencer.state = ScheduledOff;
+		}
+		else
+		{
+			sequencer.state = Off;
+			analogWrite(sequencer.pin, 0);
+		}
+	}
+	else if (sequencer.state == Off)
+	{
+		sequencer.state = On;
+		analogWrite(sequencer.pin, 255);
+	}
+}
+
+#ifdef MIDI_CLOCK_SYNC
+// outputs toggle every ticksPerToggle ticks
+// they are on for even toggles, so that they come back in phase after a multiplier change
+void updateClockTick(ulong currentTime, ulong tick, DutyCycleType cycleType)
+{
+	for (byte i = 0; i < SEQUENCER_COUNT; ++i)
+	{
+		SequencerState& sequencer = sequencers[i];
+		ulong ticksPerToggle = sequencer.ticksPerToggle;
+		if (tick % ticksPerToggle != 0)
+			continue;
+
+		bool on = (tick / ticksPerToggle) % 2 == 0;
+		if (on && sequencer.state == ScheduledOff)
+		{
+			// the tempo is too fast for the duty cycle offset, end the last gate now
+			sequencer.state = Off;
+			analogWrite(sequencer.pin, 0);
+		}
+		if (on != (sequencer.state == On))
+			trigger(sequencer, currentTime + clockFollower.getTickPeriod() * ticksPerToggle / 1000, cycleType);
+	}
+}
+#endif
+
 void loop()
 {
+	ulong currentTime = millis();
+
 #ifdef SERIAL_DEBUG
-	if (!ready) 
+	if (!ready && currentTime >= SERIAL_READY_MS)
 	{
-		Serial.println("gimme a sec here");
-		delay(500);
 		Serial.println("ready to go");
 		ready = true;
 	}
 #endif
 
-	ulong currentTime = millis();
+	updatePriming(currentTime);
 
 	// query duty cycle
 	DutyCycleType cycleType = analogRead(In::Analog::DutyCycle) > 127 ? Full : Half;
@@ -176,12 +350,20 @@ void loop()
 		// clear queue for variable sequencer
 		memset(variableSequencer.queue, 0, sizeof(ulong) * QUEUE_SIZE);
 		variableSequencer.queueLength = 0;
+#ifdef MIDI_CLOCK_SYNC
+		updateTicksPerToggle(variableSequencer);
+#endif
 
 #ifdef SERIAL_DEBUG
 		printf("<< new multiplier : %i >>\n", (int) variableSequencer.multiplier);
 #endif
 	}
 
+#ifdef MIDI_CLOCK_SYNC
+	MIDI.readAll();
+	while (clockFollower.update(micros()))
+		updateClockTick(currentTime, clockFollower.getTick(), cycleType);
+#else
 	// listen to beats from the SQ-1's Sync Out
 	int listened = digitalRead(In::Digital::Sync);
 	if (listened == HIGH)
@@ -244,6 +426,7 @@ void loop()
 				// special case for empty queue
 				if (sequencer.queueLength == 0)
 				{
+					endPriming(sequencer);
 					sequencer.queue[0] = currentTime;
 					sequencer.queueLength = 1;
 					headOffset = 0;
@@ -268,6 +451,7 @@ void loop()
 	}
 	else
 		wasHigh = false;
+#endif
 
 	for (byte i = 0; i < SEQUENCER_COUNT; ++i)
 	{
@@ -287,25 +471,7 @@ void loop()
 		}
 		else if (sequencer.queueLength > 0 && currentTime >= sequencer.queue[0])
 		{
-			// state logic
-			if (sequencer.state == On)
-			{
-				if (cycleType == Full)
-				{
-					sequencer.scheduledOffTime = sequencer.queue[1] - DutyCycleOffset;
-					sequencer.state = ScheduledOff;
-				}
-				else
-				{
-					sequencer.state = Off;
-					analogWrite(sequencer.pin, 0);
-				}
-			}
-			else if (sequencer.state == Off)
-			{
-				sequencer.state = On;
-				analogWrite(sequencer.pin, 255);
-			}
+			trigger(sequencer, sequencer.queue[1], cycleType);
 
 			// move queue back
 			sequencer.queueLength--;